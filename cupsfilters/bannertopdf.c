@@ -19,11 +19,14 @@
 #include <cupsfilters/raster.h>
 #include <cupsfilters/libcups2-private.h>
 
-#ifndef HAVE_OPEN_MEMSTREAM
-#include <fcntl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#ifndef HAVE_OPEN_MEMSTREAM
+#include <fcntl.h>
 #endif
+#ifdef HAVE_PTHREAD_H
+#  include <pthread.h>
+#endif // HAVE_PTHREAD_H
 
 #include <cups/cups.h>
 #include <cups/pwg.h>
@@ -54,10 +57,40 @@ typedef enum banner_info_e
 typedef struct banner_s
 {
   char *template_file;
+  int template_is_input;	// Template is the job's own (temporary) file
   char *header, *footer;
   unsigned infos;
 } banner_t;
 
+
+//
+// Templates are kept open in a process-wide cache, so that a queue
+// printing job sheets with every job parses its template only once.
+// Entries are keyed by the template file and checked against its
+// modification time.  A template is used by one job at a time; a job
+// finding it busy loads its own copy.
+//
+
+#define TEMPLATE_CACHE_SIZE 8
+
+typedef struct template_cache_s
+{
+  char *filename;		// Template file, NULL for unused entries
+  time_t mtime;			// Modification time of template file
+  cf_pdf_t *pdf;		// Loaded template or NULL
+  int in_use;			// Is the template used by a job?
+} template_cache_t;
+
+static template_cache_t template_cache[TEMPLATE_CACHE_SIZE];
+#ifdef HAVE_PTHREAD_H
+static pthread_mutex_t template_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+#  define TEMPLATE_CACHE_LOCK()   pthread_mutex_lock(&template_cache_mutex)
+#  define TEMPLATE_CACHE_UNLOCK() pthread_mutex_unlock(&template_cache_mutex)
+#else
+#  define TEMPLATE_CACHE_LOCK()
+#  define TEMPLATE_CACHE_UNLOCK()
+#endif // HAVE_PTHREAD_H
+
 static void
 banner_free(banner_t *banner)
 {
@@ -296,7 +329,10 @@ banner_new_from_file(const char *filename,
   if (!banner->template_file)
   {
     if (ispdf)
+    {
       banner->template_file = strdup(filename);
+      banner->template_is_input = 1;
+    }
     else
       banner->template_file = template_path("default.pdf", datadir);
   }
@@ -315,6 +351,113 @@ banner_new_from_file(const char *filename,
   return (banner);
 }
 
+static cf_pdf_t *
+template_load(const char *filename,
+	      int cache)
+{
+  template_cache_t *entry = NULL,
+		   *unused = NULL;
+  cf_pdf_t *pdf = NULL;
+  struct stat st;
+  int i;
+
+  if (!cache || stat(filename, &st))
+    return (cfPDFLoadTemplate(filename));
+
+  TEMPLATE_CACHE_LOCK();
+
+  //
+  // Look for the template in the cache, the file must not have changed
+  // since...
+  //
+
+  for (i = 0; i < TEMPLATE_CACHE_SIZE; i ++)
+  {
+    if (!template_cache[i].filename)
+    {
+      if (!unused || unused->filename)
+	unused = template_cache + i;
+    }
+    else if (!strcmp(template_cache[i].filename, filename))
+    {
+      entry = template_cache + i;
+      break;
+    }
+    else if (!template_cache[i].in_use && (!unused || unused->filename))
+      unused = template_cache + i;
+  }
+
+  if (entry && entry->mtime != st.st_mtime)
+  {
+    //
+    // Template changed, load it again (a job still using the old one
+    // closes it when done)...
+    //
+
+    if (entry->pdf && !entry->in_use)
+      cfPDFFree(entry->pdf);
+    entry->pdf    = NULL;
+    entry->in_use = 0;
+    entry->mtime  = st.st_mtime;
+  }
+  else if (!entry && unused)
+  {
+    //
+    // New template, take an unused entry or one whose template is not in
+    // use...
+    //
+
+    entry = unused;
+    if (entry->pdf)
+      cfPDFFree(entry->pdf);
+    free(entry->filename);
+    memset(entry, 0, sizeof(template_cache_t));
+    if ((entry->filename = strdup(filename)) != NULL)
+      entry->mtime = st.st_mtime;
+    else
+      entry = NULL;
+  }
+
+  //
+  // Use the cached template if nobody else does, otherwise load it...
+  //
+
+  if (entry && entry->pdf && !entry->in_use)
+  {
+    pdf = entry->pdf;
+    entry->in_use = 1;
+  }
+  else if ((pdf = cfPDFLoadTemplate(filename)) != NULL &&
+	   entry && !entry->pdf)
+  {
+    entry->pdf    = pdf;
+    entry->in_use = 1;
+  }
+
+  TEMPLATE_CACHE_UNLOCK();
+
+  return (pdf);
+}
+
+static void
+template_release(cf_pdf_t *pdf)
+{
+  int i;
+
+  TEMPLATE_CACHE_LOCK();
+  for (i = 0; i < TEMPLATE_CACHE_SIZE; i ++)
+    if (template_cache[i].pdf == pdf)
+    {
+      template_cache[i].in_use = 0;
+      pdf = NULL;
+      break;
+    }
+  TEMPLATE_CACHE_UNLOCK();
+
+  if (pdf)
+    cfPDFFree(pdf);
+}
+
 static int
 get_int_option(const char *name,
 	       int num_options,
@@ -608,7 +751,8 @@ generate_banner_pdf(banner_t *banner,
   struct stat st;
 #endif
 
-  if (!(input_doc = cfPDFLoadTemplate(banner->template_file)))
+  if (!(input_doc = template_load(banner->template_file,
+				  !banner->template_is_input)))
   {
     if (log) log(ld, CF_LOGLEVEL_ERROR,
 		 "PDF template must exist and contain exactly 1 page: %s",
@@ -644,7 +788,7 @@ generate_banner_pdf(banner_t *banner,
   {
     if (log) log(ld, CF_LOGLEVEL_ERROR,
 		 "Unable to resize requested PDF page");
-    cfPDFFree(input_doc);
+    template_release(input_doc);
     cfPDFFree(output_doc);
     return (1);
   }
@@ -653,7 +797,7 @@ generate_banner_pdf(banner_t *banner,
   {
     if (log) log(ld, CF_LOGLEVEL_ERROR,
 		 "Unable to add type1 font to requested PDF page");
-    cfPDFFree(input_doc);
+    template_release(input_doc);
     cfPDFFree(output_doc);
     return (1);
   }
@@ -665,7 +809,7 @@ generate_banner_pdf(banner_t *banner,
   {
     if (log)
       log(ld, CF_LOGLEVEL_ERROR, "cfFilterBannerToPDF: Cannot create temp file: %s\n", strerror(errno));
-    cfPDFFree(input_doc);
+    template_release(input_doc);
     cfPDFFree(output_doc);
     return (1);
   }
@@ -878,7 +1022,7 @@ generate_banner_pdf(banner_t *banner,
 
   free(buf);
   free(iterate_helper);
-  cfPDFFree(input_doc);
+  template_release(input_doc);
   cfPDFFree(output_doc);
   return (0);
 }
@@ -1021,6 +1165,7 @@ cfFilterBannerToPDF(int inputfd,         // I - File descriptor input stream
   unlink(tempfile);
   if (inputfp)
     fclose(inputfp);
-  
+  fclose(outputfp);
+
   return (ret);
 }
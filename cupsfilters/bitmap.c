@@ -7,6 +7,7 @@
 
 #include "image.h"
 #include <stdio.h>
+#include <string.h>
 #include <cups/raster.h>
 
 unsigned int dither1[16][16] = {
@@ -299,6 +300,242 @@ cfWritePixel(unsigned char *dst,        // I - Destination string
 }
 
 
+//
+// 'cfConvertBitsLine()' - Convert a line of 8 bit raster data to
+//                         bitspercolor raster data using ordered
+//                         dithering and write it to dst based on
+//                         color order.
+//
+// This gives the same result as calling cfConvertBits() and
+// cfWritePixel() for each pixel of the line, but selects the
+// conversion only once per line and packs whole bytes, so that the
+// inner loops have no switches and can be vectorized by the compiler.
+// Combinations without a line version go through the per-pixel
+// functions.
+//
+
+unsigned char *                         // O - Output line
+cfConvertBitsLine(unsigned char *src,   // I - First input pixel
+		  int srcstep,          // I - Bytes from one input pixel to
+		                        //     the next, negative for reading
+		                        //     the line backwards
+		  unsigned char *dst,   // I - Destination line
+		  unsigned int plane,   // I - Plane/Band
+		  unsigned int pixels,  // I - Number of pixels
+		  unsigned int y,       // I - Row
+		  unsigned int cupsNumColors,// I - Number of color components
+		                        //     of output data
+		  unsigned int convbits,// I - Bits to convert to, as in
+		                        //     cfConvertBits()
+		  unsigned int bitspercolor, // I - Bitspercolor of output data
+		  cups_order_t colororder)   // I - Color Order of output data
+{
+  unsigned char *sp = src;
+  unsigned char *dp = dst;
+  unsigned int *t1 = dither1[y & 0xf];
+  unsigned int *t2 = dither2[y & 0x7];
+  unsigned int *t4 = dither4[y & 0x3];
+  unsigned int c = 0, d;
+  unsigned int x;
+  int planar = (colororder == CUPS_ORDER_PLANAR ||
+		colororder == CUPS_ORDER_BANDED) && cupsNumColors != 1;
+  int copy = (convbits != 1 && convbits != 2 && convbits != 4 &&
+	      convbits != 16) || (convbits == 1 && cupsNumColors == 1);
+
+
+  if (planar)
+  {
+    if (copy && bitspercolor == 8)
+    {
+      for (x = 0; x < pixels; x ++, sp += srcstep)
+	dp[x] = sp[plane];
+      return (dst);
+    }
+    else if (copy && bitspercolor == 16)
+    {
+      for (x = 0; x < pixels; x ++, sp += srcstep, dp += 2)
+      {
+	dp[0] = sp[plane * 2];
+	dp[1] = sp[plane * 2 + 1];
+      }
+      return (dst);
+    }
+    else if (convbits == 16 && bitspercolor == 16)
+    {
+      for (x = 0; x < pixels; x ++, sp += srcstep, dp += 2)
+	dp[0] = dp[1] = sp[plane];
+      return (dst);
+    }
+    else if (convbits == 1 && bitspercolor == 1)
+    {
+      for (x = 0; x < pixels; x ++, sp += srcstep)
+      {
+	c = (c << 1) | (sp[plane] > t1[x & 0xf]);
+	if ((x & 7) == 7)
+	{
+	  *dp++ = c;
+	  c     = 0;
+	}
+      }
+      if (x & 7)
+	*dp = c << (8 - (x & 7));
+      return (dst);
+    }
+    else if (convbits == 2 && bitspercolor == 2 && cupsNumColors <= 4)
+    {
+      for (x = 0; x < pixels; x ++, sp += srcstep)
+      {
+	d = sp[plane] + t2[x & 0x7];
+	c = (c << 2) | ((d > 255 ? 255 : d) >> 6);
+	if ((x & 3) == 3)
+	{
+	  *dp++ = c;
+	  c     = 0;
+	}
+      }
+      if (x & 3)
+	*dp = c << (8 - (x & 3) * 2);
+      return (dst);
+    }
+    else if (convbits == 4 && bitspercolor == 4 &&
+	     (cupsNumColors == 3 || cupsNumColors == 4))
+    {
+      for (x = 0; x < pixels; x ++, sp += srcstep)
+      {
+	d = sp[plane] + t4[x & 0x3];
+	c = (c << 4) | ((d > 255 ? 255 : d) >> 4);
+	if (x & 1)
+	{
+	  *dp++ = c;
+	  c     = 0;
+	}
+      }
+      if (x & 1)
+	*dp = c << 4;
+      return (dst);
+    }
+  }
+  else
+  {
+    if (copy && (bitspercolor == 8 || bitspercolor == 16))
+    {
+      unsigned int n = cupsNumColors * bitspercolor / 8;
+
+      for (x = 0; x < pixels; x ++, sp += srcstep, dp += n)
+	memcpy(dp, sp, n);
+      return (dst);
+    }
+    else if (convbits == 16 && bitspercolor == 16)
+    {
+      for (x = 0; x < pixels; x ++, sp += srcstep)
+	for (unsigned int i = 0; i < cupsNumColors; i ++, dp += 2)
+	  dp[0] = dp[1] = sp[i];
+      return (dst);
+    }
+    else if (convbits == 1 && bitspercolor == 1 &&
+	     (cupsNumColors == 3 || cupsNumColors == 4))
+    {
+      for (x = 0; x < pixels; x ++, sp += srcstep)
+      {
+	c <<= 4;
+	for (unsigned int i = 0; i < cupsNumColors; i ++)
+	  c |= (sp[i] > t1[x & 0xf]) << (cupsNumColors - i - 1);
+	if (x & 1)
+	{
+	  *dp++ = c;
+	  c     = 0;
+	}
+      }
+      if (x & 1)
+	*dp = c << 4;
+      return (dst);
+    }
+    else if (convbits == 2 && bitspercolor == 2)
+    {
+      if (cupsNumColors == 1)
+      {
+	for (x = 0; x < pixels; x ++, sp += srcstep)
+	{
+	  d = sp[0] + t2[x & 0x7];
+	  c = (c << 2) | ((d > 255 ? 255 : d) >> 6);
+	  if ((x & 3) == 3)
+	  {
+	    *dp++ = c;
+	    c     = 0;
+	  }
+	}
+	if (x & 3)
+	  *dp = c << (8 - (x & 3) * 2);
+	return (dst);
+      }
+      else if (cupsNumColors == 3 || cupsNumColors == 4)
+      {
+	for (x = 0; x < pixels; x ++, sp += srcstep)
+	{
+	  c = 0;
+	  for (unsigned int i = 0; i < cupsNumColors; i ++)
+	  {
+	    d = sp[i] + t2[x & 0x7];
+	    c = (c << 2) | ((d > 255 ? 255 : d) >> 6);
+	  }
+	  dp[x] = c;
+	}
+	return (dst);
+      }
+    }
+    else if (convbits == 4 && bitspercolor == 4)
+    {
+      if (cupsNumColors == 1)
+      {
+	for (x = 0; x < pixels; x ++, sp += srcstep)
+	{
+	  d = sp[0] + t4[x & 0x3];
+	  c = (c << 4) | ((d > 255 ? 255 : d) >> 4);
+	  if (x & 1)
+	  {
+	    *dp++ = c;
+	    c     = 0;
+	  }
+	}
+	if (x & 1)
+	  *dp = c << 4;
+	return (dst);
+      }
+      else if (cupsNumColors == 3 || cupsNumColors == 4)
+      {
+	for (x = 0; x < pixels; x ++, sp += srcstep, dp += 2)
+	{
+	  c = 0;
+	  for (unsigned int i = 0; i < cupsNumColors; i ++)
+	  {
+	    d = sp[i] + t4[x & 0x3];
+	    c = (c << 4) | ((d > 255 ? 255 : d) >> 4);
+	  }
+	  dp[0] = c >> 8;
+	  dp[1] = c;
+	}
+	return (dst);
+      }
+    }
+  }
+
+  //
+  // Everything else pixel by pixel...
+  //
+
+  for (x = 0; x < pixels; x ++, sp += srcstep)
+  {
+    unsigned char pixelBuf[32];
+    unsigned char *pb;
+
+    pb = cfConvertBits(sp, pixelBuf, x, y, cupsNumColors, convbits);
+    cfWritePixel(dst, plane, x, pb, cupsNumColors, bitspercolor, colororder);
+  }
+
+  return (dst);
+}
+
+
 //
 // 'cfReverseOneBitLine()' - Reverse the order of pixels in one line
 //                           of 1-bit raster data.
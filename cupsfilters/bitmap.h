@@ -20,6 +20,12 @@ unsigned char *cfConvertBits(unsigned char *src, unsigned char *dst,
 void cfWritePixel(unsigned char *dst, unsigned int plane, unsigned int pixeli,
 		  unsigned char *pixelBuf, unsigned int cupsNumColors,
 		  unsigned int bits, cups_order_t colororder);
+unsigned char *cfConvertBitsLine(unsigned char *src, int srcstep,
+				 unsigned char *dst, unsigned int plane,
+				 unsigned int pixels, unsigned int y,
+				 unsigned int cupsNumColors,
+				 unsigned int convbits, unsigned int bits,
+				 cups_order_t colororder);
 unsigned char *cfReverseOneBitLine(unsigned char *src, unsigned char *dst,
 				   unsigned int pixels, unsigned int size);
 unsigned char *cfReverseOneBitLineSwap(unsigned char *src, unsigned char *dst,
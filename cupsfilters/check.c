@@ -11,6 +11,8 @@
 //
 //   cfCheckBytes() - Check to see if all bytes are zero.
 //   cfCheckValue() - Check to see if all bytes match the given value.
+//   cfCheckSpan()  - Find the first and last byte not matching the given
+//                    value.
 
 
 //
@@ -18,6 +20,32 @@
 //
 
 #include "driver.h"
+#include <stdint.h>
+#include <string.h>
+
+
+//
+// The bytes are compared 8 at a time as 64-bit words, 32 bytes per
+// loop so that the compiler can use vector registers.  Words are
+// loaded with memcpy(), which compiles to a plain (unaligned) load.
+//
+
+#define CHECK_ONES	0x0101010101010101ULL
+
+
+//
+// 'check_word()' - Load 8 bytes as a word.
+//
+
+static inline uint64_t				// O - Word
+check_word(const unsigned char *bytes)		// I - Bytes
+{
+  uint64_t	w;				// Word
+
+
+  memcpy(&w, bytes, sizeof(w));
+  return (w);
+}
 
 
 //
@@ -28,25 +56,22 @@ int						// O - 1 if they match
 cfCheckBytes(const unsigned char *bytes,	// I - Bytes to check
 	     int                 length)	// I - Number of bytes to check
 {
-  while (length > 7)
+  while (length > 31)
   {
-    if (*bytes++)
-      return (0);
-    if (*bytes++)
-      return (0);
-    if (*bytes++)
+    if (check_word(bytes) | check_word(bytes + 8) |
+        check_word(bytes + 16) | check_word(bytes + 24))
       return (0);
-    if (*bytes++)
-      return (0);
-    if (*bytes++)
-      return (0);
-    if (*bytes++)
-      return (0);
-    if (*bytes++)
-      return (0);
-    if (*bytes++)
+
+    bytes  += 32;
+    length -= 32;
+  }
+
+  while (length > 7)
+  {
+    if (check_word(bytes))
       return (0);
 
+    bytes  += 8;
     length -= 8;
   }
 
@@ -69,25 +94,25 @@ cfCheckValue(const unsigned char *bytes,	// I - Bytes to check
 	     int                 length,	// I - Number of bytes to check
 	     const unsigned char value)		// I - Value to check
 {
-  while (length > 7)
+  uint64_t	v = value * CHECK_ONES;		// Value in every byte
+
+
+  while (length > 31)
   {
-    if (*bytes++ != value)
-      return (0);
-    if (*bytes++ != value)
-      return (0);
-    if (*bytes++ != value)
-      return (0);
-    if (*bytes++ != value)
-      return (0);
-    if (*bytes++ != value)
-      return (0);
-    if (*bytes++ != value)
-      return (0);
-    if (*bytes++ != value)
+    if ((check_word(bytes) ^ v) | (check_word(bytes + 8) ^ v) |
+        (check_word(bytes + 16) ^ v) | (check_word(bytes + 24) ^ v))
       return (0);
-    if (*bytes++ != value)
+
+    bytes  += 32;
+    length -= 32;
+  }
+
+  while (length > 7)
+  {
+    if (check_word(bytes) != v)
       return (0);
 
+    bytes  += 8;
     length -= 8;
   }
 
@@ -99,3 +124,65 @@ cfCheckValue(const unsigned char *bytes,	// I - Bytes to check
 
   return (1);
 }
+
+
+//
+// 'cfCheckSpan()' - Find the first and last byte not matching the given
+//                   value.
+//
+// Drivers can use this to skip the blank margins of a line (value 0, or
+// 0xff for inverted data) and only send the bytes in between.
+//
+
+int						// O - 1 if some bytes do not
+						//     match, 0 if all match
+cfCheckSpan(const unsigned char *bytes,		// I - Bytes to check
+	    int                 length,		// I - Number of bytes to check
+	    const unsigned char value,		// I - Value of blank bytes
+	    int                 *first,		// O - First non-blank byte
+	    int                 *last)		// O - Last non-blank byte
+{
+  uint64_t	v = value * CHECK_ONES;		// Value in every byte
+  int		start,				// Start of span
+		end;				// End of span
+
+
+  //
+  // Find the first non-blank byte from the front...
+  //
+
+  for (start = 0; start + 8 <= length; start += 8)
+    if (check_word(bytes + start) != v)
+      break;
+
+  while (start < length && bytes[start] == value)
+    start ++;
+
+  if (start >= length)
+  {
+    if (first)
+      *first = -1;
+    if (last)
+      *last = -1;
+
+    return (0);
+  }
+
+  //
+  // Then the last one from the back, stopping at the first...
+  //
+
+  for (end = length; end - 8 > start; end -= 8)
+    if (check_word(bytes + end - 8) != v)
+      break;
+
+  while (bytes[end - 1] == value)
+    end --;
+
+  if (first)
+    *first = start;
+  if (last)
+    *last = end - 1;
+
+  return (1);
+}
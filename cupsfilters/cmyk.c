@@ -21,6 +21,11 @@
 //                         density.
 //   cfCMYKSetInkLimit() - Set the limit on the amount of ink.
 //   cfCMYKSetLtDk()     - Set light/dark ink transforms.
+//   cmyk_do_cmyk()      - Do a CMYK separation without looking for runs...
+//   cmyk_do_rgb()       - Do an sRGB separation without looking for
+//                         runs...
+//   cmyk_do_runs()      - Separate a line, converting runs of identical
+//                         pixels only once.
 //
 
 //
@@ -33,6 +38,39 @@
 #include <ctype.h>
 
 
+//
+// Macros...
+//
+
+#define CMYK_SAME(a,b,bpp) ((a)[0] == (b)[0] && (a)[1] == (b)[1] && \
+			    (a)[2] == (b)[2] && \
+			    ((bpp) == 3 || (a)[3] == (b)[3]))
+					// Same 3 or 4 byte pixel?
+
+
+//
+// Types...
+//
+
+typedef void (*cmyk_do_func_t)(const cf_cmyk_t *cmyk,
+			       const unsigned char *input, short *output,
+			       int num_pixels);
+					// Separation function
+
+
+//
+// Local functions...
+//
+
+static void	cmyk_do_cmyk(const cf_cmyk_t *cmyk, const unsigned char *input,
+			     short *output, int num_pixels);
+static void	cmyk_do_rgb(const cf_cmyk_t *cmyk, const unsigned char *input,
+			    short *output, int num_pixels);
+static void	cmyk_do_runs(const cf_cmyk_t *cmyk, const unsigned char *input,
+			     int bpp, short *output, int num_pixels,
+			     cmyk_do_func_t func);
+
+
 //
 // 'cfCMYKDelete()' - Delete a color separation.
 //
@@ -246,6 +284,34 @@ cfCMYKDoBlack(const cf_cmyk_t     *cmyk,
 void
 cfCMYKDoCMYK(const cf_cmyk_t     *cmyk,
 					// I - Color separation
+	     const unsigned char *input,
+					// I - Input CMYK pixels
+	     short               *output,
+					// O - Output Device-N pixels
+	     int                 num_pixels)
+					// I - Number of pixels
+{
+  if (cmyk == NULL || input == NULL || output == NULL || num_pixels <= 0)
+    return;
+
+  //
+  // Only look for runs if separating a pixel needs divisions...
+  //
+
+  if (cmyk->ink_limit && cmyk->num_channels > 1)
+    cmyk_do_runs(cmyk, input, 4, output, num_pixels, cmyk_do_cmyk);
+  else
+    cmyk_do_cmyk(cmyk, input, output, num_pixels);
+}
+
+
+//
+// 'cmyk_do_cmyk()' - Do a CMYK separation without looking for runs...
+//
+
+static void
+cmyk_do_cmyk(const cf_cmyk_t     *cmyk,
+					// I - Color separation
 	     const unsigned char *input,
 					// I - Input grayscale pixels
 	     short               *output,
@@ -745,6 +811,35 @@ cfCMYKDoGray(const cf_cmyk_t     *cmyk,
 void
 cfCMYKDoRGB(const cf_cmyk_t     *cmyk,
 					// I - Color separation
+	    const unsigned char *input,
+					// I - Input sRGB pixels
+	    short               *output,
+					// O - Output Device-N pixels
+	    int                 num_pixels)
+					// I - Number of pixels
+{
+  if (cmyk == NULL || input == NULL || output == NULL || num_pixels <= 0)
+    return;
+
+  //
+  // Only look for runs if separating a pixel needs divisions...
+  //
+
+  if ((cmyk->ink_limit && cmyk->num_channels > 1) ||
+      cmyk->num_channels >= 4)
+    cmyk_do_runs(cmyk, input, 3, output, num_pixels, cmyk_do_rgb);
+  else
+    cmyk_do_rgb(cmyk, input, output, num_pixels);
+}
+
+
+//
+// 'cmyk_do_rgb()' - Do an sRGB separation without looking for runs...
+//
+
+static void
+cmyk_do_rgb(const cf_cmyk_t     *cmyk,
+					// I - Color separation
 	    const unsigned char *input,
 					// I - Input grayscale pixels
 	    short               *output,
@@ -1390,3 +1485,78 @@ cfCMYKSetLtDk(cf_cmyk_t    *cmyk,	// I - CMYK color separation
 	  "    %3d = %4dlt + %4ddk", i,
 	  cmyk->channels[channel + 0][i], cmyk->channels[channel + 1][i]);
 }
+
+
+//
+// 'cmyk_do_runs()' - Separate a line, converting runs of identical
+//                    pixels only once.
+//
+// Raster lines mostly consist of runs of the same color (text, fills,
+// background).  Black generation and the ink limit, which need a
+// division per pixel and per ink, and the channel lookups are done for
+// the first pixel of a run only, the others get a copy of its output.
+//
+// This is done instead of separating whole lines in passes (lookups,
+// then sums and ink limit over the line): the output is interleaved and
+// the ink limit must stay bit-exact, and the pass-wise separation was
+// about twice as slow as the per-pixel loops, even vectorized with
+// reciprocals and a correction step.
+//
+
+static void
+cmyk_do_runs(const cf_cmyk_t     *cmyk,	// I - Color separation
+	     const unsigned char *input,	// I - Input pixels
+	     int                 bpp,	// I - Bytes per input pixel
+	     short               *output,	// O - Output Device-N pixels
+	     int                 num_pixels,	// I - Number of pixels
+	     cmyk_do_func_t      func)	// I - Separation function
+{
+  int		count,			// Pixels to separate
+		num_channels = cmyk->num_channels;
+					// Output values per pixel
+  int		total,			// Output values of run
+		done,			// Output values copied so far
+		copy;			// Output values to copy
+
+
+  while (num_pixels > 0)
+  {
+    //
+    // Separate the pixels up to and including the first of a run...
+    //
+
+    for (count = 1; count < num_pixels; count ++)
+      if (CMYK_SAME(input + count * bpp, input + (count - 1) * bpp, bpp))
+        break;
+
+    (*func)(cmyk, input, output, count);
+
+    input      += count * bpp;
+    output     += count * num_channels;
+    num_pixels -= count;
+
+    //
+    // Then copy the output of the first pixel for the rest of the run,
+    // doubling the size of the copies...
+    //
+
+    for (count = 0; count < num_pixels; count ++, input += bpp)
+      if (!CMYK_SAME(input, input - bpp, bpp))
+        break;
+
+    if (count == 0)
+      continue;
+
+    total = count * num_channels;
+
+    memcpy(output, output - num_channels, num_channels * sizeof(short));
+    for (done = num_channels; done < total; done += copy)
+    {
+      copy = min(done, total - done);
+      memcpy(output + done, output, copy * sizeof(short));
+    }
+
+    output     += total;
+    num_pixels -= count;
+  }
+}
@@ -8,14 +8,21 @@
 // information.
 //
 
+#include <config.h>
 #include <cups/raster.h>
 #include <stdio.h>
+#include <string.h>
+#include <time.h>
 #include <sys/types.h>
+#include <unistd.h>
 #include <cupsfilters/filter.h>
 #include <cupsfilters/ipp.h>
 #ifdef HAVE_DBUS
   #include <dbus/dbus.h>
 #endif
+#ifdef HAVE_PTHREAD_H
+  #include <pthread.h>
+#endif
 
 #include "colord.h"
 
@@ -86,6 +93,252 @@ cfColordGetQualifier(cf_filter_data_t *data,
 
 #ifdef HAVE_DBUS
 
+//
+// Every job looks up the profile of its printer, which takes three
+// synchronous D-Bus round trips to colord.  The results are kept in a
+// small cache keyed by the device ID and the qualifiers.  To notice
+// changes the cache holds a private connection to the system bus which
+// subscribes to all signals of colord (DeviceChanged, ProfileAdded,
+// ...) and to colord restarting.  Before each lookup pending signals
+// are read without blocking and any of them flushes the cache.  Entries
+// also expire after COLORD_CACHE_TTL seconds, in case a signal got
+// lost.  Without the watch connection nothing is cached.
+//
+// Most filters run as their own process and look up a profile once, so
+// the watch is only opened when a process looks up the same key a second
+// time; until then only the keys are remembered.  The connection
+// belongs to the process which opened it; a child forked by
+// cfFilterChain() closes its copy right after fork(), or without
+// pthreads on its next lookup, and opens its own if it needs one.
+//
+
+#define COLORD_CACHE_SIZE 16
+#define COLORD_CACHE_TTL  60
+
+typedef struct colord_cache_s
+{
+  char *key;			// Lookup key, NULL for unused entries
+  char *filename;		// Profile filename or NULL
+  int inhibitors;		// Number of profiling inhibitors
+  time_t time;			// Time of the lookup, 0 if only the key
+				// was seen
+} colord_cache_t;
+
+static colord_cache_t colord_cache[COLORD_CACHE_SIZE];
+static DBusConnection *colord_watch = NULL;
+static pid_t colord_watch_pid = 0;	// Process which opened colord_watch
+#ifdef HAVE_PTHREAD_H
+static pthread_mutex_t colord_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+#  define COLORD_LOCK()   pthread_mutex_lock(&colord_cache_mutex)
+#  define COLORD_UNLOCK() pthread_mutex_unlock(&colord_cache_mutex)
+#else
+#  define COLORD_LOCK()
+#  define COLORD_UNLOCK()
+#endif // HAVE_PTHREAD_H
+
+static void
+colord_cache_flush(void)
+{
+  int i;
+
+  for (i = 0; i < COLORD_CACHE_SIZE; i ++)
+  {
+    free(colord_cache[i].key);
+    free(colord_cache[i].filename);
+    colord_cache[i].key = NULL;
+    colord_cache[i].filename = NULL;
+  }
+}
+
+static void
+colord_watch_close(void)
+{
+  dbus_connection_close(colord_watch);
+  dbus_connection_unref(colord_watch);
+  colord_watch = NULL;
+}
+
+// The cache must be locked
+static colord_cache_t *
+colord_cache_add(const char *key,
+		 const char *filename,
+		 int inhibitors)
+{
+  int i;
+  colord_cache_t *entry = colord_cache;
+
+  for (i = 0; i < COLORD_CACHE_SIZE; i ++)
+  {
+    if (colord_cache[i].key == NULL ||
+	!strcmp(colord_cache[i].key, key))
+    {
+      entry = &colord_cache[i];
+      break;
+    }
+    if (colord_cache[i].time < entry->time)
+      entry = &colord_cache[i];
+  }
+
+  free(entry->key);
+  free(entry->filename);
+  entry->key = strdup(key);
+  entry->filename = filename ? strdup(filename) : NULL;
+  entry->inhibitors = inhibitors;
+  entry->time = time(NULL);
+
+  return (entry);
+}
+
+#ifdef HAVE_PTHREAD_H
+// Keep the cache consistent across fork(), the child closes its copy of
+// the watch connection (this does not send anything to the bus, the
+// parent's connection stays intact)
+static void
+colord_atfork_prepare(void)
+{
+  COLORD_LOCK();
+}
+
+static void
+colord_atfork_parent(void)
+{
+  COLORD_UNLOCK();
+}
+
+static void
+colord_atfork_child(void)
+{
+  if (colord_watch != NULL)
+  {
+    colord_watch_close();
+    colord_cache_flush();
+  }
+  COLORD_UNLOCK();
+}
+#endif // HAVE_PTHREAD_H
+
+// Remember a key looked up without the watch connection, with a time
+// of 0 so that colord_cache_find() never returns it; the cache must be
+// locked.  Returns 1 if the key was looked up before
+static int
+colord_cache_seen(const char *key)
+{
+  int i;
+
+  for (i = 0; i < COLORD_CACHE_SIZE; i ++)
+    if (colord_cache[i].key && !strcmp(colord_cache[i].key, key))
+      return (1);
+
+  colord_cache_add(key, NULL, 0)->time = 0;
+
+  return (0);
+}
+
+// Open the watch connection when a key is looked up again, or read the
+// signals received on it, the cache must be locked; returns 1 if
+// results may be cached
+static int
+colord_cache_update(const char *key)
+{
+  DBusError error;
+  DBusMessage *message;
+  int changed = 0;
+#ifdef HAVE_PTHREAD_H
+  static int atfork = 0;	// Fork handlers registered?
+#endif // HAVE_PTHREAD_H
+
+  if (colord_watch != NULL && colord_watch_pid != getpid())
+  {
+    // Inherited through fork(), close the child's copy of the socket
+    // and start over
+    colord_watch_close();
+    colord_cache_flush();
+  }
+
+  if (colord_watch == NULL)
+  {
+    if (!colord_cache_seen(key))
+      return (0);
+
+    dbus_error_init(&error);
+    colord_watch = dbus_bus_get_private(DBUS_BUS_SYSTEM, &error);
+    if (colord_watch == NULL)
+    {
+      dbus_error_free(&error);
+      return (0);
+    }
+    dbus_connection_set_exit_on_disconnect(colord_watch, FALSE);
+    colord_watch_pid = getpid();
+#ifdef HAVE_PTHREAD_H
+    if (!atfork)
+      atfork = !pthread_atfork(colord_atfork_prepare, colord_atfork_parent,
+			       colord_atfork_child);
+#endif // HAVE_PTHREAD_H
+
+    dbus_bus_add_match(colord_watch,
+		       "type='signal',sender='org.freedesktop.ColorManager'",
+		       &error);
+    if (!dbus_error_is_set(&error))
+      dbus_bus_add_match(colord_watch,
+			 "type='signal',sender='org.freedesktop.DBus',"
+			 "member='NameOwnerChanged',"
+			 "arg0='org.freedesktop.ColorManager'",
+			 &error);
+    if (dbus_error_is_set(&error))
+    {
+      dbus_error_free(&error);
+      colord_watch_close();
+      return (0);
+    }
+
+    // Entries from before the watch may be stale
+    colord_cache_flush();
+    return (1);
+  }
+
+  if (!dbus_connection_read_write(colord_watch, 0))
+  {
+    // Lost the bus, changes are not noticed any more
+    colord_watch_close();
+    colord_cache_flush();
+    return (0);
+  }
+
+  while ((message = dbus_connection_pop_message(colord_watch)) != NULL)
+  {
+    if (dbus_message_get_type(message) == DBUS_MESSAGE_TYPE_SIGNAL &&
+	!dbus_message_is_signal(message, DBUS_INTERFACE_DBUS, "NameAcquired") &&
+	!dbus_message_is_signal(message, DBUS_INTERFACE_DBUS, "NameLost"))
+      changed = 1;
+    dbus_message_unref(message);
+  }
+
+  if (changed)
+    colord_cache_flush();
+
+  return (1);
+}
+
+// The cache must be locked
+static colord_cache_t *
+colord_cache_find(const char *key)
+{
+  int i;
+  time_t now = time(NULL);
+
+  for (i = 0; i < COLORD_CACHE_SIZE; i ++)
+    if (colord_cache[i].key && !strcmp(colord_cache[i].key, key))
+    {
+      if (now - colord_cache[i].time >= 0 &&
+	  now - colord_cache[i].time < COLORD_CACHE_TTL)
+	return (&colord_cache[i]);
+      break;
+    }
+
+  return (NULL);
+}
+
+
 static char *
 get_filename_for_profile_path(cf_filter_data_t *data,
 			      DBusConnection *con,
@@ -311,10 +564,10 @@ get_device_path_for_device_id(cf_filter_data_t *data,
   return (device_path);
 }
 
-char *
-cfColordGetProfileForDeviceID(cf_filter_data_t *data,
-			      const char *device_id,
-			      const char **qualifier_tuple)
+static char *
+get_profile_for_device_id(cf_filter_data_t *data,
+			  const char *device_id,
+			  const char **qualifier_tuple)
 {
   cf_logfunc_t log = data->logfunc;
   void *ld = data->logdata;
@@ -438,9 +691,9 @@ get_profile_inhibitors(cf_filter_data_t *data,
   return (inhibitors);
 }
 
-int
-cfColordGetInhibitForDeviceID(cf_filter_data_t *data,
-			      const char *device_id)
+static int
+get_inhibit_for_device_id(cf_filter_data_t *data,
+			  const char *device_id)
 {
   cf_logfunc_t log = data->logfunc;
   void* ld = data->logdata;
@@ -476,6 +729,91 @@ cfColordGetInhibitForDeviceID(cf_filter_data_t *data,
   return (has_inhibitors);
 }
 
+char *
+cfColordGetProfileForDeviceID(cf_filter_data_t *data,
+			      const char *device_id,
+			      const char **qualifier_tuple)
+{
+  cf_logfunc_t log = data->logfunc;
+  void *ld = data->logdata;
+  char key[1024];
+  char *filename = NULL;
+  colord_cache_t *entry;
+  int cache;
+
+  if (device_id == NULL || qualifier_tuple == NULL ||
+      snprintf(key, sizeof(key), "P\t%s\t%s\t%s\t%s", device_id,
+	       qualifier_tuple[QUAL_COLORSPACE],
+	       qualifier_tuple[QUAL_MEDIA],
+	       qualifier_tuple[QUAL_RESOLUTION]) >= (int)sizeof(key))
+    return (get_profile_for_device_id(data, device_id, qualifier_tuple));
+
+  COLORD_LOCK();
+  if ((cache = colord_cache_update(key)) != 0 &&
+      (entry = colord_cache_find(key)) != NULL)
+  {
+    if (entry->filename)
+      filename = strdup(entry->filename);
+    COLORD_UNLOCK();
+    if (log) log(ld, CF_LOGLEVEL_DEBUG,
+		 "Cached colord profile for %s: '%s'", device_id,
+		 filename ? filename : "(none)");
+    return (filename);
+  }
+  COLORD_UNLOCK();
+
+  filename = get_profile_for_device_id(data, device_id, qualifier_tuple);
+
+  if (cache)
+  {
+    COLORD_LOCK();
+    colord_cache_add(key, filename, 0);
+    COLORD_UNLOCK();
+  }
+
+  return (filename);
+}
+
+int
+cfColordGetInhibitForDeviceID(cf_filter_data_t *data,
+			      const char *device_id)
+{
+  cf_logfunc_t log = data->logfunc;
+  void *ld = data->logdata;
+  char key[1024];
+  colord_cache_t *entry;
+  int cache;
+  int has_inhibitors;
+
+  if (device_id == NULL ||
+      snprintf(key, sizeof(key), "I\t%s", device_id) >= (int)sizeof(key))
+    return (get_inhibit_for_device_id(data, device_id));
+
+  COLORD_LOCK();
+  if ((cache = colord_cache_update(key)) != 0 &&
+      (entry = colord_cache_find(key)) != NULL)
+  {
+    has_inhibitors = entry->inhibitors;
+    COLORD_UNLOCK();
+    if (log) log(ld, CF_LOGLEVEL_DEBUG,
+		 "Cached colord inhibitors for %s: %d", device_id,
+		 has_inhibitors);
+    return (has_inhibitors);
+  }
+  COLORD_UNLOCK();
+
+  has_inhibitors = get_inhibit_for_device_id(data, device_id);
+
+  if (cache)
+  {
+    COLORD_LOCK();
+    colord_cache_add(key, NULL, has_inhibitors);
+    COLORD_UNLOCK();
+  }
+
+  return (has_inhibitors);
+}
+
 #else
 
 char *
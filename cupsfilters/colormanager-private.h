@@ -0,0 +1,52 @@
+//
+// Private color management definitions for libcupsfilters.
+//
+// Licensed under Apache License v2.0.  See the file "LICENSE" for more
+// information.
+//
+
+#ifndef _CUPS_FILTERS_COLORMANAGER_PRIVATE_H_
+#  define _CUPS_FILTERS_COLORMANAGER_PRIVATE_H_
+
+//
+// Include necessary headers...
+//
+
+#  include <config.h>
+#  include "colormanager.h"
+#  ifdef USE_LCMS1
+#    include <lcms.h>
+#  else
+#    include <lcms2.h>
+#  endif // USE_LCMS1
+
+
+#  ifdef __cplusplus
+extern "C" {
+#  endif // __cplusplus
+
+
+//
+// Constants...
+//
+
+#  define _CF_CM_TRANSFORM_CACHE 16	// Max. number of cached transforms
+
+
+//
+// Prototypes...
+//
+
+extern cmsHTRANSFORM	_cfCmTransformGet(cmsHPROFILE input,
+					  unsigned int input_format,
+					  cmsHPROFILE output,
+					  unsigned int output_format,
+					  int intent, unsigned int flags);
+extern void		_cfCmTransformRelease(cmsHTRANSFORM transform);
+
+
+#  ifdef __cplusplus
+}
+#  endif // __cplusplus
+
+#endif // !_CUPS_FILTERS_COLORMANAGER_PRIVATE_H_
@@ -9,10 +9,14 @@
 //
 
 
-#include "colormanager.h"
+#include "colormanager-private.h"
 #include <cupsfilters/colord.h>
 #include <cupsfilters/filter.h>
 #include <cupsfilters/ipp.h>
+#include <string.h>
+#ifdef HAVE_PTHREAD_H
+#  include <pthread.h>
+#endif // HAVE_PTHREAD_H
 
 
 #define CM_MAX_FILE_LENGTH 1024
@@ -227,3 +231,245 @@ double *cfCmBlackPointDefault(void)
 {
   return (blackpoint_default);
 }
+
+
+//
+// Private functions
+//
+
+//
+// Color transforms are expensive to create (lcms pre-computes the
+// whole conversion, which for CMYK profiles takes tens of
+// milliseconds), so they are kept in a small process-wide cache and
+// shared between jobs.  The key is the MD5 checksum of both profiles
+// (so it does not matter whether a profile comes from a file or is
+// built in), the pixel formats, the rendering intent and the flags,
+// which include black point compensation.
+//
+// Shared transforms are created with cmsFLAGS_NOCACHE, as otherwise
+// lcms keeps the last converted pixel in the transform and they could
+// not be used by several threads at once.
+//
+
+#ifndef USE_LCMS1
+typedef struct cm_transform_s		// Cached transform
+{
+  cmsUInt8Number	input_id[16],	// MD5 of the input profile
+			output_id[16];	// MD5 of the output profile
+  unsigned int		input_format,	// Input pixel format
+			output_format;	// Output pixel format
+  int			intent;		// Rendering intent
+  unsigned int		flags;		// Transform flags
+  cmsHTRANSFORM		transform;	// Transform, NULL for unused
+  int			refs;		// Number of users
+  unsigned long		used;		// Last use, for replacing entries
+} cm_transform_t;
+
+static cm_transform_t	cm_transforms[_CF_CM_TRANSFORM_CACHE];
+					// Transform cache
+static unsigned long	cm_transforms_used = 0;
+					// Use counter
+#  ifdef HAVE_PTHREAD_H
+static pthread_mutex_t	cm_transforms_mutex = PTHREAD_MUTEX_INITIALIZER;
+					// Lock for the cache
+#    define CM_LOCK()	pthread_mutex_lock(&cm_transforms_mutex)
+#    define CM_UNLOCK()	pthread_mutex_unlock(&cm_transforms_mutex)
+#  else
+#    define CM_LOCK()
+#    define CM_UNLOCK()
+#  endif // HAVE_PTHREAD_H
+
+
+//
+// 'cm_transform_find()' - Find a cached transform and add a user to it.
+//
+// The cache must be locked.
+//
+
+static cmsHTRANSFORM			// O - Transform or NULL
+cm_transform_find(
+    const cmsUInt8Number *input_id,	// I - MD5 of the input profile
+    unsigned int         input_format,	// I - Input pixel format
+    const cmsUInt8Number *output_id,	// I - MD5 of the output profile
+    unsigned int         output_format,	// I - Output pixel format
+    int                  intent,	// I - Rendering intent
+    unsigned int         flags)		// I - Transform flags
+{
+  int			i;		// Looping var
+  cm_transform_t	*t;		// Current entry
+
+
+  for (i = 0, t = cm_transforms; i < _CF_CM_TRANSFORM_CACHE; i ++, t ++)
+    if (t->transform && t->input_format == input_format &&
+	t->output_format == output_format && t->intent == intent &&
+	t->flags == flags && !memcmp(t->input_id, input_id, 16) &&
+	!memcmp(t->output_id, output_id, 16))
+    {
+      t->refs ++;
+      t->used = ++ cm_transforms_used;
+      return (t->transform);
+    }
+
+  return (NULL);
+}
+#endif // !USE_LCMS1
+
+
+//
+// '_cfCmTransformGet()' - Get a color transform from the cache, creating
+//                         it if needed.
+//
+// Arguments are as for cmsCreateTransform().  The transform must be
+// given back with _cfCmTransformRelease() and not be deleted.
+//
+
+cmsHTRANSFORM				// O - Transform or NULL on error
+_cfCmTransformGet(cmsHPROFILE  input,	// I - Input profile
+		  unsigned int input_format,
+					// I - Input pixel format
+		  cmsHPROFILE  output,	// I - Output profile
+		  unsigned int output_format,
+					// I - Output pixel format
+		  int          intent,	// I - Rendering intent
+		  unsigned int flags)	// I - Transform flags
+{
+#ifdef USE_LCMS1
+  return (cmsCreateTransform(input, input_format, output, output_format,
+			     intent, flags));
+#else
+  int			i;		// Looping var
+  cmsUInt8Number	input_id[16],	// MD5 of the input profile
+			output_id[16];	// MD5 of the output profile
+  cmsHTRANSFORM		transform,	// Transform
+			old;		// Replaced transform
+  cm_transform_t	*t,		// Current entry
+			*slot;		// Entry for the new transform
+
+
+  //
+  // Identify the profiles by their contents...
+  //
+
+  if (!cmsMD5computeID(input) || !cmsMD5computeID(output))
+    return (cmsCreateTransform(input, input_format, output, output_format,
+			       intent, flags));
+
+  cmsGetHeaderProfileID(input, input_id);
+  cmsGetHeaderProfileID(output, output_id);
+
+  CM_LOCK();
+  transform = cm_transform_find(input_id, input_format, output_id,
+				output_format, intent, flags);
+  CM_UNLOCK();
+
+  if (transform)
+    return (transform);
+
+  //
+  // Not cached, create the transform without holding the lock...
+  //
+
+  if ((transform = cmsCreateTransform(input, input_format, output,
+				      output_format, intent,
+				      flags | cmsFLAGS_NOCACHE)) == NULL)
+    return (NULL);
+
+  CM_LOCK();
+
+  if ((old = cm_transform_find(input_id, input_format, output_id,
+			       output_format, intent, flags)) != NULL)
+  {
+    //
+    // Another thread was faster...
+    //
+
+    CM_UNLOCK();
+    cmsDeleteTransform(transform);
+    return (old);
+  }
+
+  //
+  // Take an unused entry or the least recently used one which nobody
+  // is using...
+  //
+
+  for (i = 0, t = cm_transforms, slot = NULL; i < _CF_CM_TRANSFORM_CACHE;
+       i ++, t ++)
+  {
+    if (!t->transform)
+    {
+      slot = t;
+      break;
+    }
+    else if (t->refs == 0 && (!slot || t->used < slot->used))
+      slot = t;
+  }
+
+  old = NULL;
+
+  if (slot)
+  {
+    old = slot->transform;
+
+    memcpy(slot->input_id, input_id, 16);
+    memcpy(slot->output_id, output_id, 16);
+    slot->input_format  = input_format;
+    slot->output_format = output_format;
+    slot->intent        = intent;
+    slot->flags         = flags;
+    slot->transform     = transform;
+    slot->refs          = 1;
+    slot->used          = ++ cm_transforms_used;
+  }
+
+  CM_UNLOCK();
+
+  //
+  // If the cache is full of transforms in use, the new one is simply
+  // not cached and gets deleted on release...
+  //
+
+  if (old)
+    cmsDeleteTransform(old);
+
+  return (transform);
+#endif // USE_LCMS1
+}
+
+
+//
+// '_cfCmTransformRelease()' - Give back a transform from
+//                             _cfCmTransformGet().
+//
+
+void
+_cfCmTransformRelease(
+    cmsHTRANSFORM transform)		// I - Transform
+{
+#ifndef USE_LCMS1
+  int			i;		// Looping var
+  cm_transform_t	*t;		// Current entry
+#endif // !USE_LCMS1
+
+
+  if (!transform)
+    return;
+
+#ifndef USE_LCMS1
+  CM_LOCK();
+
+  for (i = 0, t = cm_transforms; i < _CF_CM_TRANSFORM_CACHE; i ++, t ++)
+    if (t->transform == transform)
+    {
+      if (t->refs > 0)
+        t->refs --;
+
+      CM_UNLOCK();
+      return;
+    }
+
+  CM_UNLOCK();
+#endif // !USE_LCMS1
+
+  cmsDeleteTransform(transform);
+}
@@ -9,9 +9,11 @@
 //
 // Contents:
 //
-//   cfDitherDelete() - Free a dithering buffer.
-//   cfDitherLine()   - Dither a line of pixels...
-//   cfDitherNew()    - Create a dithering buffer.
+//   cfDitherDelete()      - Free a dithering buffer.
+//   cfDitherLine()        - Dither a line of pixels...
+//   cfDitherLineOrdered() - Dither a line of pixels with a threshold matrix.
+//   cfDitherNew()         - Create a dithering buffer.
+//   dither_range()        - Return the magnitude of randomness for an error.
 //
 
 //
@@ -22,6 +24,66 @@
 #include "driver.h"
 
 
+//
+// Local globals...
+//
+
+//
+// The dithering state carries two private values past the end of the
+// error buffers: the random number seed and the line counter used by
+// the ordered dither.  Keeping them there rather than in static
+// variables makes every dithering buffer independent, so separate
+// threads can dither at the same time...
+//
+
+#define DITHER_SEED(d)	(((unsigned *)(d)->errors)[2 * ((d)->width + 4)])
+#define DITHER_LINE(d)	((d)->errors[2 * ((d)->width + 4) + 1])
+#define DITHER_RAND(s)	((s) = (s) * 1103515245 + 12345, \
+			 (int)(((s) >> 16) & 0x7fff))
+
+static const signed char dither_small[16] =
+{					// Randomness for errors < 16
+  0, -3, -2, -1, -1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+static const unsigned char dither_log[128] =
+{					// Randomness for errors / 16
+  0, 1, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4,
+  5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+  6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+  6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+  7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+  7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+  7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+  7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7
+};
+static const unsigned char dither_matrix[16][16] =
+{					// 16x16 ordered dither matrix
+  {   0, 128,  32, 160,   8, 136,  40, 168,   2, 130,  34, 162,  10, 138,  42, 170 },
+  { 192,  64, 224,  96, 200,  72, 232, 104, 194,  66, 226,  98, 202,  74, 234, 106 },
+  {  48, 176,  16, 144,  56, 184,  24, 152,  50, 178,  18, 146,  58, 186,  26, 154 },
+  { 240, 112, 208,  80, 248, 120, 216,  88, 242, 114, 210,  82, 250, 122, 218,  90 },
+  {  12, 140,  44, 172,   4, 132,  36, 164,  14, 142,  46, 174,   6, 134,  38, 166 },
+  { 204,  76, 236, 108, 196,  68, 228, 100, 206,  78, 238, 110, 198,  70, 230, 102 },
+  {  60, 188,  28, 156,  52, 180,  20, 148,  62, 190,  30, 158,  54, 182,  22, 150 },
+  { 252, 124, 220,  92, 244, 116, 212,  84, 254, 126, 222,  94, 246, 118, 214,  86 },
+  {   3, 131,  35, 163,  11, 139,  43, 171,   1, 129,  33, 161,   9, 137,  41, 169 },
+  { 195,  67, 227,  99, 203,  75, 235, 107, 193,  65, 225,  97, 201,  73, 233, 105 },
+  {  51, 179,  19, 147,  59, 187,  27, 155,  49, 177,  17, 145,  57, 185,  25, 153 },
+  { 243, 115, 211,  83, 251, 123, 219,  91, 241, 113, 209,  81, 249, 121, 217,  89 },
+  {  15, 143,  47, 175,   7, 135,  39, 167,  13, 141,  45, 173,   5, 133,  37, 165 },
+  { 207,  79, 239, 111, 199,  71, 231, 103, 205,  77, 237, 109, 197,  69, 229, 101 },
+  {  63, 191,  31, 159,  55, 183,  23, 151,  61, 189,  29, 157,  53, 181,  21, 149 },
+  { 255, 127, 223,  95, 247, 119, 215,  87, 253, 125, 221,  93, 245, 117, 213,  85 }
+};
+
+
+//
+// Local functions...
+//
+
+static int	dither_range(int e);
+
+
 //
 // 'cfDitherDelete()' - Free a dithering buffer.
 //
@@ -60,25 +122,10 @@ cfDitherLine(cf_dither_t      *d,	// I - Dither data
 		errrange;		// Range of random multiplier
   register int	*p0,			// Error buffer pointers...
 		*p1;
-  static char	logtable[16384];	// Error magnitude for randomness
-  static char	loginit = 0;		// Has the table been initialized?
-
-
-  if (!loginit)
-  {
-    //
-    // Initialize a logarithmic table for the magnitude of randomness
-    // that is introduced.
-    //
+  unsigned	seed;			// Random number seed
 
-    loginit = 1;
 
-    logtable[0] = 0;
-    for (x = 1; x < 2049; x ++)
-      logtable[x] = (int)(log(x / 16.0) / log(2.0) + 1.0);
-    for (; x < 16384; x ++)
-      logtable[x] = logtable[2049];
-  }
+  seed = DITHER_SEED(d);
 
   if (d->row == 0)
   {
@@ -136,10 +183,7 @@ cfDitherLine(cf_dither_t      *d,	// I - Dither data
       // Set the randomness factor...
       //
 
-      if (e > 0)
-        errrange = logtable[e];
-      else
-        errrange = logtable[-e];
+      errrange = dither_range(e);
 
       errbase  = 8 - errrange;
       errrange = errrange * 2 + 1;
@@ -150,8 +194,8 @@ cfDitherLine(cf_dither_t      *d,	// I - Dither data
 
       if (errrange > 1)
       {
-        errbase0 = errbase + (CUPS_RAND() % errrange);
-        errbase1 = errbase + (CUPS_RAND() % errrange);
+        errbase0 = errbase + (DITHER_RAND(seed) % errrange);
+        errbase1 = errbase + (DITHER_RAND(seed) % errrange);
       }
       else
         errbase0 = errbase1 = errbase;
@@ -230,10 +274,7 @@ cfDitherLine(cf_dither_t      *d,	// I - Dither data
       // Set the randomness factor...
       //
 
-      if (e > 0)
-        errrange = logtable[e];
-      else
-        errrange = logtable[-e];
+      errrange = dither_range(e);
 
       errbase  = 8 - errrange;
       errrange = errrange * 2 + 1;
@@ -244,8 +285,8 @@ cfDitherLine(cf_dither_t      *d,	// I - Dither data
 
       if (errrange > 1)
       {
-        errbase0 = errbase + (CUPS_RAND() % errrange);
-        errbase1 = errbase + (CUPS_RAND() % errrange);
+        errbase0 = errbase + (DITHER_RAND(seed) % errrange);
+        errbase1 = errbase + (DITHER_RAND(seed) % errrange);
       }
       else
         errbase0 = errbase1 = errbase;
@@ -271,7 +312,78 @@ cfDitherLine(cf_dither_t      *d,	// I - Dither data
   // Update to the next row...
   //
 
-  d->row = 1 - d->row;
+  d->row         = 1 - d->row;
+  DITHER_SEED(d) = seed;
+}
+
+
+//
+// 'cfDitherLineOrdered()' - Dither a line of pixels with a threshold matrix.
+//
+// Unlike cfDitherLine() no error is carried from pixel to pixel, so
+// the result only depends on the pixel value and its position on the
+// page.  This is faster and the loop can be vectorized by the
+// compiler, at the cost of a visible (regular) screen pattern.
+//
+
+void
+cfDitherLineOrdered(cf_dither_t    *d,	// I - Dither data
+		    const cf_lut_t *lut,	// I - Lookup table
+		    const short    *data,	// I - Separation data
+		    int            num_channels,
+					// I - Number of components
+		    unsigned char  *p)	// O - Pixels
+{
+  int			x,		// Horizontal position in line...
+			pixel,		// Current adjusted pixel...
+			levels,		// Number of output levels - 1
+			span;		// Intensity span between levels
+  int			threshold[16];	// Thresholds for this line
+  const unsigned char	*row;		// Matrix row for this line
+
+
+  //
+  // Scale the matrix row for this line to the distance between two
+  // output levels, so that a value between two levels picks the upper
+  // one in proportion to how close it is...
+  //
+
+  if ((levels = lut[CF_MAX_LUT].pixel) < 1)
+    levels = 1;
+
+  span = CF_MAX_LUT / levels;
+  row  = dither_matrix[DITHER_LINE(d) & 15];
+
+  for (x = 0; x < 16; x ++)
+    threshold[x] = ((2 * row[x] - 255) * span) / 512;
+
+  //
+  // Dither each output pixel...
+  //
+
+  for (x = 0; x < d->width; x ++, data += num_channels)
+  {
+    if (*data == 0)
+    {
+      p[x] = 0;
+      continue;
+    }
+
+    pixel = lut[*data].intensity + threshold[x & 15];
+
+    if (pixel > CF_MAX_LUT)
+      pixel = CF_MAX_LUT;
+    else if (pixel < 0)
+      pixel = 0;
+
+    p[x] = lut[pixel].pixel;
+  }
+
+  //
+  // Update to the next row...
+  //
+
+  DITHER_LINE(d) ++;
 }
 
 
@@ -286,11 +398,36 @@ cfDitherNew(int width)		// I - Width of output in pixels
 
 
   if ((d = (cf_dither_t *)calloc(1, sizeof(cf_dither_t) +
-				 2 * (width + 4) *
+				 (2 * (width + 4) + 2) *
 				 sizeof(int))) == NULL)
     return (NULL);
 
-  d->width = width;
+  d->width       = width;
+  DITHER_SEED(d) = (unsigned)CUPS_RAND();
 
   return (d);
 }
+
+
+//
+// 'dither_range()' - Return the magnitude of randomness for an error.
+//
+// This is roughly log2(|e| / 16) + 1; errors above 2048 get no
+// randomness at all.
+//
+
+static int				// O - Randomness magnitude
+dither_range(int e)			// I - Error value
+{
+  if (e < 0)
+    e = -e;
+
+  if (e < 16)
+    return (dither_small[e]);
+  else if (e < 2048)
+    return (dither_log[e >> 4]);
+  else if (e == 2048)
+    return (8);
+  else
+    return (0);
+}
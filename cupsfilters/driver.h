@@ -129,6 +129,9 @@ extern const unsigned char
 extern int		cfCheckBytes(const unsigned char *, int);
 extern int		cfCheckValue(const unsigned char *, int,
 				     const unsigned char);
+extern int		cfCheckSpan(const unsigned char *bytes, int length,
+				    const unsigned char value, int *first,
+				    int *last);
 
 //
 // Dithering functions...
@@ -137,6 +140,11 @@ extern int		cfCheckValue(const unsigned char *, int,
 extern void		cfDitherLine(cf_dither_t *d, const cf_lut_t *lut,
 				     const short *data, int num_channels,
 				     unsigned char *p);
+extern void		cfDitherLineOrdered(cf_dither_t *d,
+					    const cf_lut_t *lut,
+					    const short *data,
+					    int num_channels,
+					    unsigned char *p);
 extern cf_dither_t	*cfDitherNew(int width);
 extern void		cfDitherDelete(cf_dither_t *);
 
@@ -178,6 +186,7 @@ extern void		cfRGBDoRGB(cf_rgb_t *rgb,
 				   unsigned char *output, int num_pixels);
 extern cf_rgb_t		*cfRGBNew(int num_samples, cf_sample_t *samples,
 				  int cube_size, int num_channels);
+extern int		cfRGBSetLUT(cf_rgb_t *rgb, int lut_size);
 
 //
 // CMYK separation functions...
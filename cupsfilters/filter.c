@@ -631,7 +631,8 @@ cfFilterChain(int inputfd,         // I - File descriptor input stream
 		pid,		     // Process ID of filter
 		status,		     // Exit status
 		retval,		     // Return value
-		ret;
+		ret,
+		indexed;	     // Did we index the options?
   int		infd, outfd;         // Temporary file descriptors
   char          buf[4096];
   ssize_t       bytes;
@@ -700,6 +701,13 @@ cfFilterChain(int inputfd,         // I - File descriptor input stream
     return (retval);
   }
 
+  //
+  // Index the job options and attributes once, all filters of the chain
+  // share the index...
+  //
+
+  indexed = (cfFilterDataIndexOptions(data) == 1);
+
   //
   // Execute all of the filters...
   //
@@ -737,6 +745,8 @@ cfFilterChain(int inputfd,         // I - File descriptor input stream
 		     "cfFilterChain: Could not create pipe for output of %s: %s",
 		     filter->name ? filter->name : "Unspecified filter",
 		     strerror(errno));
+	if (indexed)
+	  cfFilterDataFreeOptionIndex(data);
 	return (1);
       }
       fcntl_add_cloexec(filterfds[1 - current][0]);
@@ -902,6 +912,9 @@ cfFilterChain(int inputfd,         // I - File descriptor input stream
 
   cupsArrayDelete(pids);
 
+  if (indexed)
+    cfFilterDataFreeOptionIndex(data);
+
   return (retval);
 }
 
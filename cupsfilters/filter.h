@@ -179,6 +179,24 @@ extern void *cfFilterDataGetExt(cf_filter_data_t *data, const char *name);
 extern void *cfFilterDataRemoveExt(cf_filter_data_t *data, const char *name);
 
 
+// Job options and IPP attributes of the filter data, indexed by name.
+// The index is a snapshot: it is only rebuilt automatically when
+// data->options, data->num_options, or data->job_attrs get replaced.
+// After changing them in place (cupsAddOption() of an existing name,
+// ippAdd...()/ippDelete...() on data->job_attrs) call
+// cfFilterDataFreeOptionIndex(), otherwise cfFilterDataGetOption() can
+// return old values.  Who built the index (return value 1) frees it.
+
+extern int cfFilterDataIndexOptions(cf_filter_data_t *data);
+
+
+extern const char *cfFilterDataGetOption(cf_filter_data_t *data,
+					 const char *name);
+
+
+extern void cfFilterDataFreeOptionIndex(cf_filter_data_t *data);
+
+
 extern char *cfFilterGetEnvVar(char *name, char **env);
 
 
@@ -24,6 +24,10 @@
 #define _CF_FONTEMBED_OTF_F_FMT_CFF      0x10000
 #define _CF_FONTEMBED_OTF_F_DO_CHECKSUM  0x40000
 
+#define _CF_FONTEMBED_OTF_SUBSETS        4       // Subset fonts kept per font
+#define _CF_FONTEMBED_OTF_SUBSET_MAX     (4 * 1024 * 1024)
+                                                 // Largest one kept
+
 #define _CF_FONTEMBED_OTF_TAG(a, b, c, d) (unsigned int)(((a) << 24) | \
 							 ((b) << 16) | \
 							 ((c) << 8) | (d))
@@ -49,7 +53,18 @@ typedef struct
 
 typedef struct
 {
-  FILE *f;
+  int *glyphs;			// glyphs in the subset (a bit set, including
+				// .notdef and parts of composite glyphs)
+  char *data;			// the subset font
+  int len;
+  unsigned int stamp;		// last use
+} _cf_fontembed_otf_subset_t;
+
+typedef struct
+{
+  FILE *f;			// NULL, when the whole file is mapped
+  const char *map;		// read-only mapping of the font file, or NULL
+  size_t mapsize;
   unsigned int numTTC, useTTC;
   unsigned int version;
 
@@ -64,13 +79,22 @@ typedef struct
   // optionally loaded data
   unsigned int *glyphOffsets;
   unsigned short numberOfHMetrics;
-  char *hmtx, *name, *cmap;
+  const char *hmtx, *name, *cmap; // see __cfFontEmbedOTFGetTableRef()
   const char *unimap; // ptr to (3,1) or (3,0) cmap start
-
-  // single glyf buffer, allocated large enough by __cfFontEmbedOTFLoadMore()
-  char *gly;
+  unsigned short **unipages; // Unicode -> gid, 0x1100 pages of 256 entries,
+                             // decoded once from the (3,10) or (3,1) cmap
+
+  // current glyph, points into >map or (when the file is not mapped) into
+  // the single glyf buffer, allocated large enough by
+  // __cfFontEmbedOTFLoadMore()
+  const char *gly;
+  char *glybuf;
   _cf_fontembed_otf_dir_ent_t *glyfTable;
 
+  // subset fonts of earlier jobs, see _cfFontEmbedOTFSubSet()
+  _cf_fontembed_otf_subset_t subsets[_CF_FONTEMBED_OTF_SUBSETS];
+  unsigned int subsetStamp;
+
 } _cf_fontembed_otf_file_t;
 
 // SFNT Font files
@@ -21,9 +21,10 @@ __cfFontEmbedEmbOTFGetRights(_cf_fontembed_otf_file_t *otf) // {{{
   _cf_fontembed_emb_right_t ret = _CF_FONTEMBED_EMB_RIGHT_FULL;
 
   int len;
-  char *os2 =
-    _cfFontEmbedOTFGetTable(otf, _CF_FONTEMBED_OTF_TAG('O', 'S', '/', '2'),
-			    &len);
+  const char *os2 =
+    __cfFontEmbedOTFGetTableRef(otf,
+				_CF_FONTEMBED_OTF_TAG('O', 'S', '/', '2'),
+				&len);
   if (os2)
   {
     const unsigned short os2_version = __cfFontEmbedGetUShort(os2);
@@ -47,7 +48,7 @@ __cfFontEmbedEmbOTFGetRights(_cf_fontembed_otf_file_t *otf) // {{{
           ret |= _CF_FONTEMBED_EMB_RIGHT_READONLY;
       }
     }
-    free(os2);
+    __cfFontEmbedOTFReleaseTable(otf, os2);
   }
   return (ret);
 }
@@ -111,20 +112,22 @@ __cfFontEmbedEmbOTFGetPDFFontDescr(_cf_fontembed_otf_file_t *otf,
 
 //  TODO
 //  ... fill in struct
-  char *head =
-    _cfFontEmbedOTFGetTable(otf, _CF_FONTEMBED_OTF_TAG('h', 'e', 'a', 'd'),
-			    &len);
+  const char *head =
+    __cfFontEmbedOTFGetTableRef(otf,
+				_CF_FONTEMBED_OTF_TAG('h', 'e', 'a', 'd'),
+				&len);
   DEBUG_assert(head); // version is 1.0 from _cfFontEmbedOTFLoad
   ret->bbxmin = __cfFontEmbedGetShort(head + 36) * 1000 / otf->unitsPerEm;
   ret->bbymin = __cfFontEmbedGetShort(head + 38) * 1000 / otf->unitsPerEm;
   ret->bbxmax = __cfFontEmbedGetShort(head + 40) * 1000 / otf->unitsPerEm;
   ret->bbymax = __cfFontEmbedGetShort(head + 42) * 1000 / otf->unitsPerEm;
   const int macStyle = __cfFontEmbedGetUShort(head + 44);
-  free(head);
+  __cfFontEmbedOTFReleaseTable(otf, head);
 
-  char *post =
-    _cfFontEmbedOTFGetTable(otf, _CF_FONTEMBED_OTF_TAG('p', 'o', 's', 't'),
-			    &len);
+  const char *post =
+    __cfFontEmbedOTFGetTableRef(otf,
+				_CF_FONTEMBED_OTF_TAG('p', 'o', 's', 't'),
+				&len);
   DEBUG_assert(post);
   const unsigned int post_version = __cfFontEmbedGetULong(post);
   // check length
@@ -151,11 +154,12 @@ __cfFontEmbedEmbOTFGetPDFFontDescr(_cf_fontembed_otf_file_t *otf,
   }
   else
     fprintf(stderr, "WARNING: no italicAngle, no monospaced flag\n");
-  free(post);
+  __cfFontEmbedOTFReleaseTable(otf, post);
 
-  char *os2 =
-    _cfFontEmbedOTFGetTable(otf, _CF_FONTEMBED_OTF_TAG('O', 'S', '/', '2'),
-			    &len);
+  const char *os2 =
+    __cfFontEmbedOTFGetTableRef(otf,
+				_CF_FONTEMBED_OTF_TAG('O', 'S', '/', '2'),
+				&len);
   if (os2)
   {
     const unsigned short os2_version = __cfFontEmbedGetUShort(os2);
@@ -204,7 +208,7 @@ __cfFontEmbedEmbOTFGetPDFFontDescr(_cf_fontembed_otf_file_t *otf,
     }
     else
     {
-      free(os2);
+      __cfFontEmbedOTFReleaseTable(otf, os2);
       os2 = NULL;
     }
   }
@@ -214,7 +218,7 @@ __cfFontEmbedEmbOTFGetPDFFontDescr(_cf_fontembed_otf_file_t *otf,
     // e.g. Subsetted font from Ghostscript // e.g. CFF
   }
   if (os2)
-    free(os2);
+    __cfFontEmbedOTFReleaseTable(otf, os2);
   else
   {
     // TODO (if(CFF))
@@ -230,15 +234,16 @@ __cfFontEmbedEmbOTFGetPDFFontDescr(_cf_fontembed_otf_file_t *otf,
   // Fallbacks
   if ((!ret->ascent) || (!ret->descent))
   {
-    char *hhea =
-      _cfFontEmbedOTFGetTable(otf, _CF_FONTEMBED_OTF_TAG('h', 'h', 'e', 'a'),
-			      &len);
+    const char *hhea =
+      __cfFontEmbedOTFGetTableRef(otf,
+				  _CF_FONTEMBED_OTF_TAG('h', 'h', 'e', 'a'),
+				  &len);
     if (hhea)
     {
       ret->ascent = __cfFontEmbedGetShort(hhea + 4) * 1000 / otf->unitsPerEm;
       ret->descent = __cfFontEmbedGetShort(hhea + 6) * 1000 / otf->unitsPerEm;
     }
-    free(hhea);
+    __cfFontEmbedOTFReleaseTable(otf, hhea);
   }
   if (!ret->stemV)
   {
@@ -673,9 +678,10 @@ __cfFontEmbedEmbOTFPS(_cf_fontembed_otf_file_t *otf,
     return (-1);
 
   int rlen = 0;
-  char *head =
-    _cfFontEmbedOTFGetTable(otf, _CF_FONTEMBED_OTF_TAG('h', 'e', 'a', 'd'),
-			    &rlen);
+  const char *head =
+    __cfFontEmbedOTFGetTableRef(otf,
+				_CF_FONTEMBED_OTF_TAG('h', 'e', 'a', 'd'),
+				&rlen);
   if (!head)
   {
     free(ds.buf);
@@ -687,11 +693,12 @@ __cfFontEmbedEmbOTFPS(_cf_fontembed_otf_file_t *otf,
             bbymin = __cfFontEmbedGetShort(head + 38) * 1000 / otf->unitsPerEm,
             bbxmax = __cfFontEmbedGetShort(head + 40) * 1000 / otf->unitsPerEm,
             bbymax = __cfFontEmbedGetShort(head + 42) * 1000 / otf->unitsPerEm;
-  free(head);
+  __cfFontEmbedOTFReleaseTable(otf, head);
 
-  char *post =
-    _cfFontEmbedOTFGetTable(otf, _CF_FONTEMBED_OTF_TAG('p', 'o', 's', 't'),
-			    &rlen);
+  const char *post =
+    __cfFontEmbedOTFGetTableRef(otf,
+				_CF_FONTEMBED_OTF_TAG('p', 'o', 's', 't'),
+				&rlen);
   if ((!post) && (rlen != -1)) // other error than "not found"
   {
     free(ds.buf);
@@ -759,7 +766,7 @@ __cfFontEmbedEmbOTFPS(_cf_fontembed_otf_file_t *otf,
 
   if (ds.len < 0)
   {
-    free(post);
+    __cfFontEmbedOTFReleaseTable(otf, post);
     free(ds.buf);
     return (-1);
   }
@@ -781,7 +788,7 @@ __cfFontEmbedEmbOTFPS(_cf_fontembed_otf_file_t *otf,
   if (!otw)
   {
     fprintf(stderr, "Bad alloc: %m\n");
-    free(post);
+    __cfFontEmbedOTFReleaseTable(otf, post);
     free(ds.buf);
     return (-1);
   }
@@ -837,7 +844,7 @@ __cfFontEmbedEmbOTFPS(_cf_fontembed_otf_file_t *otf,
   free(otfree);
   if (iA == -1)
   {
-    free(post);
+    __cfFontEmbedOTFReleaseTable(otf, post);
     free(ds.buf);
     return (-1);
   }
@@ -859,7 +866,7 @@ __cfFontEmbedEmbOTFPS(_cf_fontembed_otf_file_t *otf,
   }
   __cfFontEmbedDynPrintF(&ds, "end readonly def\n");
   __cfFontEmbedDynPrintF(&ds, "FontName currentdict end definefont pop\n");
-  free(post);
+  __cfFontEmbedOTFReleaseTable(otf, post);
 
   if (ds.len < 0)
   {
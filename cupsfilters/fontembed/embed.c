@@ -15,16 +15,24 @@
 
 
 static inline int
-copy_file(FILE *f,
+copy_file(_cf_fontembed_otf_file_t *otf,
 	  _cf_fontembed_output_fn_t output,
 	  void *context) // {{{
 {
-  DEBUG_assert(f);
+  DEBUG_assert(otf);
   DEBUG_assert(output);
 
+  if (otf->map) // whole file mapped, no need to read it
+  {
+    (*output)(otf->map, otf->mapsize, context);
+    return (otf->mapsize);
+  }
+
+  FILE *f = otf->f;
   char buf[4096];
   int iA, ret = 0;
 
+  DEBUG_assert(f);
   ret = 0;
   rewind(f);
   do
@@ -276,7 +284,7 @@ _cfFontEmbedEmbEmbed(_cf_fontembed_emb_params_t *emb,
       else if (emb->font->sfnt->numTTC)
         return (_cfFontEmbedOTFTTCExtract(emb->font->sfnt, output, context));
       else // copy verbatim
-        return (copy_file(emb->font->sfnt->f, output, context));
+        return (copy_file(emb->font->sfnt, output, context));
     }
     else if (emb->outtype == _CF_FONTEMBED_EMB_FMT_OTF)
     {
@@ -299,7 +307,7 @@ _cfFontEmbedEmbEmbed(_cf_fontembed_emb_params_t *emb,
           return (_cfFontEmbedOTFSubSetCFF(emb->font->sfnt, emb->subset, output,
 				 context));
         else
-          return (copy_file(emb->font->sfnt->f, output, context));
+          return (copy_file(emb->font->sfnt, output, context));
       }
     }
     else if (emb->outtype == _CF_FONTEMBED_EMB_FMT_CFF)
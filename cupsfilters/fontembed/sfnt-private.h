@@ -135,6 +135,13 @@ int __cfFontEmbedOTFFindTable(_cf_fontembed_otf_file_t *otf,
 			      unsigned int tag); // - table_index  or
                                                  //   -1 on error
 
+// like _cfFontEmbedOTFGetTable(), but read-only: points straight into the
+// mapped font file when possible; release with __cfFontEmbedOTFReleaseTable()
+const char *__cfFontEmbedOTFGetTableRef(_cf_fontembed_otf_file_t *otf,
+					unsigned int tag, int *ret_len);
+void __cfFontEmbedOTFReleaseTable(_cf_fontembed_otf_file_t *otf,
+				  const char *table);
+
 int __cfFontEmbedOTFActionCopy(void *param, int csum,
 			       _cf_fontembed_output_fn_t output, void *context);
 int __cfFontEmbedOTFActionReplace(void *param, int csum,
@@ -159,4 +166,6 @@ int __cfFontEmbedOTFWriteSFNT(struct __cf_fontembed_otf_write_s *otw,
 int __cfFontEmbedOTFIntersectTables(_cf_fontembed_otf_file_t *otf,
 				    struct __cf_fontembed_otf_write_s *otw);
 
+void __cfFontEmbedOTFSubSetCacheFree(_cf_fontembed_otf_file_t *otf);
+
 #endif // !_FONTEMBED_SFNT_INT_H_
@@ -8,6 +8,7 @@
 #include <cupsfilters/fontembed-private.h>
 #include <cupsfilters/debug-internal.h>
 #include "sfnt-private.h"
+#include "dynstring-private.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -105,7 +106,7 @@ otf_subset_glyf(_cf_fontembed_otf_file_t *otf,
   if (__cfFontEmbedGetShort(otf->gly) >= 0) // not composite
     return (ret); // done
 
-  char *cur = otf->gly + 10;
+  const char *cur = otf->gly + 10;
 
   unsigned short flags;
   do
@@ -150,6 +151,113 @@ otf_subset_glyf(_cf_fontembed_otf_file_t *otf,
 // }}}
 
 
+// Subset fonts are kept with the font file, jobs using the same (or
+// fewer) glyphs, like a report printed again and again, get them without
+// building the glyf/loca tables and writing the SFNT once more
+
+static int
+otf_subset_words(_cf_fontembed_otf_file_t *otf) // {{{
+{
+  return ((otf->numGlyphs + 8 * sizeof(int) - 1) / (8 * sizeof(int)));
+}
+// }}}
+
+
+static _cf_fontembed_otf_subset_t *
+otf_subset_cache_find(_cf_fontembed_otf_file_t *otf,
+		      _cf_fontembed_bit_set_t glyphs) // {{{ - NULL if none
+{
+  _cf_fontembed_otf_subset_t *ret = NULL;
+  const int words = otf_subset_words(otf);
+  int iA, iB;
+
+  // the smallest subset containing all the glyphs
+  for (iA = 0; iA < _CF_FONTEMBED_OTF_SUBSETS; iA ++)
+  {
+    _cf_fontembed_otf_subset_t *sub = otf->subsets + iA;
+    if ((!sub->data) || ((ret) && (ret->len <= sub->len)))
+      continue;
+    for (iB = 0; iB < words; iB ++)
+      if (glyphs[iB] & ~sub->glyphs[iB])
+        break;
+    if (iB == words)
+      ret = sub;
+  }
+
+  return (ret);
+}
+// }}}
+
+
+// takes >ds
+
+static void
+otf_subset_cache_add(_cf_fontembed_otf_file_t *otf,
+		     _cf_fontembed_bit_set_t glyphs,
+		     __cf_fontembed_dyn_string_t *ds) // {{{
+{
+  _cf_fontembed_otf_subset_t *sub = otf->subsets;
+  const int words = otf_subset_words(otf);
+  int iA;
+
+  if (ds->len > _CF_FONTEMBED_OTF_SUBSET_MAX)
+  {
+    __cfFontEmbedDynFree(ds);
+    return;
+  }
+
+  // replace the least recently used one
+  for (iA = 1; iA < _CF_FONTEMBED_OTF_SUBSETS; iA ++)
+    if (otf->subsets[iA].stamp < sub->stamp)
+      sub = otf->subsets + iA;
+
+  free(sub->glyphs);
+  free(sub->data);
+  memset(sub, 0, sizeof(_cf_fontembed_otf_subset_t));
+
+  if ((sub->glyphs = malloc(words * sizeof(int))) == NULL)
+  {
+    __cfFontEmbedDynFree(ds);
+    return;
+  }
+  memcpy(sub->glyphs, glyphs, words * sizeof(int));
+  sub->data = ds->buf;
+  sub->len = ds->len;
+  sub->stamp = ++ otf->subsetStamp;
+}
+// }}}
+
+
+static void
+otf_subset_capture(const char *buf,
+		   int len,
+		   void *context) // {{{
+{
+  __cf_fontembed_dyn_string_t *ds = context;
+
+  if ((len <= 0) || (__cfFontEmbedDynEnsure(ds, len) == -1))
+    return;
+  memcpy(ds->buf + ds->len, buf, len);
+  ds->len += len;
+}
+// }}}
+
+
+void
+__cfFontEmbedOTFSubSetCacheFree(_cf_fontembed_otf_file_t *otf) // {{{
+{
+  int iA;
+
+  for (iA = 0; iA < _CF_FONTEMBED_OTF_SUBSETS; iA ++)
+  {
+    free(otf->subsets[iA].glyphs);
+    free(otf->subsets[iA].data);
+  }
+  memset(otf->subsets, 0, sizeof(otf->subsets));
+}
+// }}}
+
+
 // TODO: cmap only required in non-CID context
 
 int
@@ -196,6 +304,15 @@ _cfFontEmbedOTFSubSet(_cf_fontembed_otf_file_t *otf,
     }
   }
 
+  // a subset of an earlier job may already contain all the glyphs
+  _cf_fontembed_otf_subset_t *sub = otf_subset_cache_find(otf, glyphs);
+  if (sub)
+  {
+    sub->stamp = ++ otf->subsetStamp;
+    (*output)(sub->data, sub->len, context);
+    return (sub->len);
+  }
+
   // second pass: calculate new glyf and loca
   int locaSize = (otf->numGlyphs + 1) * (otf->indexToLocFormat + 1) * 2;
 
@@ -277,10 +394,28 @@ _cfFontEmbedOTFSubSet(_cf_fontembed_otf_file_t *otf,
     {0, 0, 0, 0}
   };
 
-  // and write them
+  // and write them, keeping a copy for later jobs
   int numTables = __cfFontEmbedOTFIntersectTables(otf, otw);
-  int ret = __cfFontEmbedOTFWriteSFNT(otw, otf->version, numTables, output,
-				      context);
+  int ret = -1;
+  __cf_fontembed_dyn_string_t ds;
+  if (__cfFontEmbedDynInit(&ds, glyfSize + locaSize + 4096) != -1)
+  {
+    ret = __cfFontEmbedOTFWriteSFNT(otw, otf->version, numTables,
+				    otf_subset_capture, &ds);
+    if ((ret != -1) && (ds.len == ret))
+    {
+      (*output)(ds.buf, ds.len, context);
+      otf_subset_cache_add(otf, glyphs, &ds);
+    }
+    else
+    {
+      __cfFontEmbedDynFree(&ds);
+      ret = -1;
+    }
+  }
+  if (ret == -1) // out of memory: no copy
+    ret = __cfFontEmbedOTFWriteSFNT(otw, otf->version, numTables, output,
+				    context);
 
   free(new_loca);
   free(new_glyf);
@@ -406,6 +541,14 @@ _cfFontEmbedOTFCFFExtract(_cf_fontembed_otf_file_t *otf,
 
   const _cf_fontembed_otf_dir_ent_t *table = otf->tables + idx;
 
+  if (otf->map)
+  {
+    if ((size_t)table->offset + table->length > otf->mapsize)
+      return (-1);
+    (*output)(otf->map + table->offset, table->length, context);
+    return (table->length);
+  }
+
   return (copy_block(otf->f, table->offset, table->length, output, context));
 }
 // }}}
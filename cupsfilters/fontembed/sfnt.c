@@ -12,6 +12,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 
 // TODO?
@@ -20,6 +22,11 @@
 // OTF: glyf, loca [cvt, fpgm, prep]
 //
 
+// Unicode -> gid table, see >unipages
+#define OTF_UNI_MAX   0x110000
+#define OTF_UNI_PAGES (OTF_UNI_MAX >> 8)
+
+
 static void
 otf_bsearch_params(int num, // {{{
 		   int recordSize,
@@ -42,6 +49,7 @@ otf_bsearch_params(int num, // {{{
 // }}}
 
 
+#if 0 // only used by the disabled code in __cfFontEmbedOTFFindTable()
 static char *
 otf_bsearch(char *table, // {{{
 	    const char *target,
@@ -74,6 +82,7 @@ otf_bsearch(char *table, // {{{
   return (NULL); // not found;
 }
 // }}}
+#endif // 0
 
 
 static _cf_fontembed_otf_file_t *
@@ -94,6 +103,37 @@ otf_new(FILE *f) // {{{
 // }}}
 
 
+// map the whole font file read-only, so tables can be used in place;
+// on success >f is no longer needed and gets closed
+
+static int
+otf_map(_cf_fontembed_otf_file_t *otf) // {{{ - 0 on success
+{
+  struct stat st;
+  void *map;
+
+  DEBUG_assert(otf->f);
+  if ((fstat(fileno(otf->f), &st) == -1) ||
+      (!S_ISREG(st.st_mode)) ||
+      (st.st_size <= 0) ||
+      ((unsigned long long)st.st_size > (size_t)-1))
+    return (-1);
+
+  map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE,
+	     fileno(otf->f), 0);
+  if (map == MAP_FAILED)
+    return (-1);
+
+  otf->map = map;
+  otf->mapsize = (size_t)st.st_size;
+  fclose(otf->f);
+  otf->f = NULL;
+
+  return (0);
+}
+// }}}
+
+
 // will alloc, if >buf == NULL, returns >buf, or NULL on error
 // NOTE: you probably want _cfFontEmbedOTFGetTable()
 
@@ -104,6 +144,7 @@ otf_read(_cf_fontembed_otf_file_t *otf,
 	 int length) // {{{
 {
   char *ours = NULL;
+  int res;
 
   if (length == 0)
     return (buf);
@@ -113,8 +154,15 @@ otf_read(_cf_fontembed_otf_file_t *otf,
     return (NULL);
   }
 
-  int res = fseek(otf->f, pos, SEEK_SET);
-  if (res == -1)
+  if (otf->map)
+  {
+    if ((pos < 0) || ((size_t)pos + length > otf->mapsize))
+    {
+      fprintf(stderr, "Short read\n");
+      return (NULL);
+    }
+  }
+  else if (fseek(otf->f, pos, SEEK_SET) == -1)
   {
     fprintf(stderr, "Seek failed: %s\n", strerror(errno));
     return (NULL);
@@ -132,7 +180,15 @@ otf_read(_cf_fontembed_otf_file_t *otf,
     }
   }
 
-  res = fread(buf, 1, pad_len, otf->f);
+  if (otf->map)
+  {
+    res = pad_len;
+    if ((size_t)pos + pad_len > otf->mapsize)
+      res = otf->mapsize - pos;
+    memcpy(buf, otf->map + pos, res);
+  }
+  else
+    res = fread(buf, 1, pad_len, otf->f);
   if (res != pad_len)
   {
     if (res == length) // file size not multiple of 4, pad with zero
@@ -256,9 +312,10 @@ otf_do_load(_cf_fontembed_otf_file_t *otf,
   //otf->flags |= _CF_FONTEMBED_OTF_F_DO_CHECKSUM;
   // {{{ check head table
   int len = 0;
-  char *head =
-    _cfFontEmbedOTFGetTable(otf, _CF_FONTEMBED_OTF_TAG('h', 'e', 'a', 'd'),
-			    &len);
+  const char *head =
+    __cfFontEmbedOTFGetTableRef(otf,
+				_CF_FONTEMBED_OTF_TAG('h', 'e', 'a', 'd'),
+				&len);
   if ((!head) ||
       (__cfFontEmbedGetULong(head + 0) != 0x00010000) ||  // version
       (len != 54) ||
@@ -266,7 +323,7 @@ otf_do_load(_cf_fontembed_otf_file_t *otf,
       (__cfFontEmbedGetShort(head + 52) != 0x0000))   // glyphDataFormat
   {
     fprintf(stderr, "Unsupported OTF font / head table \n");
-    free(head);
+    __cfFontEmbedOTFReleaseTable(otf, head);
     _cfFontEmbedOTFClose(otf);
     return (NULL);
   }
@@ -279,29 +336,44 @@ otf_do_load(_cf_fontembed_otf_file_t *otf,
   {
     unsigned int csum = 0;
     char tmp[1024];
-    rewind(otf->f);
-    while (!feof(otf->f))
+    if (otf->map)
     {
-      len = fread(tmp, 1, 1024, otf->f);
-      if (len & 3) // zero padding reqd.
-        memset(tmp + len, 0, 4 - (len & 3));
-      csum += __cfFontEmbedOTFCheckSum(tmp, len);
+      const size_t whole = otf->mapsize & ~3;
+      csum = __cfFontEmbedOTFCheckSum(otf->map, whole);
+      if (whole < otf->mapsize) // zero padding reqd.
+      {
+        memset(tmp, 0, 4);
+        memcpy(tmp, otf->map + whole, otf->mapsize - whole);
+        csum += __cfFontEmbedOTFCheckSum(tmp, 4);
+      }
+    }
+    else
+    {
+      rewind(otf->f);
+      while (!feof(otf->f))
+      {
+	len = fread(tmp, 1, 1024, otf->f);
+	if (len & 3) // zero padding reqd.
+	  memset(tmp + len, 0, 4 - (len & 3));
+	csum += __cfFontEmbedOTFCheckSum(tmp, len);
+      }
     }
     if (csum != 0xb1b0afba)
     {
       fprintf(stderr, "Wrong global checksum\n");
-      free(head);
+      __cfFontEmbedOTFReleaseTable(otf, head);
       _cfFontEmbedOTFClose(otf);
       return (NULL);
     }
   }
   // }}}
-  free(head);
+  __cfFontEmbedOTFReleaseTable(otf, head);
 
   // {{{ read maxp table / numGlyphs
-  char *maxp =
-    _cfFontEmbedOTFGetTable(otf, _CF_FONTEMBED_OTF_TAG('m', 'a', 'x', 'p'),
-			    &len);
+  const char *maxp =
+    __cfFontEmbedOTFGetTableRef(otf,
+				_CF_FONTEMBED_OTF_TAG('m', 'a', 'x', 'p'),
+				&len);
   if (maxp)
   {
     const unsigned int maxp_version = __cfFontEmbedGetULong(maxp);
@@ -310,7 +382,7 @@ otf_do_load(_cf_fontembed_otf_file_t *otf,
       otf->numGlyphs = __cfFontEmbedGetUShort(maxp + 4);
       if ((otf->flags & _CF_FONTEMBED_OTF_F_FMT_CFF) == 0) // only CFF
       {
-        free(maxp);
+        __cfFontEmbedOTFReleaseTable(otf, maxp);
         maxp = NULL;
       }
     }
@@ -319,24 +391,24 @@ otf_do_load(_cf_fontembed_otf_file_t *otf,
       otf->numGlyphs = __cfFontEmbedGetUShort(maxp + 4);
       if (otf->flags&_CF_FONTEMBED_OTF_F_FMT_CFF) // only TTF
       {
-        free(maxp);
+        __cfFontEmbedOTFReleaseTable(otf, maxp);
         maxp = NULL;
       }
     }
     else
     {
-      free(maxp);
+      __cfFontEmbedOTFReleaseTable(otf, maxp);
       maxp = NULL;
     }
   }
   if (!maxp)
   {
     fprintf(stderr, "Unsupported OTF font / maxp table \n");
-    free(maxp);
+    __cfFontEmbedOTFReleaseTable(otf, maxp);
     _cfFontEmbedOTFClose(otf);
     return (NULL);
   }
-  free(maxp);
+  __cfFontEmbedOTFReleaseTable(otf, maxp);
   // }}}
 
   return (otf);
@@ -385,6 +457,7 @@ _cfFontEmbedOTFLoad(const char *file) // {{{
     fclose(f);
     return (NULL);
   }
+  otf_map(otf); // else fall back to stdio
 
   char buf[12];
   int pos = 0;
@@ -430,12 +503,23 @@ _cfFontEmbedOTFClose(_cf_fontembed_otf_file_t *otf) // {{{
   DEBUG_assert(otf);
   if (otf)
   {
-    free(otf->gly);
-    free(otf->cmap);
-    free(otf->name);
-    free(otf->hmtx);
+    free(otf->glybuf);
+    __cfFontEmbedOTFReleaseTable(otf, otf->cmap);
+    __cfFontEmbedOTFReleaseTable(otf, otf->name);
+    __cfFontEmbedOTFReleaseTable(otf, otf->hmtx);
     free(otf->glyphOffsets);
-    fclose(otf->f);
+    __cfFontEmbedOTFSubSetCacheFree(otf);
+    if (otf->unipages)
+    {
+      int iA;
+      for (iA = 0; iA < OTF_UNI_PAGES; iA ++)
+        free(otf->unipages[iA]);
+      free(otf->unipages);
+    }
+    if (otf->map)
+      munmap((void *)otf->map, otf->mapsize);
+    if (otf->f)
+      fclose(otf->f);
     free(otf->tables);
     free(otf);
   }
@@ -545,6 +629,52 @@ _cfFontEmbedOTFGetTable(_cf_fontembed_otf_file_t *otf,
 // }}}
 
 
+const char *
+__cfFontEmbedOTFGetTableRef(_cf_fontembed_otf_file_t *otf,
+			    unsigned int tag,
+			    int *ret_len) // {{{
+{
+  DEBUG_assert(otf);
+  DEBUG_assert(ret_len);
+
+  const int idx = __cfFontEmbedOTFFindTable(otf, tag);
+  if (idx == -1)
+  {
+    *ret_len = -1;
+    return (NULL);
+  }
+  const _cf_fontembed_otf_dir_ent_t *table = otf->tables + idx;
+
+  // like otf_read(), make the padding up to a multiple of 4 accessible;
+  // a table at the very end of the file has to be copied for that
+  if ((otf->map) &&
+      ((otf->flags & _CF_FONTEMBED_OTF_F_DO_CHECKSUM) == 0) &&
+      (table->length > 0) &&
+      ((size_t)table->offset + ((table->length + 3) & ~3) <= otf->mapsize))
+  {
+    *ret_len = table->length;
+    return (otf->map + table->offset);
+  }
+
+  return (_cfFontEmbedOTFGetTable(otf, tag, ret_len));
+}
+// }}}
+
+
+void
+__cfFontEmbedOTFReleaseTable(_cf_fontembed_otf_file_t *otf,
+			     const char *table) // {{{
+{
+  DEBUG_assert(otf);
+
+  if ((otf->map) &&
+      (table >= otf->map) && (table < otf->map + otf->mapsize))
+    return;
+  free((char *)table);
+}
+// }}}
+
+
 int
 __cfFontEmbedOTFLoadGlyf(_cf_fontembed_otf_file_t *otf) // {{{  - 0 on success
 {
@@ -562,15 +692,17 @@ __cfFontEmbedOTFLoadGlyf(_cf_fontembed_otf_file_t *otf) // {{{  - 0 on success
   // }}}
 
   // {{{ read loca table
-  char *loca =
-    _cfFontEmbedOTFGetTable(otf, _CF_FONTEMBED_OTF_TAG('l', 'o', 'c', 'a'),
-			    &len);
+  const char *loca =
+    __cfFontEmbedOTFGetTableRef(otf,
+				_CF_FONTEMBED_OTF_TAG('l', 'o', 'c', 'a'),
+				&len);
   if ((!loca) ||
       (otf->indexToLocFormat >= 2) ||
       (((len + 3) & ~3) != ((((otf->numGlyphs + 1) *
 			      (otf->indexToLocFormat + 1) * 2) +3 ) & ~3)))
   {
     fprintf(stderr, "Unsupported OTF font / loca table \n");
+    __cfFontEmbedOTFReleaseTable(otf, loca);
     return (-1);
   }
   if (otf->glyphOffsets)
@@ -594,7 +726,7 @@ __cfFontEmbedOTFLoadGlyf(_cf_fontembed_otf_file_t *otf) // {{{  - 0 on success
     for (iA = 0; iA <= otf->numGlyphs; iA ++)
       otf->glyphOffsets[iA] = __cfFontEmbedGetULong(loca + iA * 4);
   }
-  free(loca);
+  __cfFontEmbedOTFReleaseTable(otf, loca);
   if (otf->glyphOffsets[otf->numGlyphs] > otf->glyfTable->length)
   {
     fprintf(stderr, "Bad loca table \n");
@@ -602,7 +734,7 @@ __cfFontEmbedOTFLoadGlyf(_cf_fontembed_otf_file_t *otf) // {{{  - 0 on success
   }
   // }}}
 
-  // {{{ allocate otf->gly slot
+  // {{{ allocate otf->gly slot, unless glyphs can be used in place
   int maxGlyfLen = 0;  // no single glyf takes more space
   for (iA = 1; iA <= otf->numGlyphs; iA ++)
   {
@@ -615,13 +747,20 @@ __cfFontEmbedOTFLoadGlyf(_cf_fontembed_otf_file_t *otf) // {{{  - 0 on success
     if (maxGlyfLen < glyfLen)
       maxGlyfLen = glyfLen;
   }
-  if (otf->gly)
+  if ((otf->map) &&
+      ((size_t)otf->glyfTable->offset + otf->glyfTable->length <=
+       otf->mapsize))
   {
-    free(otf->gly);
+    otf->gly = otf->map + otf->glyfTable->offset;
+    return (0);
+  }
+  if (otf->glybuf)
+  {
+    free(otf->glybuf);
     DEBUG_assert(0);
   }
-  otf->gly=malloc(maxGlyfLen * sizeof(char));
-  if (!otf->gly)
+  otf->gly = otf->glybuf = malloc(maxGlyfLen * sizeof(char));
+  if (!otf->glybuf)
   {
     fprintf(stderr, "Bad alloc: %s\n", strerror(errno));
     return (-1);
@@ -646,9 +785,10 @@ __cfFontEmbedOTFLoadMore(_cf_fontembed_otf_file_t *otf)
   }
 
   // {{{ read hhea table
-  char *hhea =
-    _cfFontEmbedOTFGetTable(otf, _CF_FONTEMBED_OTF_TAG('h', 'h', 'e', 'a'),
-			    &len);
+  const char *hhea =
+    __cfFontEmbedOTFGetTableRef(otf,
+				_CF_FONTEMBED_OTF_TAG('h', 'h', 'e', 'a'),
+				&len);
   if ((!hhea) ||
       (__cfFontEmbedGetULong(hhea) != 0x00010000) || // version
       (len != 36) ||
@@ -658,13 +798,14 @@ __cfFontEmbedOTFLoadMore(_cf_fontembed_otf_file_t *otf)
     return (-1);
   }
   otf->numberOfHMetrics = __cfFontEmbedGetUShort(hhea + 34);
-  free(hhea);
+  __cfFontEmbedOTFReleaseTable(otf, hhea);
   // }}}
 
   // {{{ read hmtx table
-  char *hmtx =
-    _cfFontEmbedOTFGetTable(otf, _CF_FONTEMBED_OTF_TAG('h', 'm', 't', 'x'),
-			    &len);
+  const char *hmtx =
+    __cfFontEmbedOTFGetTableRef(otf,
+				_CF_FONTEMBED_OTF_TAG('h', 'm', 't', 'x'),
+				&len);
   if ((!hmtx) ||
       (len != otf->numberOfHMetrics * 2 + otf->numGlyphs * 2))
   {
@@ -673,16 +814,17 @@ __cfFontEmbedOTFLoadMore(_cf_fontembed_otf_file_t *otf)
   }
   if (otf->hmtx)
   {
-    free(otf->hmtx);
+    __cfFontEmbedOTFReleaseTable(otf, otf->hmtx);
     DEBUG_assert(0);
   }
   otf->hmtx = hmtx;
   // }}}
 
   // {{{ read name table
-  char *name =
-    _cfFontEmbedOTFGetTable(otf, _CF_FONTEMBED_OTF_TAG('n', 'a', 'm', 'e'),
-			    &len);
+  const char *name =
+    __cfFontEmbedOTFGetTableRef(otf,
+				_CF_FONTEMBED_OTF_TAG('n', 'a', 'm', 'e'),
+				&len);
   if ((!name) ||
       (__cfFontEmbedGetUShort(name) != 0x0000) || // version
       (len < __cfFontEmbedGetUShort(name + 2) * 12 + 6) ||
@@ -702,13 +844,13 @@ __cfFontEmbedOTFLoadMore(_cf_fontembed_otf_file_t *otf)
 	__cfFontEmbedGetUShort(nrec + 8) > len)
     {
       fprintf(stderr, "Bad name table\n");
-      free(name);
+      __cfFontEmbedOTFReleaseTable(otf, name);
       return (-1);
     }
   }
   if (otf->name)
   {
-    free(otf->name);
+    __cfFontEmbedOTFReleaseTable(otf, otf->name);
     DEBUG_assert(0);
   }
   otf->name = name;
@@ -719,15 +861,130 @@ __cfFontEmbedOTFLoadMore(_cf_fontembed_otf_file_t *otf)
 // }}}
 
 
+static int
+otf_set_unicode(_cf_fontembed_otf_file_t *otf,
+		unsigned int unicode,
+		unsigned int gid) // {{{ - 0 on success
+{
+  unsigned short *page;
+
+  if ((unicode >= OTF_UNI_MAX) || (gid == 0) || (gid > 0xffff))
+    return (0);
+
+  if ((page = otf->unipages[unicode >> 8]) == NULL)
+  {
+    page = calloc(256, sizeof(unsigned short));
+    if (!page)
+    {
+      fprintf(stderr, "Bad alloc: %s\n", strerror(errno));
+      return (-1);
+    }
+    otf->unipages[unicode >> 8] = page;
+  }
+  page[unicode & 0xff] = gid;
+
+  return (0);
+}
+// }}}
+
+
+// >end is the end of the whole cmap table: fonts exist whose format 4
+// length field is too small for their glyphIdArray
+
+static int
+otf_decode_cmap4(_cf_fontembed_otf_file_t *otf,
+		 const char *sub,
+		 const char *end) // {{{ - 0 on success
+{
+  const int segCountX2 = __cfFontEmbedGetUShort(sub + 6);
+  const char *endCode = sub + 14,
+             *startCode = endCode + segCountX2 + 2, // skip reservedPad
+             *idDelta = startCode + segCountX2,
+             *idRangeOffset = idDelta + segCountX2;
+  int iA;
+  unsigned int unicode;
+
+  if (idRangeOffset + segCountX2 > end)
+  {
+    fprintf(stderr, "Bad cmap table\n");
+    return (-1);
+  }
+
+  for (iA = 0; iA < segCountX2; iA += 2)
+  {
+    const unsigned int last = __cfFontEmbedGetUShort(endCode + iA),
+                       first = __cfFontEmbedGetUShort(startCode + iA);
+    const short delta = __cfFontEmbedGetShort(idDelta + iA);
+    const unsigned short rangeOffset =
+      __cfFontEmbedGetUShort(idRangeOffset + iA);
+
+    for (unicode = first; unicode <= last; unicode ++)
+    {
+      unsigned int gid;
+      if (rangeOffset)
+      {
+        // the so called "obscure indexing trick" into glyphIdArray[]
+        // NOTE: this is according to apple spec; microsoft says we must add
+        // delta (probably incorrect; fonts probably have delta == 0)
+        const char *pos =
+	  idRangeOffset + iA + rangeOffset + 2 * (unicode - first);
+        gid = (pos + 2 <= end) ? __cfFontEmbedGetUShort(pos) : 0;
+      }
+      else
+        gid = (delta + unicode) & 0xffff;
+      if (otf_set_unicode(otf, unicode, gid))
+        return (-1);
+    }
+  }
+
+  return (0);
+}
+// }}}
+
+
+static int
+otf_decode_cmap12(_cf_fontembed_otf_file_t *otf,
+		  const char *sub,
+		  const char *end) // {{{ - 0 on success
+{
+  const unsigned int numGroups = __cfFontEmbedGetULong(sub + 12);
+  const char *group = sub + 16;
+  unsigned int iA, unicode;
+
+  if ((end < group) || (numGroups > (unsigned int)(end - group) / 12))
+  {
+    fprintf(stderr, "Bad cmap table\n");
+    return (-1);
+  }
+
+  for (iA = 0; iA < numGroups; iA ++, group += 12)
+  {
+    const unsigned int first = __cfFontEmbedGetULong(group),
+                       gid = __cfFontEmbedGetULong(group + 8);
+    unsigned int last = __cfFontEmbedGetULong(group + 4);
+    if (last >= OTF_UNI_MAX)
+      last = OTF_UNI_MAX - 1;
+    for (unicode = first; unicode <= last; unicode ++)
+      if (otf_set_unicode(otf, unicode, gid + (unicode - first)))
+        return (-1);
+  }
+
+  return (0);
+}
+// }}}
+
+
 static int
 otf_load_cmap(_cf_fontembed_otf_file_t *otf) // {{{  - 0 on success
 {
   int iA;
   int len;
+  const char *unimap12 = NULL; // (3, 10) or (0, 4) in format 12
 
-  char *cmap =
-    _cfFontEmbedOTFGetTable(otf, _CF_FONTEMBED_OTF_TAG('c', 'm', 'a', 'p'),
-			    &len);
+  const char *cmap =
+    __cfFontEmbedOTFGetTableRef(otf,
+				_CF_FONTEMBED_OTF_TAG('c', 'm', 'a', 'p'),
+				&len);
   if ((!cmap) ||
       (__cfFontEmbedGetUShort(cmap) != 0x0000) || // version
       (len < __cfFontEmbedGetUShort(cmap + 2) * 8 + 4))
@@ -748,7 +1005,7 @@ otf_load_cmap(_cf_fontembed_otf_file_t *otf) // {{{  - 0 on success
 	(offset + __cfFontEmbedGetUShort(ndata + 2) > len))
     {
       fprintf(stderr, "Bad cmap table\n");
-      free(cmap);
+      __cfFontEmbedOTFReleaseTable(otf, cmap);
       DEBUG_assert(0);
       return (-1);
     }
@@ -757,14 +1014,46 @@ otf_load_cmap(_cf_fontembed_otf_file_t *otf) // {{{  - 0 on success
 	(__cfFontEmbedGetUShort(ndata) == 4) &&
 	(__cfFontEmbedGetUShort(ndata + 4) == 0))
       otf->unimap = ndata;
+    else if ((((__cfFontEmbedGetUShort(nrec) == 3) &&
+	       (__cfFontEmbedGetUShort(nrec + 2) == 10)) ||
+	      ((__cfFontEmbedGetUShort(nrec) == 0) &&
+	       (__cfFontEmbedGetUShort(nrec + 2) == 4))) &&
+	     (__cfFontEmbedGetUShort(ndata) == 12) &&
+	     ((unsigned int)len - offset >= 16) &&
+	     (__cfFontEmbedGetULong(ndata + 4) >= 16) &&
+	     (__cfFontEmbedGetULong(ndata + 4) <= (unsigned int)len - offset))
+      unimap12 = ndata; // offset < len was checked above, no overflow
   }
   if (otf->cmap)
   {
-    free(otf->cmap);
+    __cfFontEmbedOTFReleaseTable(otf, otf->cmap);
     DEBUG_assert(0);
   }
   otf->cmap = cmap;
 
+  // {{{ decode the full Unicode map, if there is one, else the BMP one
+  if ((!unimap12) && (!otf->unimap))
+  {
+    fprintf(stderr, "Unicode (3, 10) cmap in format 12 or (3, 1) cmap in "
+	    "format 4 not found\n");
+    return (0);
+  }
+  otf->unipages = calloc(OTF_UNI_PAGES, sizeof(unsigned short *));
+  if (!otf->unipages)
+  {
+    fprintf(stderr, "Bad alloc: %s\n", strerror(errno));
+    return (-1);
+  }
+  if (unimap12)
+  {
+    if (otf_decode_cmap12(otf, unimap12,
+			  unimap12 + __cfFontEmbedGetULong(unimap12 + 4)))
+      return (-1);
+  }
+  else if (otf_decode_cmap4(otf, otf->unimap, cmap + len))
+    return (-1);
+  // }}}
+
   return (0);
 }
 // }}}
@@ -885,8 +1174,10 @@ _cfFontEmbedOTFGetGlyph(_cf_fontembed_otf_file_t *otf,
     return (0);
 
   DEBUG_assert(otf->glyfTable->length >= otf->glyphOffsets[gid + 1]);
-  if (!otf_read(otf, otf->gly,
-                otf->glyfTable->offset + otf->glyphOffsets[gid], len))
+  if (!otf->glybuf) // mapped
+    otf->gly = otf->map + otf->glyfTable->offset + otf->glyphOffsets[gid];
+  else if (!otf_read(otf, otf->glybuf,
+		     otf->glyfTable->offset + otf->glyphOffsets[gid], len))
     return (-1);
 
   return (len);
@@ -899,11 +1190,10 @@ _cfFontEmbedOTFFromUnicode(_cf_fontembed_otf_file_t *otf,
 			   int unicode) // {{{ 0 = missing
 {
   DEBUG_assert(otf);
-  DEBUG_assert((unicode >= 0) && (unicode < 65536));
   //DEBUG_assert((otf->flags & _CF_FONTEMBED_OTF_F_FMT_CFF) == 0);
                                            // not for CFF, other method!
 
-  // ensure >cmap and >unimap is there
+  // ensure >cmap and >unipages is there
   if (!otf->cmap)
   {
     if (otf_load_cmap(otf) != 0)
@@ -912,48 +1202,11 @@ _cfFontEmbedOTFFromUnicode(_cf_fontembed_otf_file_t *otf,
       return (0); // TODO?
     }
   }
-  if (!otf->unimap)
-  {
-    fprintf(stderr, "Unicode (3, 1) cmap in format 4 not found\n");
-    return (0);
-  }
 
-#if 0
-  // linear search is cache friendly and should be quite fast
-#else
-  const unsigned short segCountX2 = __cfFontEmbedGetUShort(otf->unimap + 6);
-  char target[] = {unicode >> 8, unicode};
-                                   // __cfFontEmbedSetUShort(target, unicode);
-  char *result = otf_bsearch((char *)otf->unimap + 14, target, 2,
-			     __cfFontEmbedGetUShort(otf->unimap + 8),
-			     __cfFontEmbedGetUShort(otf->unimap + 10),
-			     __cfFontEmbedGetUShort(otf->unimap + 12), 1);
-  if (result >= otf->unimap + 14 + segCountX2) // outside of endCode[segCount]
-  {
-    DEBUG_assert(0); // bad font, no 0xffff sentinel
+  if ((unicode < 0) || (unicode >= OTF_UNI_MAX) ||
+      (!otf->unipages) || (!otf->unipages[unicode >> 8]))
     return (0);
-  }
-
-  result += 2 + segCountX2; // jump over padding into startCode[segCount]
-  const unsigned short startCode = __cfFontEmbedGetUShort(result);
-  if (startCode > unicode)
-    return (0);
-  result += 2 * segCountX2;
-  const unsigned short rangeOffset = __cfFontEmbedGetUShort(result);
-  if (rangeOffset)
-  {
-    return (__cfFontEmbedGetUShort(result + rangeOffset +
-				   2 * (unicode-startCode)));
-                 // the so called "obscure indexing trick" into glyphIdArray[]
-    // NOTE: this is according to apple spec; microsoft says we must add
-    // delta (probably incorrect; fonts probably have delta == 0)
-  }
-  else
-  {
-    const short delta = __cfFontEmbedGetShort(result - segCountX2);
-    return (delta + unicode) & 0xffff;
-  }
-#endif // 0
+  return (otf->unipages[unicode >> 8][unicode & 0xff]);
 }
 // }}}
 
@@ -974,13 +1227,20 @@ __cfFontEmbedOTFActionCopy(void *param,
     return (table->length);
   }
 
+  int ret = (table->length + 3) & ~3;
+  if ((otf->map) && ((size_t)table->offset + ret <= otf->mapsize))
+  {
+    // single output straight from the mapping
+    (*output)(otf->map + table->offset, ret, context);
+    return (ret); // padded length
+  }
+
   // TODO? copy_block(otf->f, table->offset, (table->length + 3) & ~3, output,
   //                  context);
   // problem: PS currently depends on single-output. Also checksum not possible
   char *data = otf_read(otf, NULL, table->offset, table->length);
   if (!data)
     return (-1);
-  int ret = (table->length + 3) & ~3;
   (*output)(data, ret, context);
   free(data);
   return (ret); // padded length
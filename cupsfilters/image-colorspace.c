@@ -18,6 +18,11 @@
 //   cfImageCMYKToRGB()           - Convert CMYK colors to device-dependent
 //                                  RGB.
 //   cfImageCMYKToWhite()         - Convert CMYK colors to luminance.
+//   _cfImageConvDelete()         - Free a color conversion pipeline.
+//   _cfImageConvIsIdentity()     - Check whether a conversion leaves the
+//                                  pixels unchanged.
+//   _cfImageConvNew()            - Create a color conversion pipeline.
+//   _cfImageConvRow()            - Convert a row of pixels.
 //   cfImageLut()                 - Adjust all pixel values with the given
 //                                  LUT.
 //   cfImageRGBAdjust()           - Adjust the hue and saturation of the
@@ -36,6 +41,8 @@
 //   cfImageWhiteToRGB()          - Convert luminance data to RGB.
 //   cfImageWhiteToWhite()        - Convert luminance colors to device-
 //                                  dependent luminance.
+//   adjust_lut()                 - Build the hue/saturation lookup tables.
+//   adjust_pixels()              - Apply the hue/saturation lookup tables.
 //   cie_lab()                    - Map CIE Lab transformation...
 //   hue_rotate()                 - Rotate the hue, maintaining luminance.
 //   ident()                      - Make an identity matrix.
@@ -89,6 +96,29 @@
 typedef int cups_clut_t[3][256];
 
 
+//
+// Number of pixels converted per pipeline stage, small enough for the
+// intermediate pixels to stay in the L1 cache...
+//
+
+#define CF_ICONV_BLOCK	256
+
+
+//
+// Color conversion pipeline...
+//
+
+struct cf_iconv_s
+{
+  int		indepth,		// Bytes per input pixel
+		outdepth;		// Bytes per output pixel
+  void		(*convert)(const cf_ib_t *in, cf_ib_t *out, int count);
+					// Colorspace conversion, NULL to copy
+  cups_clut_t	*adjust;		// Hue/saturation LUT, NULL for none
+  const cf_ib_t	*lut;			// Gamma/brightness LUT, NULL for none
+};
+
+
 //
 // Local globals...
 //
@@ -107,6 +137,8 @@ static cups_cspace_t	cfImageColorSpace = CUPS_CSPACE_RGB;
 // Local functions...
 //
 
+static void	adjust_lut(cups_clut_t *lut, int saturation, int hue);
+static void	adjust_pixels(cups_clut_t *lut, cf_ib_t *pixels, int count);
 static float	cie_lab(float x, float xn);
 static void	hue_rotate(float [3][3], float);
 static void	ident(float [3][3]);
@@ -466,6 +498,251 @@ cfImageCMYKToWhite(
 }
 
 
+//
+// '_cfImageConvDelete()' - Free a color conversion pipeline.
+//
+
+void
+_cfImageConvDelete(cf_iconv_t *conv)	// I - Conversion pipeline
+{
+  if (!conv)
+    return;
+
+  free(conv->adjust);
+  free(conv);
+}
+
+
+//
+// '_cfImageConvIsIdentity()' - Check whether a conversion leaves the
+//                              pixels unchanged.
+//
+// This is the case if the pipeline _cfImageConvNew() creates for the
+// same arguments neither adjusts nor converts the pixels, nor applies a
+// LUT.  RGB to RGB goes through the device profile when one is set.
+//
+
+int					// O - 1 if identity, 0 otherwise
+_cfImageConvIsIdentity(
+    cf_icspace_t  incolorspace,		// I - Colorspace of input pixels
+    cf_icspace_t  outcolorspace,	// I - Colorspace of output pixels
+    int           saturation,		// I - Color saturation (%)
+    int           hue,			// I - Color hue (degrees)
+    const cf_ib_t *lut)			// I - Gamma/brightness LUT or NULL
+{
+  if (outcolorspace == CF_IMAGE_RGB_CMYK)
+    outcolorspace = CF_IMAGE_RGB;
+
+  if (lut || incolorspace != outcolorspace)
+    return (0);
+
+  switch (incolorspace)
+  {
+    case CF_IMAGE_WHITE :
+        return (1);
+
+    case CF_IMAGE_RGB :
+        return (saturation == 100 && hue == 0 && !cfImageHaveProfile);
+
+    default :
+        return (0);
+  }
+}
+
+
+//
+// '_cfImageConvNew()' - Create a color conversion pipeline.
+//
+// The pipeline combines the hue/saturation adjustment of RGB input, the
+// conversion into the image colorspace (including the device profile set
+// with cfImageSetProfile()) and the gamma/brightness LUT.  The stage
+// functions and tables are looked up once here instead of for every row.
+//
+
+cf_iconv_t *				// O - Conversion pipeline or NULL
+_cfImageConvNew(
+    cf_icspace_t  incolorspace,		// I - Colorspace of input pixels
+    cf_icspace_t  outcolorspace,	// I - Colorspace of output pixels
+    int           saturation,		// I - Color saturation (%)
+    int           hue,			// I - Color hue (degrees)
+    const cf_ib_t *lut)			// I - Gamma/brightness LUT or NULL
+{
+  cf_iconv_t	*conv;			// New pipeline
+
+
+  if (outcolorspace == CF_IMAGE_RGB_CMYK)
+    outcolorspace = CF_IMAGE_RGB;
+
+  if ((conv = calloc(1, sizeof(cf_iconv_t))) == NULL)
+    return (NULL);
+
+  conv->indepth  = abs((int)incolorspace);
+  conv->outdepth = abs((int)outcolorspace);
+  conv->lut      = lut;
+
+  switch (incolorspace)
+  {
+    case CF_IMAGE_WHITE :
+        switch (outcolorspace)
+	{
+	  case CF_IMAGE_BLACK :
+	      conv->convert = cfImageWhiteToBlack;
+	      break;
+	  case CF_IMAGE_RGB :
+	      conv->convert = cfImageWhiteToRGB;
+	      break;
+	  case CF_IMAGE_CMY :
+	      conv->convert = cfImageWhiteToCMY;
+	      break;
+	  case CF_IMAGE_CMYK :
+	      conv->convert = cfImageWhiteToCMYK;
+	      break;
+	  default :
+	      break;
+	}
+	break;
+
+    case CF_IMAGE_RGB :
+        if (saturation != 100 || hue != 0)
+	{
+	  if ((conv->adjust = calloc(3, sizeof(cups_clut_t))) == NULL)
+	  {
+	    free(conv);
+	    return (NULL);
+	  }
+
+	  adjust_lut(conv->adjust, saturation, hue);
+	}
+
+        switch (outcolorspace)
+	{
+	  case CF_IMAGE_WHITE :
+	      conv->convert = cfImageRGBToWhite;
+	      break;
+	  case CF_IMAGE_BLACK :
+	      conv->convert = cfImageRGBToBlack;
+	      break;
+	  case CF_IMAGE_RGB :
+	      conv->convert = cfImageRGBToRGB;
+	      break;
+	  case CF_IMAGE_CMY :
+	      conv->convert = cfImageRGBToCMY;
+	      break;
+	  case CF_IMAGE_CMYK :
+	      conv->convert = cfImageRGBToCMYK;
+	      break;
+	  default :
+	      break;
+	}
+	break;
+
+    case CF_IMAGE_CMYK :
+        switch (outcolorspace)
+	{
+	  case CF_IMAGE_WHITE :
+	      conv->convert = cfImageCMYKToWhite;
+	      break;
+	  case CF_IMAGE_BLACK :
+	      conv->convert = cfImageCMYKToBlack;
+	      break;
+	  case CF_IMAGE_RGB :
+	      conv->convert = cfImageCMYKToRGB;
+	      break;
+	  case CF_IMAGE_CMY :
+	      conv->convert = cfImageCMYKToCMY;
+	      break;
+	  default :
+	      break;
+	}
+	break;
+
+    default :
+        break;
+  }
+
+  if (!conv->convert && conv->indepth != conv->outdepth)
+  {
+    // Unsupported conversion...
+    _cfImageConvDelete(conv);
+    return (NULL);
+  }
+
+  return (conv);
+}
+
+
+//
+// '_cfImageConvRow()' - Convert a row of pixels.
+//
+// The row is processed in blocks of CF_ICONV_BLOCK pixels which go
+// through all stages of the pipeline before the next block is started,
+// so every pixel is fetched from memory only once.  The input pixels are
+// not modified.
+//
+
+void
+_cfImageConvRow(cf_iconv_t    *conv,	// I - Conversion pipeline
+		const cf_ib_t *in,	// I - Input pixels
+		cf_ib_t       *out,	// O - Output pixels
+		int           count)	// I - Number of pixels
+{
+  int		n;			// Pixels in current block
+  const cf_ib_t	*src;			// Input of colorspace conversion
+  cf_ib_t	temp[CF_ICONV_BLOCK * 3];// Adjusted RGB pixels
+
+
+  if (!conv->adjust && !conv->convert)
+  {
+    //
+    // Same colorspace, just apply the LUT while copying...
+    //
+
+    count *= conv->indepth;
+
+    if (conv->lut)
+    {
+      const cf_ib_t *lut = conv->lut;	// Gamma/brightness LUT
+
+      while (count > 0)
+      {
+        *out++ = lut[*in++];
+	count --;
+      }
+    }
+    else if (in != out)
+      memcpy(out, in, count);
+
+    return;
+  }
+
+  while (count > 0)
+  {
+    n = count > CF_ICONV_BLOCK ? CF_ICONV_BLOCK : count;
+
+    if (conv->adjust)
+    {
+      memcpy(temp, in, n * 3);
+      adjust_pixels(conv->adjust, temp, n);
+      src = temp;
+    }
+    else
+      src = in;
+
+    if (conv->convert)
+      (*conv->convert)(src, out, n);
+    else if (src != out)
+      memcpy(out, src, n * conv->outdepth);
+
+    if (conv->lut)
+      cfImageLut(out, n * conv->outdepth, conv->lut);
+
+    in    += n * conv->indepth;
+    out   += n * conv->outdepth;
+    count -= n;
+  }
+}
+
+
 //
 // 'cfImageLut()' - Adjust all pixel values with the given LUT.
 //
@@ -494,8 +771,6 @@ cfImageRGBAdjust(cf_ib_t   *pixels,	// IO - Input/output pixels
 		 int       saturation,	// I - Color saturation (%)
 		 int       hue)		// I - Color hue (degrees)
 {
-  int			i, j, k;	// Looping vars
-  float			mat[3][3];	// Color adjustment matrix
   static int		last_sat = 100,	// Last saturation used
 			last_hue = 0;	// Last hue used
   static cups_clut_t	*lut = NULL;	// Lookup table for matrix
@@ -503,14 +778,6 @@ cfImageRGBAdjust(cf_ib_t   *pixels,	// IO - Input/output pixels
 
   if (saturation != last_sat || hue != last_hue || !lut)
   {
-    //
-    // Build the color adjustment matrix...
-    //
-
-    ident(mat);
-    saturate(mat, saturation * 0.01);
-    hue_rotate(mat, (float)hue);
-
     //
     // Allocate memory for the lookup table...
     //
@@ -521,14 +788,7 @@ cfImageRGBAdjust(cf_ib_t   *pixels,	// IO - Input/output pixels
     if (lut == NULL)
       return;
 
-    //
-    // Convert the matrix into a 3x3 array of lookup tables...
-    //
-
-    for (i = 0; i < 3; i ++)
-      for (j = 0; j < 3; j ++)
-        for (k = 0; k < 256; k ++)
-          lut[i][j][k] = mat[i][j] * k + 0.5;
+    adjust_lut(lut, saturation, hue);
 
     //
     // Save the saturation and hue to compare later...
@@ -538,45 +798,7 @@ cfImageRGBAdjust(cf_ib_t   *pixels,	// IO - Input/output pixels
     last_hue = hue;
   }
 
-  //
-  // Adjust each pixel in the given buffer.
-  //
-
-  while (count > 0)
-  {
-    i = lut[0][0][pixels[0]] +
-        lut[1][0][pixels[1]] +
-        lut[2][0][pixels[2]];
-    if (i < 0)
-      pixels[0] = 0;
-    else if (i > 255)
-      pixels[0] = 255;
-    else
-      pixels[0] = i;
-
-    i = lut[0][1][pixels[0]] +
-        lut[1][1][pixels[1]] +
-        lut[2][1][pixels[2]];
-    if (i < 0)
-      pixels[1] = 0;
-    else if (i > 255)
-      pixels[1] = 255;
-    else
-      pixels[1] = i;
-
-    i = lut[0][2][pixels[0]] +
-        lut[1][2][pixels[1]] +
-        lut[2][2][pixels[2]];
-    if (i < 0)
-      pixels[2] = 0;
-    else if (i > 255)
-      pixels[2] = 255;
-    else
-      pixels[2] = i;
-
-    count --;
-    pixels += 3;
-  }
+  adjust_pixels(lut, pixels, count);
 }
 
 
@@ -1113,6 +1335,88 @@ cfImageWhiteToWhite(
 }
 
 
+//
+// 'adjust_lut()' - Build the hue/saturation lookup tables.
+//
+
+static void
+adjust_lut(cups_clut_t *lut,		// O - Lookup tables
+	   int         saturation,	// I - Color saturation (%)
+	   int         hue)		// I - Color hue (degrees)
+{
+  int		i, j, k;		// Looping vars
+  float		mat[3][3];		// Color adjustment matrix
+
+
+  //
+  // Build the color adjustment matrix...
+  //
+
+  ident(mat);
+  saturate(mat, saturation * 0.01);
+  hue_rotate(mat, (float)hue);
+
+  //
+  // Convert the matrix into a 3x3 array of lookup tables...
+  //
+
+  for (i = 0; i < 3; i ++)
+    for (j = 0; j < 3; j ++)
+      for (k = 0; k < 256; k ++)
+        lut[i][j][k] = mat[i][j] * k + 0.5;
+}
+
+
+//
+// 'adjust_pixels()' - Apply the hue/saturation lookup tables.
+//
+
+static void
+adjust_pixels(cups_clut_t *lut,		// I  - Lookup tables
+	      cf_ib_t     *pixels,	// IO - Input/output pixels
+	      int         count)	// I  - Number of pixels to adjust
+{
+  int		i;			// Adjusted value
+
+
+  while (count > 0)
+  {
+    i = lut[0][0][pixels[0]] +
+        lut[1][0][pixels[1]] +
+        lut[2][0][pixels[2]];
+    if (i < 0)
+      pixels[0] = 0;
+    else if (i > 255)
+      pixels[0] = 255;
+    else
+      pixels[0] = i;
+
+    i = lut[0][1][pixels[0]] +
+        lut[1][1][pixels[1]] +
+        lut[2][1][pixels[2]];
+    if (i < 0)
+      pixels[1] = 0;
+    else if (i > 255)
+      pixels[1] = 255;
+    else
+      pixels[1] = i;
+
+    i = lut[0][2][pixels[0]] +
+        lut[1][2][pixels[1]] +
+        lut[2][2][pixels[2]];
+    if (i < 0)
+      pixels[2] = 0;
+    else if (i > 255)
+      pixels[2] = 255;
+    else
+      pixels[2] = i;
+
+    count --;
+    pixels += 3;
+  }
+}
+
+
 //
 // 'cie_lab()' - Map CIE Lab transformation...
 //
@@ -11,6 +11,8 @@
 //   _cfIsJPEGXL()                          - Check if the file header indicates JPEG‑XL format.
 //   _cfImageReadJPEGXL()                   - Read a JPEG‑XL image file using libjxl and fill a 
 //                                            cf_image_t structure.
+//   jxl_put_pixels()                       - Convert decoded pixels and put them into the image.
+//   jxl_threads()                          - Get the number of decoder threads to use.
 //
 
 
@@ -25,9 +27,45 @@
 #include "image-jpeg-xl-private.h"
 #include <jxl/decode.h>
 #include <jxl/types.h>
+#include <jxl/thread_parallel_runner.h>
 #include <stdlib.h>
 #include <string.h>
 #include <inttypes.h>  // For PRIu64 
+#ifdef HAVE_PTHREAD_H
+#  include <pthread.h>
+#endif // HAVE_PTHREAD_H
+
+
+//
+// Constants...
+//
+
+#define JXL_CHUNK 256			// Pixels converted at a time in callback
+
+
+//
+// Types...
+//
+
+typedef struct jxl_sink_s		// Decoded pixel sink
+{
+  cf_image_t	*img;			// Image
+  cf_iconv_t	*conv;			// Color conversion pipeline
+  int		channels,		// Channels in decoded pixels
+		alpha;			// Decoded pixels have alpha?
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_t mutex;		// Lock for the image tile cache
+#endif // HAVE_PTHREAD_H
+} jxl_sink_t;
+
+
+//
+// Local functions...
+//
+
+static void	jxl_put_pixels(void *opaque, size_t x, size_t y,
+			       size_t num_pixels, const void *pixels);
+static size_t	jxl_threads(void);
 
 
 //
@@ -70,6 +108,8 @@ _cfImageReadJPEGXL( cf_image_t      *img,
   uint8_t *jxl_data = NULL;
   long jxl_size;
   size_t bytes_read;
+  void *runner = NULL;			// Parallel runner, if any
+  size_t threads = jxl_threads();	// Number of decoder threads
 
   //
   // Read entire file into memory
@@ -100,10 +140,32 @@ _cfImageReadJPEGXL( cf_image_t      *img,
     return 1;
   }
 
+  //
+  // Decode on several threads if we can; the callback may then be
+  // called concurrently for different parts of the image.  libjxl only
+  // accepts a runner before decoding starts...
+  //
+
+#ifdef HAVE_PTHREAD_H
+  if (threads > 1 &&
+      (runner = JxlThreadParallelRunnerCreate(NULL, threads)) != NULL &&
+      JxlDecoderSetParallelRunner(dec, JxlThreadParallelRunner,
+				  runner) != JXL_DEC_SUCCESS)
+  {
+    DEBUG_puts("DEBUG: Unable to use JXL parallel runner.\n");
+    JxlThreadParallelRunnerDestroy(runner);
+    runner = NULL;
+  }
+#else
+  (void)threads;
+#endif // HAVE_PTHREAD_H
+
   status = JxlDecoderSubscribeEvents(dec, JXL_DEC_BASIC_INFO | JXL_DEC_FULL_IMAGE);
   if (status != JXL_DEC_SUCCESS)
   {
     JxlDecoderDestroy(dec);
+    if (runner)
+      JxlThreadParallelRunnerDestroy(runner);
     free(jxl_data);
     fclose(fp);
     return 1;
@@ -119,6 +181,8 @@ _cfImageReadJPEGXL( cf_image_t      *img,
   if (status != JXL_DEC_BASIC_INFO)
   {
     JxlDecoderDestroy(dec);
+    if (runner)
+      JxlThreadParallelRunnerDestroy(runner);
     free(jxl_data);
     fclose(fp);
     return 1;
@@ -127,6 +191,8 @@ _cfImageReadJPEGXL( cf_image_t      *img,
   if (JxlDecoderGetBasicInfo(dec, &info) != JXL_DEC_SUCCESS)
   {
     JxlDecoderDestroy(dec);
+    if (runner)
+      JxlThreadParallelRunnerDestroy(runner);
     free(jxl_data);
     fclose(fp);
     return 1;
@@ -145,6 +211,8 @@ _cfImageReadJPEGXL( cf_image_t      *img,
     DEBUG_printf(("DEBUG: JXL image has invalid dimensions %ux%u!\n",
                   (unsigned)img->xsize, (unsigned)img->ysize));
     JxlDecoderDestroy(dec);
+    if (runner)
+      JxlThreadParallelRunnerDestroy(runner);
     free(jxl_data);
     fclose(fp);
     return 1;
@@ -186,158 +254,152 @@ _cfImageReadJPEGXL( cf_image_t      *img,
   format.endianness = JXL_NATIVE_ENDIAN;
   format.align = 0;
 
-  size_t buffer_size;
-  if (JxlDecoderImageOutBufferSize(dec, &format, &buffer_size) != JXL_DEC_SUCCESS)
+  //
+  // Set up the color conversion; the decoder hands the pixels to
+  // jxl_put_pixels() which converts them straight into the image, so the
+  // decoded image is never buffered as a whole...
+  //
+  
+  jxl_sink_t sink;
+  sink.img      = img;
+  sink.channels = format.num_channels;
+  sink.alpha    = info.alpha_bits > 0;
+  sink.conv     = _cfImageConvNew(info.num_color_channels == 3 ?
+				  CF_IMAGE_RGB : CF_IMAGE_WHITE,
+				  img->colorspace, saturation, hue, lut);
+  if (!sink.conv)
   {
     JxlDecoderDestroy(dec);
+    if (runner)
+      JxlThreadParallelRunnerDestroy(runner);
     free(jxl_data);
     fclose(fp);
     return 1;
   }
 
-  uint8_t *pixels = (uint8_t*)malloc(buffer_size);
-  if (!pixels)
-  {
-    JxlDecoderDestroy(dec);
-    free(jxl_data);
-    fclose(fp);
-    return 1;
-  }
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_init(&sink.mutex, NULL);
+#endif // HAVE_PTHREAD_H
 
-  if (JxlDecoderSetImageOutBuffer(dec, &format, pixels, buffer_size) != JXL_DEC_SUCCESS)
-  {
-    free(pixels);
-    JxlDecoderDestroy(dec);
-    free(jxl_data);
-    fclose(fp);
-    return 1;
-  }
+  DEBUG_printf(("DEBUG: Decoding JXL image with %d thread(s).\n",
+		runner ? (int)threads : 1));
 
-  //
-  // Process to get the full image
-  //
-  
-  status = JxlDecoderProcessInput(dec);
-  if (status != JXL_DEC_FULL_IMAGE)
+  if (JxlDecoderSetImageOutCallback(dec, &format, jxl_put_pixels,
+				    &sink) != JXL_DEC_SUCCESS)
+    status = JXL_DEC_ERROR;
+  else
   {
-    free(pixels);
-    JxlDecoderDestroy(dec);
-    free(jxl_data);
-    fclose(fp);
-    return 1;
+    //
+    // Process to get the full image
+    //
+
+    status = JxlDecoderProcessInput(dec);
   }
 
   //
-  // Handle alpha blending with white background
+  // Cleanup
   //
   
-  if (info.alpha_bits > 0)
+  JxlDecoderDestroy(dec);
+  if (runner)
+    JxlThreadParallelRunnerDestroy(runner);
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_destroy(&sink.mutex);
+#endif // HAVE_PTHREAD_H
+  _cfImageConvDelete(sink.conv);
+  free(jxl_data);
+  fclose(fp);
+
+  return (status == JXL_DEC_FULL_IMAGE ? 0 : 1);
+}
+
+
+//
+// jxl_put_pixels() - Convert decoded pixels and put them into the image.
+// Pixels with alpha are blended onto a white background first.  Called by
+// libjxl for (parts of) rows, possibly from several threads at once.
+//
+
+static void
+jxl_put_pixels(void       *opaque,	// I - Pixel sink
+               size_t     x,		// I - Start column
+               size_t     y,		// I - Row
+               size_t     num_pixels,	// I - Number of pixels
+               const void *pixels)	// I - Decoded pixels
+{
+  jxl_sink_t *sink = (jxl_sink_t *)opaque;
+  const uint8_t *in = (const uint8_t *)pixels;
+  cf_ib_t rgb[JXL_CHUNK * 3],		// Pixels without alpha
+	  out[JXL_CHUNK * 4];		// Converted pixels
+  int colors = sink->channels - sink->alpha;
+  int count;
+
+
+  while (num_pixels > 0)
   {
-    int channels = format.num_channels;
-    size_t pixel_count = img->xsize * img->ysize;
-    for (size_t i = 0; i < pixel_count; i++)
+    count = num_pixels > JXL_CHUNK ? JXL_CHUNK : (int)num_pixels;
+
+    if (sink->alpha)
     {
-      uint8_t *pixel = pixels + i * channels;
-      uint8_t alpha = pixel[channels - 1];
-      if (alpha != 255)
+      //
+      // Blend with white background and drop the alpha channel
+      //
+
+      const uint8_t *pixel = in;
+      cf_ib_t *rgbptr = rgb;
+      for (int i = 0; i < count; i++, pixel += sink->channels)
       {
-        float ratio = alpha / 255.0f;
-        for (int c = 0; c < channels - 1; c++)
+        uint8_t alpha = pixel[colors];
+        if (alpha != 255)
+        {
+          float ratio = alpha / 255.0f;
+          for (int c = 0; c < colors; c++)
+            *rgbptr++ = (uint8_t)(pixel[c] * ratio + 255 * (1.0f - ratio) + 0.5f);
+        }
+        else
         {
-          pixel[c] = (uint8_t)(pixel[c] * ratio + 255 * (1.0f - ratio) + 0.5f);
+          for (int c = 0; c < colors; c++)
+            *rgbptr++ = pixel[c];
         }
-        pixel[channels - 1] = 255;
       }
-    }
-  }
 
-  //
-  // Process each row for colorspace conversion and LUT
-  //
-  
-  int bpp = cfImageGetDepth(img);
-  cf_ib_t *out = (cf_ib_t*)calloc(img->xsize * bpp, sizeof(cf_ib_t));
-  if (!out)
-  {
-    free(pixels);
-    JxlDecoderDestroy(dec);
-    free(jxl_data);
-    fclose(fp);
-    return 1;
+      _cfImageConvRow(sink->conv, rgb, out, count);
+    }
+    else
+      _cfImageConvRow(sink->conv, in, out, count);
+
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_lock(&sink->mutex);
+#endif // HAVE_PTHREAD_H
+    _cfImagePutRow(sink->img, (int)x, (int)y, count, out);
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_unlock(&sink->mutex);
+#endif // HAVE_PTHREAD_H
+
+    in         += count * sink->channels;
+    x          += count;
+    num_pixels -= count;
   }
+}
 
-  for (int y = 0; y < img->ysize; y++)
-  {
-    uint8_t *row = pixels + y * img->xsize * format.num_channels;
 
-    if (info.num_color_channels == 3)
-    {                  // RGB(A) Image
-      if (saturation != 100 || hue != 0)
-      {
-        cfImageRGBAdjust(row, img->xsize, saturation, hue);
-      }
-
-      switch (img->colorspace)
-      {
-        case CF_IMAGE_WHITE:
-          cfImageRGBToWhite(row, out, img->xsize);
-          break;
-        case CF_IMAGE_RGB:
-        case CF_IMAGE_RGB_CMYK:
-          cfImageRGBToRGB(row, out, img->xsize);
-          break;
-        case CF_IMAGE_BLACK:
-          cfImageRGBToBlack(row, out, img->xsize);
-          break;
-        case CF_IMAGE_CMY:
-          cfImageRGBToCMY(row, out, img->xsize);
-          break;
-        case CF_IMAGE_CMYK:
-          cfImageRGBToCMYK(row, out, img->xsize);
-          break;
-      }
-    } 
-    else
-    {                                              // Grayscale Image
-      switch (img->colorspace)
-      {
-        case CF_IMAGE_WHITE:
-          memcpy(out, row, img->xsize);
-          break;
-        case CF_IMAGE_RGB:
-        case CF_IMAGE_RGB_CMYK:
-          cfImageWhiteToRGB(row, out, img->xsize);
-          break;
-        case CF_IMAGE_BLACK:
-          cfImageWhiteToBlack(row, out, img->xsize);
-          break;
-        case CF_IMAGE_CMY:
-          cfImageWhiteToCMY(row, out, img->xsize);
-          break;
-        case CF_IMAGE_CMYK:
-          cfImageWhiteToCMYK(row, out, img->xsize);
-          break;
-      }
-    }
-
-    if (lut)
-    {
-      cfImageLut(out, img->xsize * bpp, lut);
-    }
+//
+// jxl_threads() - Get the number of decoder threads to use.
+// This is the number of CPUs unless limited by the RIP_MAX_THREADS
+// environment variable.
+//
 
-    _cfImagePutRow(img, 0, y, img->xsize, out);
-  }
+static size_t
+jxl_threads(void)
+{
+  size_t threads = JxlThreadParallelRunnerDefaultNumWorkerThreads();
+  const char *env;
+  int max_threads;
 
-  //
-  // Cleanup
-  //
-  
-  free(out);
-  free(pixels);
-  JxlDecoderDestroy(dec);
-  free(jxl_data);
-  fclose(fp);
+  if ((env = getenv("RIP_MAX_THREADS")) != NULL &&
+      (max_threads = atoi(env)) > 0 && (size_t)max_threads < threads)
+    threads = (size_t)max_threads;
 
-  return 0;
+  return threads;
 }
 #endif // HAVE_LIBJXL
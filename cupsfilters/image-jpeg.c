@@ -72,6 +72,7 @@ _cfImageReadJPEG(
   cf_image_jpeg_err_t	jerr;		// Error handler with jmp_buf
   cf_ib_t		*volatile in = NULL,	// Input pixels
 			*volatile out = NULL;	// Output pixels
+  cf_iconv_t		*volatile conv = NULL;	// Color conversion
   jpeg_saved_marker_ptr	marker;		// Pointer to marker data
   int			psjpeg = 0;	// Non-zero if Photoshop CMYK JPEG
   static const char	*cspaces[] =
@@ -105,6 +106,7 @@ _cfImageReadJPEG(
   {
     free(in);
     free(out);
+    _cfImageConvDelete(conv);
     jpeg_destroy_decompress(&cinfo);
     fclose(fp);
     return (1);
@@ -250,6 +252,22 @@ _cfImageReadJPEG(
     return (1);
   }
 
+  if ((conv = _cfImageConvNew(cinfo.out_color_space == JCS_GRAYSCALE ?
+			      CF_IMAGE_WHITE :
+			      cinfo.out_color_space == JCS_CMYK ?
+			      CF_IMAGE_CMYK : CF_IMAGE_RGB,
+			      img->colorspace, saturation, hue, lut)) == NULL)
+  {
+    DEBUG_printf("DEBUG: Not enough memory.");
+
+    jpeg_destroy_decompress(&cinfo);
+
+    free(in);
+    free(out);
+    fclose(fp);
+    return (1);
+  }
+
   jpeg_start_decompress(&cinfo);
 
   while (cinfo.output_scanline < cinfo.output_height)
@@ -270,123 +288,13 @@ _cfImageReadJPEG(
         *ptr = 255 - *ptr;
     }
 
-    if ((saturation != 100 || hue != 0) && cinfo.output_components == 3)
-      cfImageRGBAdjust(in, img->xsize, saturation, hue);
-
-    if ((img->colorspace == CF_IMAGE_WHITE && cinfo.out_color_space == JCS_GRAYSCALE) ||
-	(img->colorspace == CF_IMAGE_CMYK && cinfo.out_color_space == JCS_CMYK))
-    {
-#ifdef DEBUG
-      int	i, j;
-      cf_ib_t	*ptr;
-
-
-      DEBUG_puts("DEBUG: Direct Data...\n");
-
-      DEBUG_puts("DEBUG:");
-
-      for (i = 0, ptr = in; i < img->xsize; i ++)
-      {
-        DEBUG_puts(" ");
-	for (j = 0; j < cinfo.output_components; j ++, ptr ++)
-	  DEBUG_printf(("%02X", *ptr & 255));
-      }
-
-      DEBUG_puts("\n");
-#endif // DEBUG
-
-      if (lut)
-        cfImageLut(in, img->xsize * cfImageGetDepth(img), lut);
-
-      _cfImagePutRow(img, 0, cinfo.output_scanline - 1, img->xsize, in);
-    }
-    else if (cinfo.out_color_space == JCS_GRAYSCALE)
-    {
-      switch (img->colorspace)
-      {
-        default :
-	    break;
-
-        case CF_IMAGE_BLACK :
-            cfImageWhiteToBlack(in, out, img->xsize);
-            break;
-        case CF_IMAGE_RGB :
-            cfImageWhiteToRGB(in, out, img->xsize);
-            break;
-        case CF_IMAGE_CMY :
-            cfImageWhiteToCMY(in, out, img->xsize);
-            break;
-        case CF_IMAGE_CMYK :
-            cfImageWhiteToCMYK(in, out, img->xsize);
-            break;
-      }
-
-      if (lut)
-        cfImageLut(out, img->xsize * cfImageGetDepth(img), lut);
-
-      _cfImagePutRow(img, 0, cinfo.output_scanline - 1, img->xsize, out);
-    }
-    else if (cinfo.out_color_space == JCS_RGB)
-    {
-      switch (img->colorspace)
-      {
-        default :
-	    break;
-
-        case CF_IMAGE_RGB :
-            cfImageRGBToRGB(in, out, img->xsize);
-	    break;
-        case CF_IMAGE_WHITE :
-            cfImageRGBToWhite(in, out, img->xsize);
-            break;
-        case CF_IMAGE_BLACK :
-            cfImageRGBToBlack(in, out, img->xsize);
-            break;
-        case CF_IMAGE_CMY :
-            cfImageRGBToCMY(in, out, img->xsize);
-            break;
-        case CF_IMAGE_CMYK :
-            cfImageRGBToCMYK(in, out, img->xsize);
-            break;
-      }
-
-      if (lut)
-        cfImageLut(out, img->xsize * cfImageGetDepth(img), lut);
-
-      _cfImagePutRow(img, 0, cinfo.output_scanline - 1, img->xsize, out);
-    }
-    else // JCS_CMYK
-    {
-      DEBUG_puts("DEBUG: JCS_CMYK\n");
-
-      switch (img->colorspace)
-      {
-        default :
-	    break;
-
-        case CF_IMAGE_WHITE :
-            cfImageCMYKToWhite(in, out, img->xsize);
-            break;
-        case CF_IMAGE_BLACK :
-            cfImageCMYKToBlack(in, out, img->xsize);
-            break;
-        case CF_IMAGE_CMY :
-            cfImageCMYKToCMY(in, out, img->xsize);
-            break;
-        case CF_IMAGE_RGB :
-            cfImageCMYKToRGB(in, out, img->xsize);
-            break;
-      }
-
-      if (lut)
-        cfImageLut(out, img->xsize * cfImageGetDepth(img), lut);
-
-      _cfImagePutRow(img, 0, cinfo.output_scanline - 1, img->xsize, out);
-    }
+    _cfImageConvRow(conv, in, out, img->xsize);
+    _cfImagePutRow(img, 0, cinfo.output_scanline - 1, img->xsize, out);
   }
 
   free(in);
   free(out);
+  _cfImageConvDelete(conv);
 
   jpeg_finish_decompress(&cinfo);
   jpeg_destroy_decompress(&cinfo);
@@ -77,12 +77,23 @@ _cfImageReadPNG(
 		filter_type;		// Filter type
   png_uint_32	xppm,			// X pixels per meter
 		yppm;			// Y pixels per meter
-  int		bpp;			// Bytes per pixel
+  int		bpp,			// Bytes per pixel
+		inbpp,			// Bytes per PNG pixel
+		copy;			// Use PNG pixels without conversion?
+  cf_icspace_t	incs;			// PNG colorspace
   int		pass,			// Current pass
 		passes;			// Number of passes required
+  int		x,			// Looping var
+		x0,			// First column of pass
+		xstep,			// Column increment of pass
+		ystep,			// Row increment of pass
+		cols;			// Columns in pass
   cf_ib_t	* volatile in = NULL;	// Input pixels (volatile for setjmp)
-  cf_ib_t	*inptr;			// Pointer into pixels
   cf_ib_t	* volatile out = NULL;	// Output pixels (volatile for setjmp)
+  cf_ib_t	* volatile row = NULL;	// Image row (volatile for setjmp)
+  const cf_ib_t	*pixels;		// Pixels to output
+  cf_ib_t	*rowptr;		// Pointer into image row
+  cf_iconv_t	* volatile conv = NULL;	// Color conversion pipeline
   png_color_16	bg;			// Background color
 
 
@@ -122,6 +133,8 @@ _cfImageReadPNG(
   {
     free(in);
     free(out);
+    free(row);
+    _cfImageConvDelete(conv);
     png_destroy_read_struct(&pp, &info, NULL);
     fclose(fp);
     return (1);
@@ -208,7 +221,13 @@ _cfImageReadPNG(
 
   cfImageSetMaxTiles(img, 0);
 
-  passes = png_set_interlace_handling(pp);
+  //
+  // Interlaced images are read pass by pass without libpng's interlace
+  // handling, which would need the whole image in memory; the pixels of
+  // each pass are scattered into the image tile cache instead...
+  //
+
+  passes = interlace_type == PNG_INTERLACE_ADAM7 ? 7 : 1;
 
   //
   // Handle transparency...
@@ -223,60 +242,33 @@ _cfImageReadPNG(
 
   png_set_background(pp, &bg, PNG_BACKGROUND_GAMMA_SCREEN, 0, 1.0);
 
-  if (passes == 1)
-  {
-    //
-    // Load one row at a time...
-    //
-
-    if (color_type == PNG_COLOR_TYPE_GRAY ||
-	color_type == PNG_COLOR_TYPE_GRAY_ALPHA)
-      in = malloc(img->xsize);
-    else
-      in = malloc(img->xsize * 3);
-  }
-  else
-  {
-    //
-    // Interlaced images must be loaded all at once...
-    //
-
-    size_t bufsize;			// Size of buffer
-
+  //
+  // Allocate memory for one row, and for the color conversion unless the
+  // PNG pixels already are what the image wants...
+  //
 
-    if (color_type == PNG_COLOR_TYPE_GRAY ||
-	color_type == PNG_COLOR_TYPE_GRAY_ALPHA)
-    {
-      bufsize = img->xsize * img->ysize;
+  incs  = (color_type & PNG_COLOR_MASK_COLOR) ? CF_IMAGE_RGB :
+                                                CF_IMAGE_WHITE;
+  bpp   = cfImageGetDepth(img);
+  inbpp = incs == CF_IMAGE_RGB ? 3 : 1;
+  in    = malloc(img->xsize * inbpp);
 
-      if ((bufsize / img->xsize) != img->ysize)
-      {
-	DEBUG_printf(("DEBUG: PNG image dimensions (%ux%u) too large!\n",
-		      (unsigned)width, (unsigned)height));
-	fclose(fp);
-	return (1);
-      }
-    }
-    else
-    {
-      bufsize = img->xsize * img->ysize * 3;
-
-      if ((bufsize / (img->xsize * 3)) != img->ysize)
-      {
-	DEBUG_printf(("DEBUG: PNG image dimensions (%ux%u) too large!\n",
-		      (unsigned)width, (unsigned)height));
-	fclose(fp);
-	return (1);
-      }
-    }
+  copy  = _cfImageConvIsIdentity(incs, img->colorspace,
+				 bpp > 1 ? saturation : 100, bpp > 1 ? hue : 0,
+				 lut);
 
-    in = malloc(bufsize);
+  if (!copy)
+  {
+    out  = (cf_ib_t*)calloc(img->xsize * bpp, sizeof(cf_ib_t));
+    conv = _cfImageConvNew(incs, img->colorspace,
+			   bpp > 1 ? saturation : 100, bpp > 1 ? hue : 0,
+			   lut);
   }
 
-  bpp = cfImageGetDepth(img);
-  out = (cf_ib_t*)calloc(img->xsize * bpp, sizeof(cf_ib_t));
+  if (passes > 1)
+    row = (cf_ib_t*)calloc(img->xsize * bpp, sizeof(cf_ib_t));
 
-  if (!in || !out)
+  if (!in || (!copy && (!out || !conv)) || (passes > 1 && !row))
   {
     DEBUG_puts("DEBUG: Unable to allocate memory for PNG image!\n");
 
@@ -286,88 +278,83 @@ _cfImageReadPNG(
     if (out)
       free(out);
 
+    if (row)
+      free(row);
+
+    _cfImageConvDelete(conv);
+
+    png_destroy_read_struct(&pp, &info, NULL);
     fclose(fp);
 
     return (1);
   }
 
   //
-  // Read the image, interlacing as needed...
+  // Read the image, one pass at a time for interlaced images...
   //
 
-  for (pass = 1; pass <= passes; pass ++)
-    for (inptr = in, y = 0; y < img->ysize; y ++)
+  for (pass = 0; pass < passes; pass ++)
+  {
+    if (passes == 1)
+    {
+      cols  = img->xsize;
+      x0    = 0;
+      xstep = 1;
+      y     = 0;
+      ystep = 1;
+    }
+    else
+    {
+      //
+      // libpng skips empty passes...
+      //
+
+      if (PNG_PASS_COLS(width, pass) == 0 || PNG_PASS_ROWS(height, pass) == 0)
+        continue;
+
+      cols  = (int)PNG_PASS_COLS(width, pass);
+      x0    = PNG_PASS_START_COL(pass);
+      xstep = 1 << PNG_PASS_COL_SHIFT(pass);
+      y     = PNG_PASS_START_ROW(pass);
+      ystep = 1 << PNG_PASS_ROW_SHIFT(pass);
+    }
+
+    for (; y < img->ysize; y += ystep)
     {
-      png_read_row(pp, (png_bytep)inptr, NULL);
+      png_read_row(pp, (png_bytep)in, NULL);
 
-      if (pass == passes)
+      if (!copy)
       {
-	//
-	// Output this row...
+	_cfImageConvRow(conv, in, out, cols);
+	pixels = out;
+      }
+      else
+        pixels = in;
+
+      if (xstep == 1)
+      {
+        //
+	// Full row, output it as-is...
 	//
 
-	if (color_type & PNG_COLOR_MASK_COLOR)
-	{
-	  if ((saturation != 100 || hue != 0) && bpp > 1)
-	    cfImageRGBAdjust(inptr, img->xsize, saturation, hue);
-
-	  switch (img->colorspace)
-	  {
-	    case CF_IMAGE_WHITE :
-		cfImageRGBToWhite(inptr, out, img->xsize);
-		break;
-	    case CF_IMAGE_RGB :
-	    case CF_IMAGE_RGB_CMYK :
-		cfImageRGBToRGB(inptr, out, img->xsize);
-		break;
-	    case CF_IMAGE_BLACK :
-		cfImageRGBToBlack(inptr, out, img->xsize);
-		break;
-	    case CF_IMAGE_CMY :
-		cfImageRGBToCMY(inptr, out, img->xsize);
-		break;
-	    case CF_IMAGE_CMYK :
-		cfImageRGBToCMYK(inptr, out, img->xsize);
-		break;
-	  }
-	}
-	else
-	{
-	  switch (img->colorspace)
-	  {
-	    case CF_IMAGE_WHITE :
-		memcpy(out, inptr, img->xsize);
-		break;
-	    case CF_IMAGE_RGB :
-	    case CF_IMAGE_RGB_CMYK :
-		cfImageWhiteToRGB(inptr, out, img->xsize);
-		break;
-	    case CF_IMAGE_BLACK :
-		cfImageWhiteToBlack(inptr, out, img->xsize);
-		break;
-	    case CF_IMAGE_CMY :
-		cfImageWhiteToCMY(inptr, out, img->xsize);
-		break;
-	    case CF_IMAGE_CMYK :
-		cfImageWhiteToCMYK(inptr, out, img->xsize);
-		break;
-	  }
-	}
-
-	if (lut)
-	  cfImageLut(out, img->xsize * bpp, lut);
-
-	_cfImagePutRow(img, 0, y, img->xsize, out);
+	_cfImagePutRow(img, 0, y, img->xsize, pixels);
       }
-
-      if (passes > 1)
+      else
       {
-	if (color_type & PNG_COLOR_MASK_COLOR)
-          inptr += img->xsize * 3;
-	else
-          inptr += img->xsize;
+        //
+	// Merge the pixels of this pass into the row...
+	//
+
+	cfImageGetRow(img, 0, y, img->xsize, row);
+
+	for (x = 0, rowptr = row + x0 * bpp; x < cols;
+	     x ++, rowptr += xstep * bpp, pixels += bpp)
+	  memcpy(rowptr, pixels, bpp);
+
+	_cfImagePutRow(img, 0, y, img->xsize, row);
       }
     }
+  }
 
   png_read_end(pp, info);
   png_destroy_read_struct(&pp, &info, NULL);
@@ -375,6 +362,8 @@ _cfImageReadPNG(
   fclose(fp);
   free(in);
   free(out);
+  free(row);
+  _cfImageConvDelete(conv);
 
   return (0);
 }
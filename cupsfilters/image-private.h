@@ -34,6 +34,9 @@
 #  endif // WIN32
 #  include <errno.h>
 #  include <math.h>	
+#  ifdef HAVE_PTHREAD_H
+#    include <pthread.h>
+#  endif // HAVE_PTHREAD_H
 
 #ifdef HAVE_EXIF
 #	include <libexif/exif-data.h>
@@ -82,6 +85,8 @@ typedef enum cf_iztype_e		// **** Image zoom type ****
   CF_IZOOM_BEST				// Use bicubic interpolation
 } cf_iztype_t;
 
+typedef struct cf_iconv_s cf_iconv_t;	// **** Color conversion pipeline ****
+
 struct cf_ic_s;
 
 typedef struct cf_itile_s		// **** Image tile ****
@@ -145,7 +150,19 @@ struct cf_izoom_s			// **** Image zoom data ****
 			row,		// Current row
 			yflip;		// Y backwards/upside-down
   cf_ib_t		*rows[2],	// Horizontally scaled pixel data
-			*in;		// Unscaled input pixel data
+			*in,		// Unscaled input pixel data
+			*tmp;		// Scratch row for vertical prefilter
+  int			xtaps,		// Number of filter taps per output
+					// pixel
+			ytaps,		// Number of rows in vertical prefilter
+			*xindex,	// Input byte offset of each X tap
+			*acc;		// Vertical prefilter accumulator
+  short			*xweight,	// 2.14 fixed-point weight of each X tap
+			*yweight;	// 2.14 fixed-point weight of each Y tap
+#  ifdef HAVE_PTHREAD_H
+  pthread_mutex_t	*lock;		// Lock for image shared between
+					// threads, NULL if none
+#  endif // HAVE_PTHREAD_H
 };
 
 
@@ -153,6 +170,17 @@ struct cf_izoom_s			// **** Image zoom data ****
 // Prototypes...
 //
 
+extern void		_cfImageConvDelete(cf_iconv_t *conv);
+extern int		_cfImageConvIsIdentity(cf_icspace_t incolorspace,
+					       cf_icspace_t outcolorspace,
+					       int saturation, int hue,
+					       const cf_ib_t *lut);
+extern cf_iconv_t	*_cfImageConvNew(cf_icspace_t incolorspace,
+					 cf_icspace_t outcolorspace,
+					 int saturation, int hue,
+					 const cf_ib_t *lut);
+extern void		_cfImageConvRow(cf_iconv_t *conv, const cf_ib_t *in,
+					cf_ib_t *out, int count);
 extern int		_cfImagePutCol(cf_image_t *img, int x, int y,
 				       int height, const cf_ib_t *pixels);
 extern int		_cfImagePutRow(cf_image_t *img, int x, int y,
@@ -10,6 +10,9 @@
 // Contents:
 //
 //   _cfImageReadTIFF() - Read a TIFF image file.
+//   tiff_put_row()     - Convert a row of 8-bit samples and store it in the
+//                        image.
+//   tiff_read_blocks() - Read a TIFF image a strip or tile at a time.
 //
 
 //
@@ -24,6 +27,44 @@
 #  include <unistd.h>
 
 
+//
+// Constants...
+//
+
+#  define TIFF_MAX_STRIP	(16 * 1024 * 1024)
+					// Largest strip to decode at once
+
+
+//
+// Types...
+//
+
+typedef struct tiff_rows_s		// **** Row conversion state ****
+{
+  cf_image_t	*img;			// Image
+  cf_iconv_t	*conv;			// Color conversion pipeline
+  int		samples,		// Samples per input pixel
+		invert,			// Invert gray samples (min-is-white)?
+		alpha,			// Input has alpha?
+		cmyk_rgb,		// Convert CMYK to RGB first?
+		xdir,			// X direction
+		depth;			// Depth of converted input pixels
+  cf_ib_t	*in,			// Converted input pixels
+		*out;			// Output pixels
+} tiff_rows_t;
+
+
+//
+// Local functions...
+//
+
+static void	tiff_put_row(tiff_rows_t *rows, const cf_ib_t *src, int y);
+static int	tiff_read_blocks(cf_image_t *img, TIFF *tif,
+				 uint16_t photometric, int samples, int bits,
+				 int alpha, int xdir, int ystart, int ydir,
+				 int saturation, int hue, const cf_ib_t *lut);
+
+
 //
 // '_cfImageReadTIFF()' - Read a TIFF image file.
 //
@@ -48,7 +89,9 @@ _cfImageReadTIFF(
 		samples,		// Number of samples/pixel
 		bits,			// Number of bits/pixel
 		inkset,			// Ink set for color separations
-		numinks;		// Number of inks in set
+		numinks,		// Number of inks in set
+		num_extras,		// Number of extra samples
+		*extras;		// Types of extra samples
   float		xres,			// Horizontal resolution
 		yres;			// Vertical resolution
   uint16_t	*redcmap,		// Red colormap information
@@ -65,7 +108,9 @@ _cfImageReadTIFF(
 		pstep,			// Pixel step (= bpp or -2 * bpp)
 		scanwidth,		// Width of scanline
 		r, g, b, k,		// Red, green, blue, and black values
-		alpha;			// Image includes alpha?
+		colors,			// Color samples per pixel
+		alpha,			// Image includes alpha?
+		status;			// Status of strip/tile reader
   cf_ib_t	*in,			// Input buffer
 		*out,			// Output buffer
 		*p,			// Pointer into buffer
@@ -204,11 +249,24 @@ _cfImageReadTIFF(
   }
 
   //
-  // See if the image has an alpha channel...
+  // See if the image has an alpha channel, samples beyond that are
+  // skipped...
   //
 
+  if (photometric == PHOTOMETRIC_RGB)
+    colors = 3;
+  else if (photometric == PHOTOMETRIC_SEPARATED)
+    colors = 4;
+  else
+    colors = 1;
+
   if (samples == 2 || (samples == 4 && photometric == PHOTOMETRIC_RGB))
     alpha = 1;
+  else if (samples > colors &&
+	   TIFFGetField(tif, TIFFTAG_EXTRASAMPLES, &num_extras, &extras) &&
+	   num_extras > 0 && (extras[0] == EXTRASAMPLE_ASSOCALPHA ||
+			      extras[0] == EXTRASAMPLE_UNASSALPHA))
+    alpha = 1;
   else
     alpha = 0;
 
@@ -216,8 +274,7 @@ _cfImageReadTIFF(
   // Check whether number of samples per pixel corresponds with color space
   //
 
-  if ((photometric == PHOTOMETRIC_RGB && (samples < 3 || samples > 4)) ||
-      (photometric == PHOTOMETRIC_SEPARATED && samples != 4))
+  if (samples < colors)
   {
     fprintf(stderr, "DEBUG: Number of samples per pixel does not correspond to color space! "
                     "Color space: %s; Samples per pixel: %d\n",
@@ -236,7 +293,7 @@ _cfImageReadTIFF(
   if (width == 0 || width > CF_IMAGE_MAX_WIDTH ||
       height == 0 || height > CF_IMAGE_MAX_HEIGHT ||
       (bits != 1 && bits != 2 && bits != 4 && bits != 8) ||
-      samples < 1 || samples > 4)
+      samples < 1)
   {
     DEBUG_printf(("DEBUG: Bad TIFF dimensions %ux%ux%ux%u!\n",
 		  (unsigned)width, (unsigned)height, (unsigned)bits,
@@ -342,6 +399,33 @@ _cfImageReadTIFF(
         break;
   }
 
+  //
+  // 8-bit and tiled images are read a strip or tile at a time...
+  //
+
+  if ((status = tiff_read_blocks(img, tif, photometric, samples, bits,
+				 alpha, xdir, ystart, ydir, saturation, hue,
+				 lut)) <= 0)
+  {
+    TIFFClose(tif);
+    if (status < 0)
+      fclose(fp);
+    return (status);
+  }
+
+  //
+  // The scanline reader only knows the alpha channel as extra sample...
+  //
+
+  if (samples > 4 || (photometric == PHOTOMETRIC_SEPARATED && samples != 4))
+  {
+    DEBUG_printf(("DEBUG: Unsupported TIFF with %u samples per pixel!\n",
+		  (unsigned)samples));
+    TIFFClose(tif);
+    fclose(fp);
+    return (-1);
+  }
+
   //
   // Allocate a scanline buffer...
   //
@@ -1793,4 +1877,380 @@ _cfImageReadTIFF(
   TIFFClose(tif);
   return (0);
 }
+
+
+//
+// 'tiff_put_row()' - Convert a row of 8-bit samples and store it in the
+//                    image.
+//
+
+static void
+tiff_put_row(tiff_rows_t   *rows,	// I - Row conversion state
+	     const cf_ib_t *src,	// I - Row of samples
+	     int           y)		// I - Image row
+{
+  int		count = rows->img->xsize,
+					// Pixels left
+		pstep,			// Step between converted pixels
+		i,			// Looping var
+		a,			// Alpha value
+		white,			// White value of samples
+		r, g, b, k;		// Red, green, blue, and black values
+  cf_ib_t	*p;			// Pointer into converted pixels
+
+
+  if (!rows->invert && !rows->alpha && !rows->cmyk_rgb && rows->xdir > 0 &&
+      rows->samples == rows->depth)
+  {
+    //
+    // The samples can be converted as they are...
+    //
+
+    _cfImageConvRow(rows->conv, src, rows->out, count);
+    _cfImagePutRow(rows->img, 0, y, count, rows->out);
+    return;
+  }
+
+  if (rows->xdir > 0)
+  {
+    p     = rows->in;
+    pstep = rows->depth;
+  }
+  else
+  {
+    p     = rows->in + (count - 1) * rows->depth;
+    pstep = -rows->depth;
+  }
+
+  if (rows->cmyk_rgb)
+  {
+    //
+    // Simple CMYK to RGB conversion, as in the scanline reader...
+    //
+
+    for (; count > 0; count --, p += pstep, src += rows->samples)
+    {
+      k = src[3];
+      r = 255 - src[0] - k;
+      g = 255 - src[1] - k;
+      b = 255 - src[2] - k;
+
+      if (r < 0)
+        r = 0;
+      if (g < 0)
+        g = 0;
+      if (b < 0)
+        b = 0;
+
+      if (rows->alpha)
+      {
+        a = src[4];
+	r = (r * a + 255 * (255 - a)) / 255;
+	g = (g * a + 255 * (255 - a)) / 255;
+	b = (b * a + 255 * (255 - a)) / 255;
+      }
+
+      p[0] = r;
+      p[1] = g;
+      p[2] = b;
+    }
+  }
+  else if (rows->depth == 1)
+  {
+    for (; count > 0; count --, p += pstep, src += rows->samples)
+    {
+      k = rows->invert ? 255 - src[0] : src[0];
+
+      if (rows->alpha)
+      {
+        a = src[1];
+	k = (a * k + (255 - a) * 255) / 255;
+      }
+
+      *p = k;
+    }
+  }
+  else if (rows->alpha)
+  {
+    //
+    // Composite onto white, which is 0 for CMYK...
+    //
+
+    white = rows->depth == 4 ? 0 : 255;
+
+    for (; count > 0; count --, p += pstep, src += rows->samples)
+    {
+      a = src[rows->depth];
+      for (i = 0; i < rows->depth; i ++)
+        p[i] = (src[i] * a + white * (255 - a)) / 255;
+    }
+  }
+  else
+  {
+    //
+    // Copy the color samples, skipping any extra samples...
+    //
+
+    for (; count > 0; count --, p += pstep, src += rows->samples)
+      memcpy(p, src, rows->depth);
+  }
+
+  _cfImageConvRow(rows->conv, rows->in, rows->out, rows->img->xsize);
+  _cfImagePutRow(rows->img, 0, y, rows->img->xsize, rows->out);
+}
+
+
+//
+// 'tiff_read_blocks()' - Read a TIFF image a strip or tile at a time.
+//
+// 8-bit gray, RGB and CMYK images, with or without alpha and other extra
+// samples, are decoded a whole strip or tile at a time and go through the
+// color conversion pipeline directly, without the per-photometric
+// scanline code.  Tiled images in other formats are read with libtiff's
+// RGBA tile reader, which handles all photometrics and bit depths.  Tiled
+// images cannot be read a scanline at a time at all.
+//
+
+static int				// O - 0 on success, -1 on error,
+					//     1 if not handled
+tiff_read_blocks(
+    cf_image_t    *img,			// I - Image
+    TIFF          *tif,			// I - TIFF file
+    uint16_t      photometric,		// I - Colorspace
+    int           samples,		// I - Samples per pixel
+    int           bits,			// I - Bits per sample
+    int           alpha,		// I - Image includes alpha?
+    int           xdir,			// I - X direction
+    int           ystart,		// I - Starting y
+    int           ydir,			// I - Y direction
+    int           saturation,		// I - Color saturation (%)
+    int           hue,			// I - Color hue (degrees)
+    const cf_ib_t *lut)			// I - Gamma/brightness LUT
+{
+  tiff_rows_t	rows;			// Row conversion state
+  cf_icspace_t	incolorspace;		// Colorspace of converted pixels
+  int		tiled = TIFFIsTiled(tif),
+					// Image is tiled?
+		rgba = 0,		// Use the RGBA tile reader?
+		scanlines = 0,		// Read strips a scanline at a time?
+		status = 0;		// Return status
+  uint16_t	inkset = INKSET_CMYK,	// Ink set for color separations
+		numinks = 4;		// Number of inks in set
+  uint32_t	tw, th,			// Tile or strip size
+		row, col,		// Current row and column
+		r, n,			// Rows in tile and looping var
+		width = (uint32_t)img->xsize,
+		height = (uint32_t)img->ysize;
+					// Size of image
+  tmsize_t	rowbytes,		// Bytes per row of samples
+		tilebytes;		// Bytes per row of a tile
+  cf_ib_t	*block = NULL,		// Decoded strip, or row of tiles
+		*tile = NULL;		// Decoded tile
+  uint32_t	*raster,		// Pointer into RGBA tile
+		pixel;			// RGBA pixel
+  char		emsg[1024];		// Error message from libtiff
+
+
+  memset(&rows, 0, sizeof(rows));
+
+  rows.img     = img;
+  rows.samples = samples;
+  rows.alpha   = alpha;
+  rows.xdir    = xdir;
+
+  if (photometric == PHOTOMETRIC_SEPARATED)
+  {
+#ifdef TIFFTAG_NUMBEROFINKS
+    if (!TIFFGetField(tif, TIFFTAG_INKSET, &inkset))
+      TIFFGetField(tif, TIFFTAG_NUMBEROFINKS, &numinks);
+#else
+    TIFFGetField(tif, TIFFTAG_INKSET, &inkset);
+#endif // TIFFTAG_NUMBEROFINKS
+  }
+
+  if (bits == 8 &&
+      (photometric == PHOTOMETRIC_MINISWHITE ||
+       photometric == PHOTOMETRIC_MINISBLACK))
+  {
+    incolorspace = CF_IMAGE_WHITE;
+    rows.invert  = photometric == PHOTOMETRIC_MINISWHITE;
+  }
+  else if (bits == 8 && photometric == PHOTOMETRIC_RGB)
+    incolorspace = CF_IMAGE_RGB;
+  else if (bits == 8 && photometric == PHOTOMETRIC_SEPARATED &&
+	   (inkset == INKSET_CMYK || numinks == 4))
+  {
+    if (img->colorspace == CF_IMAGE_CMYK)
+      incolorspace = CF_IMAGE_CMYK;
+    else
+    {
+      incolorspace  = CF_IMAGE_RGB;
+      rows.cmyk_rgb = 1;
+    }
+  }
+  else if (tiled && xdir > 0 && ydir > 0 && TIFFRGBAImageOK(tif, emsg))
+  {
+    //
+    // The RGBA reader delivers 8-bit RGB pixels with alpha...
+    //
+
+    incolorspace = CF_IMAGE_RGB;
+    rgba         = 1;
+    rows.samples = 3;
+    rows.alpha   = 0;
+  }
+  else
+    return (1);
+
+  DEBUG_printf(("DEBUG: Reading TIFF %s%s\n", tiled ? "tiles" : "strips",
+		rgba ? " as RGBA" : ""));
+
+  rows.depth = abs((int)incolorspace);
+
+  //
+  // Setup the color conversion, the scanline reader did not apply the
+  // LUT to CMYK images...
+  //
+
+  if ((rows.conv = _cfImageConvNew(incolorspace, img->colorspace,
+				   saturation, hue,
+				   incolorspace == CF_IMAGE_CMYK ? NULL :
+								   lut)) == NULL)
+    return (1);
+
+  if ((rows.in = calloc(width, rows.depth)) == NULL ||
+      (rows.out = calloc(width, cfImageGetDepth(img))) == NULL)
+  {
+    status = -1;
+    goto done;
+  }
+
+  if (tiled)
+  {
+    TIFFGetField(tif, TIFFTAG_TILEWIDTH, &tw);
+    TIFFGetField(tif, TIFFTAG_TILELENGTH, &th);
+  }
+  else
+  {
+    tw = width;
+    TIFFGetFieldDefaulted(tif, TIFFTAG_ROWSPERSTRIP, &th);
+    if (th > height)
+      th = height;
+
+    //
+    // Don't buffer huge strips (often the whole image is one strip),
+    // read those a scanline at a time...
+    //
+
+    if (th > 1 && (tmsize_t)th * width * samples > TIFF_MAX_STRIP)
+    {
+      scanlines = 1;
+      th        = 1;
+    }
+  }
+
+  if (tw == 0 || th == 0)
+  {
+    status = 1;
+    goto done;
+  }
+
+  rowbytes  = rgba ? (tmsize_t)width * 3 : (tmsize_t)width * samples;
+  tilebytes = rgba ? (tmsize_t)tw * 4 : (tmsize_t)tw * samples;
+
+  if ((block = calloc(th, rowbytes)) == NULL ||
+      (tiled && (tile = _TIFFmalloc(rgba ? tilebytes * th :
+					   TIFFTileSize(tif))) == NULL))
+  {
+    status = -1;
+    goto done;
+  }
+
+  //
+  // Decode a strip or a row of tiles at a time...
+  //
+
+  for (row = 0; row < height; row += th)
+  {
+    r = height - row < th ? height - row : th;
+
+    if (scanlines)
+    {
+      if (TIFFReadScanline(tif, block, row, 0) < 0)
+        DEBUG_printf(("DEBUG: Unable to read row %u.\n", (unsigned)row));
+    }
+    else if (!tiled)
+    {
+      if (TIFFReadEncodedStrip(tif, TIFFComputeStrip(tif, row, 0), block,
+			       r * rowbytes) < 0)
+        DEBUG_printf(("DEBUG: Unable to read strip at row %u.\n",
+		      (unsigned)row));
+    }
+    else
+    {
+      for (col = 0; col < width; col += tw)
+      {
+        tmsize_t bytes = (width - col < tw ? width - col : tw) *
+	                 (rgba ? 3 : samples);
+					// Bytes of tile row in image
+
+        if (rgba)
+	{
+	  //
+	  // The RGBA tile is stored bottom-up; composite onto white...
+	  //
+
+	  if (!TIFFReadRGBATile(tif, col, row, (uint32_t *)tile))
+	    memset(tile, 255, tilebytes * th);
+
+	  for (n = 0; n < r; n ++)
+	  {
+	    cf_ib_t	*p = block + n * rowbytes + col * 3;
+					// Pointer into row
+	    tmsize_t	i;		// Looping var
+	    int		a;		// Alpha value
+
+	    raster = (uint32_t *)tile + (th - 1 - n) * tw;
+
+	    for (i = bytes; i > 0; i -= 3, p += 3)
+	    {
+	      pixel = *raster++;
+	      a     = TIFFGetA(pixel);
+	      p[0]  = (TIFFGetR(pixel) * a + 255 * (255 - a)) / 255;
+	      p[1]  = (TIFFGetG(pixel) * a + 255 * (255 - a)) / 255;
+	      p[2]  = (TIFFGetB(pixel) * a + 255 * (255 - a)) / 255;
+	    }
+	  }
+	}
+	else
+	{
+	  if (TIFFReadTile(tif, tile, col, row, 0, 0) < 0)
+	    DEBUG_printf(("DEBUG: Unable to read tile at %ux%u.\n",
+			  (unsigned)col, (unsigned)row));
+
+	  for (n = 0; n < r; n ++)
+	    memcpy(block + n * rowbytes + col * samples,
+		   tile + n * tilebytes, bytes);
+	}
+      }
+    }
+
+    for (n = 0; n < r; n ++)
+      tiff_put_row(&rows, block + n * rowbytes,
+		   ystart + (int)(row + n) * ydir);
+  }
+
+  done:
+
+  if (status < 0)
+    DEBUG_puts("DEBUG: No enough memory.\n");
+
+  _TIFFfree(tile);
+  free(block);
+  free(rows.in);
+  free(rows.out);
+  _cfImageConvDelete(rows.conv);
+
+  return (status);
+}
 #endif // HAVE_LIBTIFF
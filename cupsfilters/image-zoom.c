@@ -12,8 +12,14 @@
 //   _cfImageZoomDelete()   - Free a zoom record...
 //   _cfImageZoomFill()     - Fill a zoom record...
 //   _cfImageZoomNew()      - Allocate a pixel zoom record...
+//   zoom_bicubic()         - Fill a zoom record with image data utilizing
+//                            bicubic interpolation.
 //   zoom_bilinear()        - Fill a zoom record with image data utilizing
 //                            bilinear interpolation.
+//   zoom_cubic()           - Evaluate the bicubic filter kernel.
+//   zoom_filter()          - Precompute the filter taps of a zoom record.
+//   zoom_get_row()         - Read an unscaled row from the image.
+//   zoom_horizontal()      - Scale the current input row horizontally.
 //   zoom_nearest()         - Fill a zoom record quickly using nearest-neighbor
 //                            sampling.
 
@@ -28,7 +34,12 @@
 // Local functions...
 //
 
+static void	zoom_bicubic(cf_izoom_t *z, int iy);
 static void	zoom_bilinear(cf_izoom_t *z, int iy);
+static double	zoom_cubic(double x);
+static int	zoom_filter(cf_izoom_t *z, int flip);
+static void	zoom_get_row(cf_izoom_t *z, int iy);
+static void	zoom_horizontal(cf_izoom_t *z, cf_ib_t *r);
 static void	zoom_nearest(cf_izoom_t *z, int iy);
 
 
@@ -42,6 +53,11 @@ _cfImageZoomDelete(cf_izoom_t *z)	// I - Zoom record to free
   free(z->rows[0]);
   free(z->rows[1]);
   free(z->in);
+  free(z->tmp);
+  free(z->xindex);
+  free(z->xweight);
+  free(z->yweight);
+  free(z->acc);
   free(z);
 }
 
@@ -61,6 +77,10 @@ _cfImageZoomFill(cf_izoom_t *z,		// I - Zoom record to fill
         zoom_nearest(z, iy);
 	break;
 
+    case CF_IZOOM_BEST :
+        zoom_bicubic(z, iy);
+	break;
+
     default :
         zoom_bilinear(z, iy);
 	break;
@@ -207,10 +227,89 @@ _cfImageZoomNew(
     return (NULL);
   }
 
+  if (type != CF_IZOOM_FAST && zoom_filter(z, flip))
+  {
+    _cfImageZoomDelete(z);
+    return (NULL);
+  }
+
   return (z);
 }
 
 
+//
+// 'zoom_bicubic()' - Fill a zoom record with image data utilizing bicubic
+//                    interpolation.
+//
+// The horizontal pass uses the bicubic taps directly.  Vertically the
+// caller blends two adjacent zoomed rows, so when the image is scaled
+// down each input row is low-pass filtered with the (stretched) bicubic
+// kernel first to avoid aliasing.
+//
+
+static void
+zoom_bicubic(cf_izoom_t   *z,		// I - Zoom record to fill
+             int          iy)		// I - Zoom image row
+{
+  cf_ib_t	*r,			// Row pointer
+		*tmp;			// Pointer into scratch row
+  int		*acc;			// Pointer into accumulator
+  int		i,			// Looping var
+		k,			// Current vertical tap
+		ky,			// Input row for tap
+		count,			// Number of bytes in row
+		val;			// Output value
+  short		w;			// Weight of current tap
+
+
+  if (z->ytaps <= 1)
+  {
+    zoom_bilinear(z, iy);
+    return;
+  }
+
+  if (iy > z->ymax)
+    iy = z->ymax;
+  if (z->yflip)
+    iy = z->ymax - iy;
+
+  z->row ^= 1;
+
+  count = z->xsize * z->depth;
+
+  memset(z->acc, 0, count * sizeof(int));
+
+  for (k = 0; k < z->ytaps; k ++)
+  {
+    ky = iy + k - z->ytaps / 2;
+    if (ky < 0)
+      ky = 0;
+    else if (ky > (int)z->ymax)
+      ky = z->ymax;
+
+    zoom_get_row(z, ky);
+    zoom_horizontal(z, z->tmp);
+
+    for (i = count, w = z->yweight[k], tmp = z->tmp, acc = z->acc;
+         i > 0;
+	 i --)
+      *acc++ += *tmp++ * w;
+  }
+
+  for (i = count, r = z->rows[z->row], acc = z->acc; i > 0; i --)
+  {
+    val = (*acc++ + 8192) >> 14;
+
+    if (val < 0)
+      *r++ = 0;
+    else if (val > 255)
+      *r++ = 255;
+    else
+      *r++ = (cf_ib_t)val;
+  }
+}
+
+
 //
 // 'zoom_bilinear()' - Fill a zoom record with image data utilizing bilinear
 //                     interpolation.
@@ -220,23 +319,6 @@ static void
 zoom_bilinear(cf_izoom_t   *z,		// I - Zoom record to fill
               int          iy)		// I - Zoom image row
 {
-  cf_ib_t	*r,			// Row pointer
-		*inptr;			// Pixel pointer
-  int		xerr0,			// X error counter
-		xerr1;			// ...
-  int		ix,
-		x,
-		count,
-		z_depth,
-		z_xstep,
-		z_xincr,
-		z_instep,
-		z_inincr,
-		z_xmax,
-		z_xmod,
-		z_xsize;
-
-
   if (iy > z->ymax)
     iy = z->ymax;
   if (z->yflip)
@@ -244,51 +326,293 @@ zoom_bilinear(cf_izoom_t   *z,		// I - Zoom record to fill
 
   z->row ^= 1;
 
-  z_depth  = z->depth;
-  z_xsize  = z->xsize;
-  z_xmax   = z->xmax;
-  z_xmod   = z->xmod;
-  z_xstep  = z->xstep;
-  z_xincr  = z->xincr;
-  z_instep = z->instep;
-  z_inincr = z->inincr;
+  zoom_get_row(z, iy);
+  zoom_horizontal(z, z->rows[z->row]);
+}
 
-  if (z->rotated)
-    cfImageGetCol(z->img, z->xorig - iy, z->yorig, z->width, z->in);
+
+//
+// 'zoom_cubic()' - Evaluate the bicubic filter kernel.
+//
+// This is the Catmull-Rom spline (a = -0.5), which is sharp but does not
+// ring as much as a Lanczos filter.
+//
+
+static double				// O - Filter weight
+zoom_cubic(double x)			// I - Distance from sample
+{
+  x = fabs(x);
+
+  if (x < 1.0)
+    return ((1.5 * x - 2.5) * x * x + 1.0);
+  else if (x < 2.0)
+    return (((-0.5 * x + 2.5) * x - 4.0) * x + 2.0);
   else
-    cfImageGetRow(z->img, z->xorig, z->yorig + iy, z->width, z->in);
+    return (0.0);
+}
 
-  if (z_inincr < 0)
-    inptr = z->in + (z->width - 1) * z_depth;
+
+//
+// 'zoom_filter()' - Precompute the filter taps of a zoom record.
+//
+// For every output pixel we store the input byte offset and the 2.14
+// fixed-point weight of each tap, so that the per-row work is reduced to
+// multiply-adds without any divides or branches.  Horizontal flips are
+// folded into the offsets.
+//
+
+static int				// O - 0 on success, -1 on error
+zoom_filter(cf_izoom_t *z,		// I - Zoom record
+	    int        flip)		// I - Flip on X axis?
+{
+  int		x,			// Output pixel
+		t,			// Current tap
+		p,			// Input pixel of tap
+		first,			// First input pixel of filter
+		maxtap,			// Tap with the largest weight
+		total,			// Sum of fixed-point weights
+		*index;			// Pointer into tap offsets
+  short		*weight;		// Pointer into tap weights
+  double	scale,			// Input pixels per output pixel
+		fscale,			// Filter stretch factor
+		support,		// Filter support (radius)
+		center,			// Center of filter in input
+		sum,			// Sum of weights
+		w[256];			// Weights of current output pixel
+  long long	pos;			// Position in input * xsize
+
+
+  if (z->type == CF_IZOOM_BEST)
+  {
+    scale   = (double)z->width / z->xsize;
+    fscale  = scale > 1.0 ? scale : 1.0;
+    support = 2.0 * fscale;
+    z->xtaps = (int)ceil(2.0 * support);
+
+    if (z->xtaps > (int)(sizeof(w) / sizeof(w[0])))
+    {
+      // Extreme reduction, limit the filter width...
+      z->xtaps = sizeof(w) / sizeof(w[0]);
+      support  = z->xtaps / 2;
+      fscale   = support / 2.0;
+    }
+  }
   else
-    inptr = z->in;
+  {
+    scale    = 1.0;
+    fscale   = 1.0;
+    support  = 1.0;
+    z->xtaps = 2;
+  }
 
-  for (x = z_xsize, xerr0 = z_xsize, xerr1 = 0, ix = 0, r = z->rows[z->row];
-       x > 0;
-       x --)
+  if ((z->xindex = (int *)malloc(z->xsize * z->xtaps * sizeof(int))) == NULL ||
+      (z->xweight = (short *)malloc(z->xsize * z->xtaps *
+				    sizeof(short))) == NULL)
+    return (-1);
+
+  for (x = 0, index = z->xindex, weight = z->xweight;
+       x < (int)z->xsize;
+       x ++, index += z->xtaps, weight += z->xtaps)
   {
-    if (ix < z_xmax)
+    if (z->type != CF_IZOOM_BEST)
     {
-      for (count = 0; count < z_depth; count ++)
-        *r++ = (inptr[count] * xerr0 + inptr[z_inincr + count] * xerr1) / z_xsize;
+      //
+      // Bilinear, same sampling positions as the nearest-neighbor
+      // Bresenham walk...
+      //
+
+      pos = (long long)x * z->width;
+      p   = (int)(pos / z->xsize);
+
+      if (p < (int)z->xmax)
+        weight[1] = (short)(((pos % z->xsize) * 16384 + z->xsize / 2) /
+			    z->xsize);
+      else
+        weight[1] = 0;
+
+      weight[0] = 16384 - weight[1];
+      index[0]  = p;
+      index[1]  = p + 1;
     }
     else
     {
-      for (count = 0; count < z_depth; count ++)
-        *r++ = inptr[count];
+      //
+      // Bicubic, stretched by the reduction factor when scaling down...
+      //
+
+      center = (x + 0.5) * scale - 0.5;
+      first  = (int)floor(center - support) + 1;
+
+      for (t = 0, sum = 0.0; t < z->xtaps; t ++)
+      {
+        w[t] = zoom_cubic((first + t - center) / fscale);
+	sum  += w[t];
+      }
+
+      for (t = 0, total = 0, maxtap = 0; t < z->xtaps; t ++)
+      {
+        weight[t] = (short)floor(w[t] * 16384.0 / sum + 0.5);
+	index[t]  = first + t;
+	total     += weight[t];
+
+	if (weight[t] > weight[maxtap])
+	  maxtap = t;
+      }
+
+      weight[maxtap] += 16384 - total;
     }
 
-    ix    += z_xstep;
-    inptr += z_instep;
-    xerr0 -= z_xmod;
-    xerr1 += z_xmod;
+    for (t = 0; t < z->xtaps; t ++)
+    {
+      p = index[t];
 
-    if (xerr0 <= 0)
+      if (p < 0)
+        p = 0;
+      else if (p >= (int)z->width)
+        p = z->width - 1;
+
+      if (flip)
+        p = z->width - 1 - p;
+
+      index[t] = p * z->depth;
+    }
+  }
+
+  //
+  // Vertical prefilter when scaling down with bicubic interpolation...
+  //
+
+  z->ytaps = 1;
+
+  if (z->type == CF_IZOOM_BEST && z->height > z->ysize)
+  {
+    scale   = (double)z->height / z->ysize;
+    support = 2.0 * scale;
+    z->ytaps = 2 * (int)ceil(support) - 1;
+
+    if (z->ytaps > (int)(sizeof(w) / sizeof(w[0])))
     {
-      xerr0 += z_xsize;
-      xerr1 -= z_xsize;
-      ix    += z_xincr;
-      inptr += z_inincr;
+      z->ytaps = sizeof(w) / sizeof(w[0]) - 1;
+      scale    = (z->ytaps + 1) / 4.0;
+    }
+
+    if ((z->yweight = (short *)malloc(z->ytaps * sizeof(short))) == NULL ||
+        (z->acc = (int *)malloc(z->xsize * z->depth * sizeof(int))) == NULL ||
+        (z->tmp = (cf_ib_t *)malloc(z->xsize * z->depth)) == NULL)
+      return (-1);
+
+    for (t = 0, sum = 0.0; t < z->ytaps; t ++)
+    {
+      w[t] = zoom_cubic((t - z->ytaps / 2) / scale);
+      sum  += w[t];
+    }
+
+    for (t = 0, total = 0; t < z->ytaps; t ++)
+    {
+      z->yweight[t] = (short)floor(w[t] * 16384.0 / sum + 0.5);
+      total         += z->yweight[t];
+    }
+
+    z->yweight[z->ytaps / 2] += 16384 - total;
+  }
+
+  return (0);
+}
+
+
+//
+// 'zoom_get_row()' - Read an unscaled row from the image.
+//
+// The image tile cache is not thread-safe, so zoom records sharing an
+// image between threads serialize their reads through the zoom lock.
+//
+
+static void
+zoom_get_row(cf_izoom_t *z,		// I - Zoom record
+	     int        iy)		// I - Input row
+{
+#ifdef HAVE_PTHREAD_H
+  if (z->lock)
+    pthread_mutex_lock(z->lock);
+#endif // HAVE_PTHREAD_H
+
+  if (z->rotated)
+    cfImageGetCol(z->img, z->xorig - iy, z->yorig, z->width, z->in);
+  else
+    cfImageGetRow(z->img, z->xorig, z->yorig + iy, z->width, z->in);
+
+#ifdef HAVE_PTHREAD_H
+  if (z->lock)
+    pthread_mutex_unlock(z->lock);
+#endif // HAVE_PTHREAD_H
+}
+
+
+//
+// 'zoom_horizontal()' - Scale the current input row horizontally.
+//
+
+static void
+zoom_horizontal(cf_izoom_t *z,		// I - Zoom record
+		cf_ib_t    *r)		// O - Scaled row
+{
+  const cf_ib_t	*in,			// Input row
+		*p0,			// First input pixel
+		*p1;			// Second input pixel
+  const int	*index;			// Pointer into tap offsets
+  const short	*weight;		// Pointer into tap weights
+  int		x,			// Looping var
+		t,			// Current tap
+		count,			// Current byte in pixel
+		depth,			// Bytes per pixel
+		xtaps,			// Taps per output pixel
+		w0,			// Weight of first pixel
+		w1,			// Weight of second pixel
+		val;			// Output value
+
+
+  in     = z->in;
+  index  = z->xindex;
+  weight = z->xweight;
+  depth  = z->depth;
+  xtaps  = z->xtaps;
+
+  if (xtaps == 2)
+  {
+    //
+    // Bilinear, the weights are non-negative and sum to 1.0 so there is
+    // no need to clamp...
+    //
+
+    for (x = z->xsize; x > 0; x --, index += 2, weight += 2)
+    {
+      p0 = in + index[0];
+      p1 = in + index[1];
+      w0 = weight[0];
+      w1 = weight[1];
+
+      for (count = depth; count > 0; count --)
+        *r++ = (cf_ib_t)((*p0++ * w0 + *p1++ * w1 + 8192) >> 14);
+    }
+  }
+  else
+  {
+    for (x = z->xsize; x > 0; x --, index += xtaps, weight += xtaps)
+    {
+      for (count = 0; count < depth; count ++)
+      {
+        for (t = 0, val = 8192; t < xtaps; t ++)
+	  val += in[index[t] + count] * weight[t];
+
+        val >>= 14;
+
+        if (val < 0)
+	  *r++ = 0;
+	else if (val > 255)
+	  *r++ = 255;
+	else
+	  *r++ = (cf_ib_t)val;
+      }
     }
   }
 }
@@ -17,11 +17,15 @@
 //   format_kcmy()   - Convert image data to KCMY.
 //   format_kcmycm() - Convert image data to KCMYcm.
 //   format_rgba()   - Convert image data to RGBA/RGBW.
+//   format_row()    - Convert a zoomed image row to the output format.
 //   format_w()      - Convert image data to luminance.
 //   format_ymc()    - Convert image data to YMC.
 //   format_ymck()   - Convert image data to YMCK.
 //   make_lut()      - Make a lookup table given gamma and brightness values.
 //   raster_cb()     - Validate the page header.
+//   render_band()   - Render a band of raster lines.
+//   render_bands()  - Render a page with a pool of worker threads.
+//   render_worker() - Band rendering worker thread.
 //
 
 //
@@ -38,6 +42,17 @@
 #include <math.h>
 #include <signal.h>
 #include <string.h>
+#ifdef HAVE_PTHREAD_H
+#  include <pthread.h>
+#endif // HAVE_PTHREAD_H
+
+
+//
+// Constants...
+//
+
+#define IMAGETORASTER_BAND_LINES	16	// Raster lines per band
+#define IMAGETORASTER_MAX_WORKERS	8	// Maximum number of worker threads
 
 
 //
@@ -68,6 +83,35 @@ typedef struct                  // **** Document information ****¨
 				// be NULL
 } imagetoraster_doc_t;
 
+#ifdef HAVE_PTHREAD_H
+struct imagetoraster_bands_s;
+
+typedef struct imagetoraster_worker_s	// **** Band rendering worker ****
+{
+  struct imagetoraster_bands_s *bands;	// Shared band state
+  pthread_t	thread;			// Worker thread
+  cf_izoom_t	*z;			// Private zoom record
+  unsigned char	*buffer;		// Rendered band
+  int		first,			// First band to render
+		ready;			// Non-zero when band is rendered
+} imagetoraster_worker_t;
+
+typedef struct imagetoraster_bands_s	// **** Band rendering state ****
+{
+  imagetoraster_doc_t	*doc;		// Document information
+  cups_page_header_t	*header;	// Page header
+  int			plane,		// Current color plane
+			num_bands,	// Number of bands on the page
+			num_workers,	// Number of worker threads
+			abort;		// Non-zero to stop the workers
+  pthread_mutex_t	lock,		// Lock for band state
+			image_lock;	// Lock for image tile cache
+  pthread_cond_t	cond;		// Band state changed
+  imagetoraster_worker_t workers[IMAGETORASTER_MAX_WORKERS];
+					// Worker threads
+} imagetoraster_bands_t;
+#endif // HAVE_PTHREAD_H
+
 
 //
 // Constants...
@@ -170,7 +214,20 @@ static void	format_ymck(imagetoraster_doc_t *doc,
 			    cups_page_header_t *header, unsigned char *row,
 			    int y, int z, int xsize, int ysize, int yerr0,
 			    int yerr1, cf_ib_t *r0, cf_ib_t *r1);
+static void	format_row(imagetoraster_doc_t *doc,
+			   cups_page_header_t *header, unsigned char *row,
+			   int y, int plane, cf_izoom_t *z, int yerr0,
+			   int yerr1);
 static void	make_lut(cf_ib_t *, int, float, float);
+#ifdef HAVE_PTHREAD_H
+static void	render_band(imagetoraster_doc_t *doc,
+			    cups_page_header_t *header, int plane,
+			    cf_izoom_t *z, int band, unsigned char *buffer);
+static int	render_bands(imagetoraster_doc_t *doc,
+			     cups_page_header_t *header, cups_raster_t *ras,
+			     int plane, cf_izoom_t **zooms, int num_workers);
+static void	*render_worker(imagetoraster_worker_t *w);
+#endif // HAVE_PTHREAD_H
 
 
 //
@@ -224,11 +281,17 @@ cfFilterImageToRaster(int inputfd,         // I - File descriptor input stream
   int			hue, sat;	// Hue and saturation adjustment
   cf_izoom_t		*z;		// Image zoom buffer
   cf_iztype_t		zoom_type;	// Image zoom type
+  int			zoom_xsize,	// Signed zoom width
+			zoom_ysize;	// Signed zoom height
+  int			status;		// Band rendering status
+#ifdef HAVE_PTHREAD_H
+  int			num_workers;	// Number of band rendering threads
+  cf_izoom_t		*zooms[IMAGETORASTER_MAX_WORKERS];
+					// Zoom records of the workers
+#endif // HAVE_PTHREAD_H
   int			primary,	// Primary image colorspace
 			secondary;	// Secondary image colorspace
-  cf_ib_t		*row,		// Current row
-			*r0,		// Top row
-			*r1;		// Bottom row
+  cf_ib_t		*row;		// Current row
   int			y,		// Current Y coordinate on page
 			iy,		// Current Y coordinate in image
 			last_iy,	// Previous Y coordinate in image
@@ -1541,10 +1604,26 @@ cfFilterImageToRaster(int inputfd,         // I - File descriptor input stream
   else
     num_planes = 1;
 
-  if (header.cupsBitsPerColor >= 8)
-    zoom_type = CF_IZOOM_NORMAL;
-  else
+  if (header.cupsBitsPerColor < 8)
     zoom_type = CF_IZOOM_FAST;
+  else if ((val = cupsGetOption("print-quality", num_options, options)) !=
+	   NULL && atoi(val) == IPP_QUALITY_HIGH)
+    zoom_type = CF_IZOOM_BEST;
+  else
+    zoom_type = CF_IZOOM_NORMAL;
+
+#ifdef HAVE_PTHREAD_H
+  //
+  // Rows of the page are independent of each other (we use ordered
+  // dithering only), so large pages are rendered in bands by a pool of
+  // worker threads, one per CPU...
+  //
+
+  if ((num_workers = (int)sysconf(_SC_NPROCESSORS_ONLN)) < 1)
+    num_workers = 1;
+  else if (num_workers > IMAGETORASTER_MAX_WORKERS)
+    num_workers = IMAGETORASTER_MAX_WORKERS;
+#endif // HAVE_PTHREAD_H
 
   //
   // See if we need to collate, and if so how we need to do it...
@@ -1675,10 +1754,11 @@ cfFilterImageToRaster(int inputfd,         // I - File descriptor input stream
 	  // Initialize the image "zoom" engine...
 	  //
 
-	  z = _cfImageZoomNew(img, xc0, yc0, xc1, yc1,
-			      (doc.Flip ? -1 : 1) *
-			      (doc.Orientation > 1 ? -1 : 1) * xtemp,
-			      (doc.Orientation > 1 ? -1 : 1) * ytemp,
+	  zoom_xsize = (doc.Flip ? -1 : 1) * (doc.Orientation > 1 ? -1 : 1) *
+		       xtemp;
+	  zoom_ysize = (doc.Orientation > 1 ? -1 : 1) * ytemp;
+
+	  z = _cfImageZoomNew(img, xc0, yc0, xc1, yc1, zoom_xsize, zoom_ysize,
 			      doc.Orientation & 1, zoom_type);
 	  if (z == NULL) continue;
 
@@ -1716,8 +1796,45 @@ cfFilterImageToRaster(int inputfd,         // I - File descriptor input stream
 	  // Then write image data...
 	  //
 
+	  status = -1;
+
+#ifdef HAVE_PTHREAD_H
+	  if (num_workers > 1 &&
+	      z->ysize >= 2 * IMAGETORASTER_BAND_LINES * num_workers)
+	  {
+	    zooms[0] = z;
+
+	    for (i = 1; i < num_workers; i ++)
+	      if ((zooms[i] = _cfImageZoomNew(img, xc0, yc0, xc1, yc1,
+					      zoom_xsize, zoom_ysize,
+					      doc.Orientation & 1,
+					      zoom_type)) == NULL)
+		break;
+
+	    if (i == num_workers)
+	      status = render_bands(&doc, &header, ras, plane, zooms,
+				    num_workers);
+
+	    while (i > 1)
+	      _cfImageZoomDelete(zooms[-- i]);
+
+	    if (status > 0)
+	    {
+	      if (log) log(ld, CF_LOGLEVEL_DEBUG,
+			   "cfFilterImageToRaster: Unable to send raster data.");
+	      cfImageClose(img);
+	      _cfImageZoomDelete(z);
+	      return (1);
+	    }
+	    else if (status < 0 && log)
+	      log(ld, CF_LOGLEVEL_DEBUG,
+		  "cfFilterImageToRaster: Unable to start worker threads, "
+		  "rendering page on a single thread.");
+	  }
+#endif // HAVE_PTHREAD_H
+
 	  for (y = z->ysize, yerr0 = 0, yerr1 = z->ysize, iy = 0, last_iy = -2;
-               y > 0;
+               status < 0 && y > 0;
                y --)
 	  {
 	    if (iy != last_iy)
@@ -1735,66 +1852,7 @@ cfFilterImageToRaster(int inputfd,         // I - File descriptor input stream
 	    //
 
     	    blank_line(&header, row);
-
-            r0 = z->rows[z->row];
-            r1 = z->rows[1 - z->row];
-
-            switch (header.cupsColorSpace)
-	    {
-	      case CUPS_CSPACE_W :
-	      case CUPS_CSPACE_SW :
-		  format_w(&doc, &header, row, y, plane, z->xsize, z->ysize,
-		           yerr0, yerr1, r0, r1);
-		  break;
-              default :
-	      case CUPS_CSPACE_RGB :
-	      case CUPS_CSPACE_SRGB :
-	      case CUPS_CSPACE_ADOBERGB :
-	          format_RGB(&doc, &header, row, y, plane, z->xsize, z->ysize,
-		             yerr0, yerr1, r0, r1);
-		  break;
-	      case CUPS_CSPACE_RGBA :
-	      case CUPS_CSPACE_RGBW :
-	          format_rgba(&doc, &header, row, y, plane, z->xsize, z->ysize,
-		              yerr0, yerr1, r0, r1);
-		  break;
-	      case CUPS_CSPACE_K :
-	      case CUPS_CSPACE_WHITE :
-	      case CUPS_CSPACE_GOLD :
-	      case CUPS_CSPACE_SILVER :
-	          format_K(&doc, &header, row, y, plane, z->xsize, z->ysize,
-		           yerr0, yerr1, r0, r1);
-		  break;
-	      case CUPS_CSPACE_CMY :
-	          format_cmy(&doc, &header, row, y, plane, z->xsize, z->ysize,
-		             yerr0, yerr1, r0, r1);
-		  break;
-	      case CUPS_CSPACE_YMC :
-	          format_ymc(&doc, &header, row, y, plane, z->xsize, z->ysize,
-		             yerr0, yerr1, r0, r1);
-		  break;
-	      case CUPS_CSPACE_CMYK :
-	          format_cmyk(&doc, &header, row, y, plane, z->xsize, z->ysize,
-		              yerr0, yerr1, r0, r1);
-		  break;
-	      case CUPS_CSPACE_YMCK :
-	      case CUPS_CSPACE_GMCK :
-	      case CUPS_CSPACE_GMCS :
-	          format_ymck(&doc, &header, row, y, plane, z->xsize, z->ysize,
-		              yerr0, yerr1, r0, r1);
-		  break;
-	      case CUPS_CSPACE_KCMYcm :
-	          if (header.cupsBitsPerColor == 1)
-		  {
-	            format_kcmycm(&doc, &header, row, y, plane, z->xsize,
-				  z->ysize, yerr0, yerr1, r0, r1);
-		    break;
-		  }
-	      case CUPS_CSPACE_KCMY :
-	          format_kcmy(&doc, &header, row, y, plane, z->xsize, z->ysize,
-		              yerr0, yerr1, r0, r1);
-		  break;
-	    }
+	    format_row(&doc, &header, row, y, plane, z, yerr0, yerr1);
 
 	    //
 	    // Write the raster data ...
@@ -4227,6 +4285,86 @@ format_rgba(imagetoraster_doc_t *doc,
 }
 
 
+//
+// 'format_row()' - Convert a zoomed image row to the output format.
+//
+
+static void
+format_row(imagetoraster_doc_t *doc,	// I - Document information
+	   cups_page_header_t *header,	// I - Page header
+	   unsigned char    *row,	// IO - Bitmap data for device
+	   int              y,		// I - Current row
+	   int              plane,	// I - Current plane
+	   cf_izoom_t       *z,		// I - Zoom record with current rows
+	   int              yerr0,	// I - Top Y error
+	   int              yerr1)	// I - Bottom Y error
+{
+  cf_ib_t	*r0,			// Top row
+		*r1;			// Bottom row
+
+
+  r0 = z->rows[z->row];
+  r1 = z->rows[1 - z->row];
+
+  switch (header->cupsColorSpace)
+  {
+    case CUPS_CSPACE_W :
+    case CUPS_CSPACE_SW :
+	format_w(doc, header, row, y, plane, z->xsize, z->ysize,
+		 yerr0, yerr1, r0, r1);
+	break;
+    default :
+    case CUPS_CSPACE_RGB :
+    case CUPS_CSPACE_SRGB :
+    case CUPS_CSPACE_ADOBERGB :
+	format_RGB(doc, header, row, y, plane, z->xsize, z->ysize,
+		   yerr0, yerr1, r0, r1);
+	break;
+    case CUPS_CSPACE_RGBA :
+    case CUPS_CSPACE_RGBW :
+	format_rgba(doc, header, row, y, plane, z->xsize, z->ysize,
+		    yerr0, yerr1, r0, r1);
+	break;
+    case CUPS_CSPACE_K :
+    case CUPS_CSPACE_WHITE :
+    case CUPS_CSPACE_GOLD :
+    case CUPS_CSPACE_SILVER :
+	format_K(doc, header, row, y, plane, z->xsize, z->ysize,
+		 yerr0, yerr1, r0, r1);
+	break;
+    case CUPS_CSPACE_CMY :
+	format_cmy(doc, header, row, y, plane, z->xsize, z->ysize,
+		   yerr0, yerr1, r0, r1);
+	break;
+    case CUPS_CSPACE_YMC :
+	format_ymc(doc, header, row, y, plane, z->xsize, z->ysize,
+		   yerr0, yerr1, r0, r1);
+	break;
+    case CUPS_CSPACE_CMYK :
+	format_cmyk(doc, header, row, y, plane, z->xsize, z->ysize,
+		    yerr0, yerr1, r0, r1);
+	break;
+    case CUPS_CSPACE_YMCK :
+    case CUPS_CSPACE_GMCK :
+    case CUPS_CSPACE_GMCS :
+	format_ymck(doc, header, row, y, plane, z->xsize, z->ysize,
+		    yerr0, yerr1, r0, r1);
+	break;
+    case CUPS_CSPACE_KCMYcm :
+	if (header->cupsBitsPerColor == 1)
+	{
+	  format_kcmycm(doc, header, row, y, plane, z->xsize,
+			z->ysize, yerr0, yerr1, r0, r1);
+	  break;
+	}
+    case CUPS_CSPACE_KCMY :
+	format_kcmy(doc, header, row, y, plane, z->xsize, z->ysize,
+		    yerr0, yerr1, r0, r1);
+	break;
+  }
+}
+
+
 //
 // 'format_w()' - Convert image data to luminance.
 //
@@ -5428,3 +5566,230 @@ make_lut(cf_ib_t    *lut,		// I - Lookup table
       *lut++ = v;
   }
 }
+
+
+#ifdef HAVE_PTHREAD_H
+//
+// 'render_band()' - Render a band of raster lines.
+//
+// This repeats the Bresenham walk of the main loop, starting at the first
+// line of the band.
+//
+
+static void
+render_band(imagetoraster_doc_t *doc,	// I - Document information
+	    cups_page_header_t *header,	// I - Page header
+	    int                plane,	// I - Current color plane
+	    cf_izoom_t         *z,	// I - Zoom record
+	    int                band,	// I - Band number
+	    unsigned char      *buffer)	// O - Rendered lines
+{
+  int		line,			// Current line in zoomed image
+		last,			// Last line of band + 1
+		iy,			// Current Y coordinate in image
+		last_iy,		// Previous Y coordinate in image
+		yerr0,			// Top Y error value
+		yerr1;			// Bottom Y error value
+
+
+  line = band * IMAGETORASTER_BAND_LINES;
+  last = line + IMAGETORASTER_BAND_LINES;
+  if (last > (int)z->ysize)
+    last = z->ysize;
+
+  for (last_iy = -2; line < last;
+       line ++, buffer += header->cupsBytesPerLine)
+  {
+    iy    = line * z->ystep + (int)((long long)line * z->ymod / z->ysize);
+    yerr0 = (int)((long long)line * z->ymod % z->ysize);
+    yerr1 = z->ysize - yerr0;
+
+    if (iy != last_iy)
+    {
+      if (z->type != CF_IZOOM_FAST && (iy - last_iy) > 1)
+	_cfImageZoomFill(z, iy);
+
+      _cfImageZoomFill(z, iy + z->yincr);
+
+      last_iy = iy;
+    }
+
+    blank_line(header, buffer);
+    format_row(doc, header, buffer, z->ysize - line, plane, z, yerr0, yerr1);
+  }
+}
+
+
+//
+// 'render_bands()' - Render a page with a pool of worker threads.
+//
+// Bands are assigned round-robin to the workers, each worker renders into
+// its own buffer with its own zoom record, and the calling thread writes
+// the finished bands to the raster stream in order.
+//
+
+static int				// O - 0 on success, 1 on write error,
+					//     -1 if the threads can't be started
+render_bands(
+    imagetoraster_doc_t *doc,		// I - Document information
+    cups_page_header_t  *header,	// I - Page header
+    cups_raster_t       *ras,		// I - Raster stream
+    int                 plane,		// I - Current color plane
+    cf_izoom_t          **zooms,	// I - Zoom records, one per worker
+    int                 num_workers)	// I - Number of worker threads
+{
+  imagetoraster_bands_t	bands;		// Band rendering state
+  imagetoraster_worker_t *w;		// Current worker
+  int			i,		// Looping var
+			band,		// Current band
+			lines,		// Lines in current band
+			started,	// Number of started workers
+			status = 0;	// Return status
+  unsigned char		*line;		// Current line
+
+
+  memset(&bands, 0, sizeof(bands));
+
+  bands.doc         = doc;
+  bands.header      = header;
+  bands.plane       = plane;
+  bands.num_workers = num_workers;
+  bands.num_bands   = (zooms[0]->ysize + IMAGETORASTER_BAND_LINES - 1) /
+		      IMAGETORASTER_BAND_LINES;
+
+  pthread_mutex_init(&bands.lock, NULL);
+  pthread_mutex_init(&bands.image_lock, NULL);
+  pthread_cond_init(&bands.cond, NULL);
+
+  for (i = 0; i < num_workers; i ++)
+  {
+    w = bands.workers + i;
+
+    w->bands  = &bands;
+    w->z      = zooms[i];
+    w->first  = i;
+    w->z->lock = &bands.image_lock;
+
+    if ((w->buffer = malloc(IMAGETORASTER_BAND_LINES *
+			    header->cupsBytesPerLine)) == NULL)
+    {
+      status = -1;
+      break;
+    }
+  }
+
+  //
+  // Start the workers...
+  //
+
+  for (started = 0; status == 0 && started < num_workers; started ++)
+  {
+    w = bands.workers + started;
+
+    if (pthread_create(&w->thread, NULL,
+		       (void *(*)(void *))render_worker, w))
+    {
+      status = -1;
+      break;
+    }
+  }
+
+  //
+  // Write the bands in order as they are finished...
+  //
+
+  for (band = 0; status == 0 && band < bands.num_bands; band ++)
+  {
+    w = bands.workers + band % num_workers;
+
+    pthread_mutex_lock(&bands.lock);
+    while (!w->ready)
+      pthread_cond_wait(&bands.cond, &bands.lock);
+    pthread_mutex_unlock(&bands.lock);
+
+    lines = zooms[0]->ysize - band * IMAGETORASTER_BAND_LINES;
+    if (lines > IMAGETORASTER_BAND_LINES)
+      lines = IMAGETORASTER_BAND_LINES;
+
+    for (line = w->buffer; lines > 0;
+	 lines --, line += header->cupsBytesPerLine)
+      if (cupsRasterWritePixels(ras, line, header->cupsBytesPerLine) <
+	  header->cupsBytesPerLine)
+      {
+	status = 1;
+	break;
+      }
+
+    pthread_mutex_lock(&bands.lock);
+    w->ready = 0;
+    pthread_cond_broadcast(&bands.cond);
+    pthread_mutex_unlock(&bands.lock);
+  }
+
+  //
+  // Stop the workers and clean up...
+  //
+
+  pthread_mutex_lock(&bands.lock);
+  bands.abort = 1;
+  pthread_cond_broadcast(&bands.cond);
+  pthread_mutex_unlock(&bands.lock);
+
+  for (i = 0; i < started; i ++)
+    pthread_join(bands.workers[i].thread, NULL);
+
+  for (i = 0; i < num_workers; i ++)
+  {
+    free(bands.workers[i].buffer);
+    zooms[i]->lock = NULL;
+  }
+
+  pthread_cond_destroy(&bands.cond);
+  pthread_mutex_destroy(&bands.image_lock);
+  pthread_mutex_destroy(&bands.lock);
+
+  return (status);
+}
+
+
+//
+// 'render_worker()' - Band rendering worker thread.
+//
+
+static void *				// O - Thread exit status (unused)
+render_worker(imagetoraster_worker_t *w)// I - Worker
+{
+  imagetoraster_bands_t	*bands = w->bands;
+					// Band rendering state
+  int			band,		// Current band
+			stop;		// Stop rendering?
+
+
+  for (band = w->first; band < bands->num_bands;
+       band += bands->num_workers)
+  {
+    //
+    // Wait until the previous band has been written...
+    //
+
+    pthread_mutex_lock(&bands->lock);
+    while (w->ready && !bands->abort)
+      pthread_cond_wait(&bands->cond, &bands->lock);
+    stop = bands->abort;
+    pthread_mutex_unlock(&bands->lock);
+
+    if (stop)
+      break;
+
+    render_band(bands->doc, bands->header, bands->plane, w->z, band,
+		w->buffer);
+
+    pthread_mutex_lock(&bands->lock);
+    w->ready = 1;
+    pthread_cond_broadcast(&bands->cond);
+    pthread_mutex_unlock(&bands->lock);
+  }
+
+  return (NULL);
+}
+#endif // HAVE_PTHREAD_H
@@ -11,6 +11,10 @@
 //   cfGetPrintRenderIntent()   - Return rendering intent for a job
 //   cfJoinJobOptionsAndAttrs() - Join job IPP attributes and job options in
 //                                one option list
+//   cfFilterDataIndexOptions() - Index job options and IPP attributes by
+//                                name
+//   cfFilterDataGetOption()    - Get a job option or IPP attribute value
+//   cfFilterDataFreeOptionIndex() - Free the option index
 //
 
 //
@@ -50,6 +54,28 @@ typedef struct cf_size_s		// **** Media Size (cups_size_t of libcups2) ****
 					// millimeters
 } cf_size_t;
 
+typedef struct option_index_s		// **** Job options and attributes
+					//      hashed by name ****
+{
+  int		num_options;		// Indexed data->num_options
+  cups_option_t	*options;		// Indexed data->options
+  ipp_t		*job_attrs;		// Indexed data->job_attrs
+  size_t	size;			// Number of slots, a power of 2
+  cups_option_t	*slots;			// Slots, name is NULL when unused
+} option_index_t;
+
+#define OPTION_INDEX_EXT "cfFilterOptionIndex"
+					// Name of the index in the filter
+					// data extensions
+
+static size_t		option_hash(const char *name);
+static int		option_index_add(option_index_t *index,
+					 const char *name, const char *value);
+static void		option_index_free(option_index_t *index);
+static option_index_t	*option_index_get(cf_filter_data_t *data);
+static cups_option_t	*option_index_slot(option_index_t *index,
+					   const char *name);
+
 
 char cf_get_printer_attributes_log[CF_GET_PRINTER_ATTRIBUTES_LOGSIZE];
 
@@ -1036,6 +1062,24 @@ cfJoinJobOptionsAndAttrs(cf_filter_data_t* data,  // I  - Filter data
   int i = 0;                            // Looping variable
   char buf[2048];                       // Buffer for storing value of ipp attr
   cups_option_t *opt;
+  option_index_t *index;                // Option index of the filter data
+  size_t j;                             // Looping variable
+
+  if ((index = option_index_get(data)) != NULL)
+  {
+    //
+    // Already indexed (cfFilterChain() does this for its filters), take
+    // the options from there instead of formatting the attributes again...
+    //
+
+    for (j = 0; j < index->size; j ++)
+      if (index->slots[j].name)
+	num_options = cupsAddOption(index->slots[j].name,
+				    index->slots[j].value,
+				    num_options, options);
+
+    return (num_options);
+  }
 
   for (i = 0, opt = data->options; i < data->num_options; i ++, opt ++)
     num_options = cupsAddOption(opt->name, opt->value, num_options, options);
@@ -1052,6 +1096,249 @@ cfJoinJobOptionsAndAttrs(cf_filter_data_t* data,  // I  - Filter data
 }
 
 
+//
+// 'cfFilterDataIndexOptions()' - Index the job options and attributes of
+//                                the filter data by name.
+//
+// The index is attached to the filter data as an extension, so all
+// filters called with the data, also the ones of a cfFilterChain(), share
+// it.  It is built again when data->options, data->num_options, or
+// data->job_attrs get replaced.  Whoever changes options or attributes in
+// place has to call cfFilterDataFreeOptionIndex().
+//
+
+int                                       // O - 1 if the index got built, 0
+                                          //     if it was up to date, -1 on
+                                          //     error
+cfFilterDataIndexOptions(cf_filter_data_t *data) // I - Filter data
+{
+  option_index_t  *index;                 // Index
+  ipp_attribute_t *ipp_attr;              // IPP attribute
+  cups_option_t   *opt;                   // Job option
+  size_t          count;                  // Number of options and attributes
+  int             i;                      // Looping variable
+  char            buf[2048];              // Buffer for storing value of ipp attr
+
+
+  if (!data)
+    return (-1);
+
+  if (option_index_get(data))
+    return (0);
+
+  cfFilterDataFreeOptionIndex(data);      // Out of date or none
+
+  count = data->num_options > 0 ? (size_t)data->num_options : 0;
+  for (ipp_attr = ippGetFirstAttribute(data->job_attrs); ipp_attr;
+       ipp_attr = ippGetNextAttribute(data->job_attrs))
+    count ++;
+
+  if ((index = calloc(1, sizeof(option_index_t))) == NULL)
+    return (-1);
+
+  index->num_options = data->num_options;
+  index->options     = data->options;
+  index->job_attrs   = data->job_attrs;
+
+  for (index->size = 16; index->size < 2 * count; index->size *= 2);
+
+  if ((index->slots = calloc(index->size, sizeof(cups_option_t))) == NULL)
+  {
+    free(index);
+    return (-1);
+  }
+
+  //
+  // Same order as cfJoinJobOptionsAndAttrs(), job attributes replace
+  // options of the same name...
+  //
+
+  for (i = 0, opt = data->options; i < data->num_options; i ++, opt ++)
+    if (option_index_add(index, opt->name, opt->value))
+      goto error;
+
+  for (ipp_attr = ippGetFirstAttribute(data->job_attrs); ipp_attr;
+       ipp_attr = ippGetNextAttribute(data->job_attrs))
+  {
+    ippAttributeString(ipp_attr, buf, sizeof(buf));
+    if (option_index_add(index, ippGetName(ipp_attr), buf))
+      goto error;
+  }
+
+  cfFilterDataAddExt(data, OPTION_INDEX_EXT, index);
+  if (cfFilterDataGetExt(data, OPTION_INDEX_EXT) != index)
+    goto error;
+
+  return (1);
+
+ error:
+  option_index_free(index);
+  return (-1);
+}
+
+
+//
+// 'cfFilterDataGetOption()' - Get the value of a job option or attribute
+//                             from the filter data.
+//
+// Job attributes take precedence over options of the same name, and names
+// are case-insensitive, as with cfJoinJobOptionsAndAttrs().  The
+// lookup builds the index with cfFilterDataIndexOptions() if needed; it
+// then stays attached to the filter data until
+// cfFilterDataFreeOptionIndex() is called.  The value is valid until the
+// index gets freed or rebuilt.  Options or attributes changed in place
+// are not noticed, see cfFilterDataIndexOptions().
+//
+
+const char *                              // O - Value or NULL if not set
+cfFilterDataGetOption(cf_filter_data_t *data, // I - Filter data
+		      const char *name)   // I - Name of option or attribute
+{
+  option_index_t *index;                  // Index
+
+
+  if (!name || cfFilterDataIndexOptions(data) < 0 ||
+      (index = option_index_get(data)) == NULL)
+    return (NULL);
+
+  return (option_index_slot(index, name)->value);
+}
+
+
+//
+// 'cfFilterDataFreeOptionIndex()' - Remove the option index from the
+//                                   filter data and free it.
+//
+
+void
+cfFilterDataFreeOptionIndex(cf_filter_data_t *data) // I - Filter data
+{
+  option_index_t *index;                  // Index
+
+
+  if ((index = (option_index_t *)cfFilterDataRemoveExt(data,
+						       OPTION_INDEX_EXT)) !=
+      NULL)
+    option_index_free(index);
+}
+
+
+//
+// 'option_hash()' - Hash an option name, ignoring case.
+//
+
+static size_t                             // O - Hash value
+option_hash(const char *name)             // I - Option name
+{
+  size_t hash = 2166136261U;              // FNV-1a hash
+
+
+  for (; *name; name ++)
+    hash = (hash ^ (size_t)tolower(*name & 255)) * 16777619U;
+
+  return (hash);
+}
+
+
+//
+// 'option_index_add()' - Add an option to an index, replacing the value of
+//                        an option of the same name.
+//
+
+static int                                // O - 0 on success, -1 on error
+option_index_add(option_index_t *index,   // I - Index
+		 const char *name,        // I - Option name
+		 const char *value)       // I - Option value
+{
+  cups_option_t *slot;                    // Slot of the option
+  char          *copy;                    // Copy of the value
+
+
+  if (!name || !value)
+    return (0);
+
+  slot = option_index_slot(index, name);
+
+  if ((copy = strdup(value)) == NULL)
+    return (-1);
+
+  if (!slot->name && (slot->name = strdup(name)) == NULL)
+  {
+    free(copy);
+    return (-1);
+  }
+
+  free(slot->value);
+  slot->value = copy;
+
+  return (0);
+}
+
+
+//
+// 'option_index_free()' - Free an option index.
+//
+
+static void
+option_index_free(option_index_t *index)  // I - Index
+{
+  size_t i;                               // Looping variable
+
+
+  for (i = 0; i < index->size; i ++)
+  {
+    free(index->slots[i].name);
+    free(index->slots[i].value);
+  }
+
+  free(index->slots);
+  free(index);
+}
+
+
+//
+// 'option_index_get()' - Get the option index of the filter data if it is
+//                        up to date.
+//
+
+static option_index_t *                   // O - Index or NULL
+option_index_get(cf_filter_data_t *data)  // I - Filter data
+{
+  option_index_t *index;                  // Index
+
+
+  if ((index = (option_index_t *)cfFilterDataGetExt(data,
+						    OPTION_INDEX_EXT)) != NULL &&
+      index->num_options == data->num_options &&
+      index->options == data->options &&
+      index->job_attrs == data->job_attrs)
+    return (index);
+
+  return (NULL);
+}
+
+
+//
+// 'option_index_slot()' - Find the slot of an option in an index, or the
+//                         empty slot where it goes.
+//
+
+static cups_option_t *                    // O - Slot
+option_index_slot(option_index_t *index,  // I - Index
+		  const char *name)       // I - Option name
+{
+  size_t mask = index->size - 1,          // Mask for slot numbers
+	 i;                               // Slot number
+
+
+  for (i = option_hash(name) & mask;
+       index->slots[i].name && strcasecmp(index->slots[i].name, name);
+       i = (i + 1) & mask);
+
+  return (index->slots + i);
+}
+
+
 #ifndef HAVE_STRLCPY
 //
 // 'strlcpy()' - Safely copy two strings.
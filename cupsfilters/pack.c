@@ -20,6 +20,62 @@
 //
 
 #include "driver.h"
+#include <stdint.h>
+#include <string.h>
+
+
+//
+// On little-endian machines 8 input pixels are loaded as one 64-bit
+// word.  pack_nonzero() sets the high bit of every non-zero byte
+// without carries between the bytes, and pack_gather() moves these 8
+// bits into one byte with a single multiplication, the first pixel
+// going to the high bit, like a SIMD "movemask" instruction.  This is
+// portable, so no run-time CPU detection is needed.  Strided pixels
+// are tested without branches.
+//
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#  define PACK_WORDS 1
+
+#  define PACK_ONES	0x0101010101010101ULL
+#  define PACK_LOWS	0x7f7f7f7f7f7f7f7fULL
+#  define PACK_HIGHS	0x8080808080808080ULL
+
+static inline uint64_t
+pack_load(const unsigned char *p)
+{
+  uint64_t	v;
+
+  memcpy(&v, p, sizeof(v));
+  return (v);
+}
+
+static inline uint64_t
+pack_nonzero(uint64_t v)
+{
+  return ((((v & PACK_LOWS) + PACK_LOWS) | v) & PACK_HIGHS);
+}
+
+static inline unsigned char
+pack_gather(uint64_t highs)
+{
+  return ((unsigned char)(((highs >> 7) * 0x8040201008040201ULL) >> 56));
+}
+#endif // __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+
+static inline unsigned char
+pack_strided(const unsigned char *p,
+	     const int           step)
+{
+  return ((unsigned char)(((p[0] != 0) << 7) |
+			  ((p[step] != 0) << 6) |
+			  ((p[2 * step] != 0) << 5) |
+			  ((p[3 * step] != 0) << 4) |
+			  ((p[4 * step] != 0) << 3) |
+			  ((p[5 * step] != 0) << 2) |
+			  ((p[6 * step] != 0) << 1) |
+			  (p[7 * step] != 0)));
+}
 
 
 //
@@ -40,39 +96,16 @@ cfPackHorizontal(const unsigned char *ipixels,  // I - Input pixels
   // Do whole bytes first...
   //
 
-  while (width > 7)
+#ifdef PACK_WORDS
+  if (step == 1)
   {
-    b = clearto;
-
-    if (*ipixels)
-      b ^= 0x80;
-    ipixels += step;
-    if (*ipixels)
-      b ^= 0x40;
-    ipixels += step;
-    if (*ipixels)
-      b ^= 0x20;
-    ipixels += step;
-    if (*ipixels)
-      b ^= 0x10;
-    ipixels += step;
-    if (*ipixels)
-      b ^= 0x08;
-    ipixels += step;
-    if (*ipixels)
-      b ^= 0x04;
-    ipixels += step;
-    if (*ipixels)
-      b ^= 0x02;
-    ipixels += step;
-    if (*ipixels)
-      b ^= 0x01;
-    ipixels += step;
-
-    *obytes++ = b;
-
-    width -= 8;
+    for (; width > 7; width -= 8, ipixels += 8)
+      *obytes++ = clearto ^ pack_gather(pack_nonzero(pack_load(ipixels)));
   }
+  else
+#endif // PACK_WORDS
+  for (; width > 7; width -= 8, ipixels += 8 * step)
+    *obytes++ = clearto ^ pack_strided(ipixels, step);
 
   //
   // Then do the last N bytes (N < 8)...
@@ -175,12 +208,22 @@ cfPackHorizontalBit(const unsigned char *ipixels,	// I - Input pixels
 		    const unsigned char bit)		// I - Bit to check
 {
   register unsigned char	b;			// Current byte
+#ifdef PACK_WORDS
+  uint64_t			mask = bit * PACK_ONES;
+							// Bit in every byte
+#endif // PACK_WORDS
 
 
   //
   // Do whole bytes first...
   //
 
+#ifdef PACK_WORDS
+  for (; width > 7; width -= 8, ipixels += 8)
+    *obytes++ = clearto ^
+                pack_gather(pack_nonzero(pack_load(ipixels) & mask));
+#endif // PACK_WORDS
+
   while (width > 7)
   {
     b = clearto;
@@ -260,6 +303,21 @@ cfPackVertical(const unsigned char *ipixels,	// I - Input pixels
 
   while (width > 7)
   {
+#ifdef PACK_WORDS
+    //
+    // Skip runs of 8 blank pixels, which are common in dot-matrix and
+    // inkjet data...
+    //
+
+    if (!pack_load(ipixels))
+    {
+      ipixels += 8;
+      obytes  += 8 * step;
+      width   -= 8;
+      continue;
+    }
+#endif // PACK_WORDS
+
     if (*ipixels++)
       *obytes ^= bit;
     obytes += step;
@@ -519,8 +519,8 @@ cmyk_to_cmy_line(unsigned char *src,		// I - source path
 		 pclmtoraster_data_t *data)	// I - (unused) conversion data
 {
   // Converted first to RGB and then to cmy for better outputs.
-  cfImageCMYKToRGB(src, src, pixels);
-  cfImageRGBToCMY(src, dst, pixels);
+  cfImageCMYKToRGB(src, dst, pixels);
+  cfImageRGBToCMY(dst, dst, pixels);
   return (dst);
 }
 
@@ -659,18 +659,17 @@ convert_line(unsigned char 	*src,	// I - Input line
     dst = convertcspace(src, dst, row, pixels, data);
   else
   {
-    // Handle bit depth conversion if necessary
-    for (unsigned int i = 0; i < pixels; i ++)
-    {
-      unsigned char pixelBuf1[MAX_BYTES_PER_PIXEL];
-      unsigned char pixelBuf2[MAX_BYTES_PER_PIXEL];
-      unsigned char *pb;
-      pb = convertcspace(src + i * data->numcolors, pixelBuf1, row, 1, data);
-      pb = cfConvertBits(pb, pixelBuf2, i, row, data->header.cupsNumColors,
-			 data->header.cupsBitsPerColor);
-      cfWritePixel(dst, plane, i, pb, data->header.cupsNumColors,
-		   data->header.cupsBitsPerColor, data->header.cupsColorOrder);
-    }
+    // Handle bit depth conversion if necessary, convert the color space
+    // of the whole line first and then the bits of the whole line
+    unsigned char *bp = convertcspace(src, buf, row, pixels, data);
+    unsigned int step = (bp == src ? data->numcolors :
+			 data->header.cupsNumColors);
+
+    dst = cfConvertBitsLine(bp, step, dst, plane, pixels, row,
+			    data->header.cupsNumColors,
+			    data->header.cupsBitsPerColor,
+			    data->header.cupsBitsPerColor,
+			    data->header.cupsColorOrder);
   }
   return (dst);
 }
@@ -723,18 +722,15 @@ convert_reverse_line(unsigned char	*src,		// I - Input line
   else
   {
     // General reverse with bit conversion
-    for (unsigned int i = 0; i < pixels; i ++)
-    {
-      unsigned char pixelBuf1[MAX_BYTES_PER_PIXEL];
-      unsigned char pixelBuf2[MAX_BYTES_PER_PIXEL];
-      unsigned char *pb;
-      pb = convertcspace(src + (pixels - i - 1) * (data->numcolors), pixelBuf1,
-			 row, 1, data);
-      pb = cfConvertBits(pb, pixelBuf2, i, row, data->header.cupsNumColors,
-			 data->header.cupsBitsPerColor);
-      cfWritePixel(dst, plane, i, pb, data->header.cupsNumColors,
-		   data->header.cupsBitsPerColor, data->header.cupsColorOrder);
-    }
+    unsigned char *bp = convertcspace(src, buf, row, pixels, data);
+    unsigned int step = (bp == src ? data->numcolors :
+			 data->header.cupsNumColors);
+
+    dst = cfConvertBitsLine(bp + (pixels - 1) * step, -(int)step, dst, plane,
+			    pixels, row, data->header.cupsNumColors,
+			    data->header.cupsBitsPerColor,
+			    data->header.cupsBitsPerColor,
+			    data->header.cupsColorOrder);
   }
   return (dst);
 }
@@ -937,6 +933,7 @@ out_page(cups_raster_t*	 raster, 	// I - Raster stream
 			*lineBuf = NULL,
 			*line = NULL,
 			*dp = NULL;
+  unsigned int		bufsize;
   pdfio_obj_t		*colorspace_obj;
 
 
@@ -1130,7 +1127,12 @@ out_page(cups_raster_t*	 raster, 	// I - Raster stream
   colordata = data->bitmap;
 
   // Write page image
-  lineBuf = (unsigned char *)malloc(data->bytesPerLine * sizeof(unsigned char));
+  // The line buffer also takes the color-converted 8-bit line before
+  // the bits get converted
+  bufsize = data->header.cupsWidth * data->header.cupsNumColors;
+  if (bufsize < data->bytesPerLine)
+    bufsize = data->bytesPerLine;
+  lineBuf = (unsigned char *)malloc(bufsize * sizeof(unsigned char));
   line = (unsigned char *)malloc(data->bytesPerLine * sizeof(unsigned char));
 
   if (data->header.Duplex && (pgno & 1) && data->swap_image_y)
@@ -70,6 +70,7 @@
 #else
 #include <lcms2.h>
 #endif
+#include <cupsfilters/colormanager-private.h>
 
 #define MAX_CHECK_COMMENT_LINES 20
 #define MAX_BYTES_PER_PIXEL 32
@@ -101,6 +102,14 @@ init_cms_profile_t(cms_profile_t *profile)	// I - profile structure to init
   profile->cm_disabled = 0;
 }
 
+struct pdftoraster_doc_s;
+
+typedef unsigned char *(*convert_cspace_line_func)(unsigned char *src,
+                                                   unsigned char *dst,
+                                                   unsigned int row,
+                                                   unsigned int pixels,
+                                                   struct pdftoraster_doc_s *doc);
+
 typedef struct pdftoraster_doc_s
 {
   char *input_filename;
@@ -129,6 +138,16 @@ typedef struct pdftoraster_doc_s
                              // Note: When CUPS_ORDER_BANDED,
                              // cupsBytesPerLine = bytesPerLine * cupsNumColors
   cms_profile_t *colour_profile;
+  // whole-line colour space conversion
+  convert_cspace_line_func convertCSpaceLine;
+  unsigned int cspaceBytes;  // bytes per pixel of the converted line
+  unsigned char *cspaceBuf;  // converted line
+  double *cspaceLab;         // Lab/XYZ values of the line, only for
+                             // CIELab/CIEXYZ output
+  bool cspaceUseLab;         // Does the conversion need cspaceLab?
+  unsigned char *cspaceSrc;  // source of the last converted line ...
+  unsigned int cspaceRow;    // ... and its row number
+  unsigned char *cspaceLine;
 } pdftoraster_doc_t;         
 
 typedef unsigned char *(*convert_cspace_func)(unsigned char *src,
@@ -170,6 +189,15 @@ init_pdftoraster_doc_t(pdftoraster_doc_t *doc)	// 0 - document structure.
   doc->swap_margin_x = false;
   doc->swap_margin_y = false;
 
+  doc->convertCSpaceLine = NULL;
+  doc->cspaceBytes = 0;
+  doc->cspaceBuf = NULL;
+  doc->cspaceLab = NULL;
+  doc->cspaceUseLab = false;
+  doc->cspaceSrc = NULL;
+  doc->cspaceRow = 0;
+  doc->cspaceLine = NULL;
+
   doc->colour_profile = (cms_profile_t *)malloc(sizeof(cms_profile_t)); 
   init_cms_profile_t(doc->colour_profile);
 }
@@ -955,6 +983,213 @@ convert_cspace_lab_16(unsigned char *src,	// I - Source CS
   return (pixelBuf);
 }
 
+//
+// Whole-line versions of the colour space conversions above.  They
+// convert all pixels of a line with a single call, so that the colour
+// transform is called once per line and not once per pixel.  The
+// per-pixel functions are kept for the conversions without a line
+// version and as reference.
+//
+
+//
+// 'convert_cspace_line_none()' - Return the line unchanged
+//
+
+static unsigned char*				  // O - Output line
+convert_cspace_line_none(unsigned char *src,	// I - Source line
+			 unsigned char *dst,	// I - Line Buffer
+			 unsigned int row,	// I - Row index
+			 unsigned int pixels,	// I - Number of pixels
+			 pdftoraster_doc_t *doc)	// I - document with conversion details
+{
+  return (src);
+}
+
+//
+// 'convert_cspace_line_with_profiles()' - Convert the Colour Space of a line,
+//                                         output should have profiles
+//
+
+static unsigned char*					  // O - Output line
+convert_cspace_line_with_profiles(unsigned char *src,	// I - Source line
+				  unsigned char *dst,	// I - Line Buffer
+				  unsigned int row,	// I - Row index
+				  unsigned int pixels,	// I - Number of pixels
+				  pdftoraster_doc_t *doc)	// I - document with conversion details
+{
+  cmsDoTransform(doc->colour_profile->colorTransform, src, dst, pixels);
+  return (dst);
+}
+
+//
+// 'convert_cspace_line_xyz_8()' - Convert Colourspace of a line, with x*y*z
+//                                 colourspace of 8 bits
+//
+
+static unsigned char*				  // O - Output line
+convert_cspace_line_xyz_8(unsigned char *src,	// I - Source line
+			  unsigned char *dst,	// I - Line Buffer
+			  unsigned int row,	// I - Row index
+			  unsigned int pixels,	// I - Number of pixels
+			  pdftoraster_doc_t *doc)	// I - document with conversion details
+{
+  double *alab = doc->cspaceLab;
+  unsigned char *dp = dst;
+  cmsCIELab lab;
+  cmsCIEXYZ xyz;
+
+  cmsDoTransform(doc->colour_profile->colorTransform, src, alab, pixels);
+  for (unsigned int i = 0; i < pixels; i ++, alab += 3, dp += 3)
+  {
+    lab.L = alab[0];
+    lab.a = alab[1];
+    lab.b = alab[2];
+
+    cmsLab2XYZ(&(doc->colour_profile->D65WhitePoint), &xyz, &lab);
+    dp[0] = 231.8181 * xyz.X + 0.5;
+    dp[1] = 231.8181 * xyz.Y + 0.5;
+    dp[2] = 231.8181 * xyz.Z + 0.5;
+  }
+  return (dst);
+}
+
+//
+// 'convert_cspace_line_xyz_16()' - Convert Colourspace of a line, with x*y*z
+//                                  colourspace of 16 bits
+//
+
+static unsigned char*				  // O - Output line
+convert_cspace_line_xyz_16(unsigned char *src,	// I - Source line
+			   unsigned char *dst,	// I - Line Buffer
+			   unsigned int row,	// I - Row index
+			   unsigned int pixels,	// I - Number of pixels
+			   pdftoraster_doc_t *doc)	// I - document with conversion details
+{
+  double *alab = doc->cspaceLab;
+  unsigned short *sd = (unsigned short *)dst;
+  cmsCIELab lab;
+  cmsCIEXYZ xyz;
+
+  cmsDoTransform(doc->colour_profile->colorTransform, src, alab, pixels);
+  for (unsigned int i = 0; i < pixels; i ++, alab += 3, sd += 3)
+  {
+    lab.L = alab[0];
+    lab.a = alab[1];
+    lab.b = alab[2];
+
+    cmsLab2XYZ(&(doc->colour_profile->D65WhitePoint), &xyz, &lab);
+    sd[0] = 59577.2727 * xyz.X + 0.5;
+    sd[1] = 59577.2727 * xyz.Y + 0.5;
+    sd[2] = 59577.2727 * xyz.Z + 0.5;
+  }
+  return (dst);
+}
+
+//
+// 'convert_cspace_line_lab_8()' - Convert Colourspace of a line, with l*a*b
+//                                 colourspace of 8 bits
+//
+
+static unsigned char*				  // O - Output line
+convert_cspace_line_lab_8(unsigned char *src,	// I - Source line
+			  unsigned char *dst,	// I - Line Buffer
+			  unsigned int row,	// I - Row index
+			  unsigned int pixels,	// I - Number of pixels
+			  pdftoraster_doc_t *doc)	// I - document with conversion details
+{
+  double *lab = doc->cspaceLab;
+  unsigned char *dp = dst;
+
+  cmsDoTransform(doc->colour_profile->colorTransform, src, lab, pixels);
+  for (unsigned int i = 0; i < pixels; i ++, lab += 3, dp += 3)
+  {
+    dp[0] = 2.55 * lab[0] + 0.5;
+    dp[1] = lab[1] + 128.5;
+    dp[2] = lab[2] + 128.5;
+  }
+  return (dst);
+}
+
+//
+// 'convert_cspace_line_lab_16()' - Convert Colourspace of a line, with l*a*b
+//                                  colourspace of 16 bits
+//
+
+static unsigned char*				  // O - Output line
+convert_cspace_line_lab_16(unsigned char *src,	// I - Source line
+			   unsigned char *dst,	// I - Line Buffer
+			   unsigned int row,	// I - Row index
+			   unsigned int pixels,	// I - Number of pixels
+			   pdftoraster_doc_t *doc)	// I - document with conversion details
+{
+  double *lab = doc->cspaceLab;
+  unsigned short *sd = (unsigned short *)dst;
+
+  cmsDoTransform(doc->colour_profile->colorTransform, src, lab, pixels);
+  for (unsigned int i = 0; i < pixels; i ++, lab += 3, sd += 3)
+  {
+    sd[0] = 655.35 * lab[0] + 0.5;
+    sd[1] = 256 * (lab[1] + 128) + 0.5;
+    sd[2] = 256 * (lab[2] + 128) + 0.5;
+  }
+  return (dst);
+}
+
+//
+// 'convert_cspace_line_cmyk()' - Convert Colourspace of a line, r*g*b of
+//                                8 bits to c*m*y*k
+//
+
+static unsigned char*				  // O - Output line
+convert_cspace_line_cmyk(unsigned char *src,	// I - Source line
+			 unsigned char *dst,	// I - Line Buffer
+			 unsigned int row,	// I - Row index
+			 unsigned int pixels,	// I - Number of pixels
+			 pdftoraster_doc_t *doc)	// I - document with conversion details
+{
+  cfImageRGBToCMYK(src, dst, pixels);
+  return (dst);
+}
+
+//
+// 'convert_cspace_line_cmy()' - Convert Colourspace of a line, r*g*b of
+//                               8 bits to c*m*y
+//
+
+static unsigned char*				  // O - Output line
+convert_cspace_line_cmy(unsigned char *src,	// I - Source line
+			unsigned char *dst,	// I - Line Buffer
+			unsigned int row,	// I - Row index
+			unsigned int pixels,	// I - Number of pixels
+			pdftoraster_doc_t *doc)	// I - document with conversion details
+{
+  cfImageRGBToCMY(src, dst, pixels);
+  return (dst);
+}
+
+//
+// 'cspace_line()' - Convert the colour space of a whole line, re-using the
+//                   result when the same line is requested again for the
+//                   next band or plane
+//
+
+static unsigned char*			  // O - Converted line
+cspace_line(unsigned char *src,		// I - Source line
+	    unsigned int row,		// I - Row index
+	    unsigned int pixels,	// I - Number of pixels
+	    pdftoraster_doc_t *doc)	// I - document with conversion details
+{
+  if (doc->cspaceLine == NULL || src != doc->cspaceSrc ||
+      row != doc->cspaceRow)
+  {
+    doc->cspaceLine = doc->convertCSpaceLine(src, doc->cspaceBuf, row,
+					     pixels, doc);
+    doc->cspaceSrc = src;
+    doc->cspaceRow = row;
+  }
+  return (doc->cspaceLine);
+}
+
 //
 // 'rgb_8_to_rgba()' - Convert Colourspace, r*g*b of 8 bits to r*g*b with alpha channel
 //
@@ -1132,6 +1367,16 @@ convert_line_chunked(unsigned char *src,		// I - source Pixel line
 		     pdftoraster_doc_t *doc,		// I - Document with output
 		     convert_cspace_func convertCSpace)	// I - CSpace
 {
+  if (doc->convertCSpaceLine)
+  {
+    unsigned char *sp = cspace_line(src, row, pixels, doc);
+
+    return (cfConvertBitsLine(sp, doc->cspaceBytes, dst, 0, pixels, row,
+			      doc->header.cupsNumColors, doc->bitspercolor,
+			      doc->header.cupsBitsPerColor,
+			      doc->header.cupsColorOrder));
+  }
+
   // Assumed that BitsPerColor is 8
   for (unsigned int i = 0; i < pixels; i ++)
   {
@@ -1163,6 +1408,17 @@ convert_line_chunked_swap(unsigned char *src,		// I - Source Pixel line
 			  pdftoraster_doc_t* doc,	// I - Document with output
 			  convert_cspace_func convertCSpace)	// I - CSpace
 {
+  if (doc->convertCSpaceLine)
+  {
+    unsigned char *sp = cspace_line(src, row, pixels, doc) +
+			(pixels - 1) * doc->cspaceBytes;
+
+    return (cfConvertBitsLine(sp, -(int)doc->cspaceBytes, dst, 0, pixels, row,
+			      doc->header.cupsNumColors, doc->bitspercolor,
+			      doc->header.cupsBitsPerColor,
+			      doc->header.cupsColorOrder));
+  }
+
   // Assumed that BitsPerColor is 8
   for (unsigned int i = 0; i < pixels; i++)
   {
@@ -1195,6 +1451,16 @@ convert_line_plane(unsigned char *src,			// I - Source Pixel line
 		   pdftoraster_doc_t *doc,		// I - Document of output
 		   convert_cspace_func convertCSpace)	// I - CSpace
 {
+  if (doc->convertCSpaceLine)
+  {
+    unsigned char *sp = cspace_line(src, row, pixels, doc);
+
+    return (cfConvertBitsLine(sp, doc->cspaceBytes, dst, plane, pixels, row,
+			      doc->header.cupsNumColors, doc->bitspercolor,
+			      doc->header.cupsBitsPerColor,
+			      doc->header.cupsColorOrder));
+  }
+
   // Assumed that BitsPerColor is 8
   for (unsigned int i = 0; i < pixels; i ++)
   {
@@ -1226,6 +1492,17 @@ convert_line_plane_swap(unsigned char *src,
 			pdftoraster_doc_t *doc,
 			convert_cspace_func convertCSpace)
 {
+  if (doc->convertCSpaceLine)
+  {
+    unsigned char *sp = cspace_line(src, row, pixels, doc) +
+			(pixels - 1) * doc->cspaceBytes;
+
+    return (cfConvertBitsLine(sp, -(int)doc->cspaceBytes, dst, plane, pixels,
+			      row, doc->header.cupsNumColors, doc->bitspercolor,
+			      doc->header.cupsBitsPerColor,
+			      doc->header.cupsColorOrder));
+  }
+
   for (unsigned int i = 0; i < pixels; i ++)
   {
     unsigned char pixelBuf1[MAX_BYTES_PER_PIXEL];
@@ -1403,39 +1680,62 @@ select_convert_func(cups_raster_t *raster,		// I - CUPS Raster data
       case CUPS_CSPACE_ICCE:
       case CUPS_CSPACE_ICCF:
 	  if (doc->header.cupsBitsPerColor == 8)
+	  {
 	    convert->convertCSpace = convert_cspace_lab_8;
+	    doc->convertCSpaceLine = convert_cspace_line_lab_8;
+	  }
 	  else
+	  {
 	    // 16 bits
 	    convert->convertCSpace = convert_cspace_lab_16;
+	    doc->convertCSpaceLine = convert_cspace_line_lab_16;
+	  }
 	  bytes = 0; // double
+	  doc->cspaceBytes = 3 * (doc->header.cupsBitsPerColor / 8);
+	  doc->cspaceUseLab = true;
 	  break;
       case CUPS_CSPACE_CIEXYZ:
 	  if (doc->header.cupsBitsPerColor == 8)
+	  {
 	    convert->convertCSpace = convert_cspace_xyz_8;
+	    doc->convertCSpaceLine = convert_cspace_line_xyz_8;
+	  }
 	  else
+	  {
 	    // 16 bits
 	    convert->convertCSpace = convert_cspace_xyz_16;
+	    doc->convertCSpaceLine = convert_cspace_line_xyz_16;
+	  }
 	  bytes = 0; // double
+	  doc->cspaceBytes = 3 * (doc->header.cupsBitsPerColor / 8);
+	  doc->cspaceUseLab = true;
 	  break;
       default:
 	  convert->convertCSpace = convert_cspace_with_profiles;
+	  doc->convertCSpaceLine = convert_cspace_line_with_profiles;
 	  bytes = doc->header.cupsBitsPerColor / 8;
+	  doc->cspaceBytes = doc->header.cupsNumColors * bytes;
 	  break;
     }
+    // The transform reads 3-channel pixels, so the line can only be
+    // converted in one go if the rendered input is RGB
+    if (doc->popplerNumColors != 3 || doc->cspaceBytes == 0 ||
+	doc->cspaceBytes > MAX_BYTES_PER_PIXEL)
+      doc->convertCSpaceLine = NULL;
     doc->bitspercolor = 0; // convert bits in convertCSpace
     if (doc->colour_profile->popplerColorProfile == NULL)
       doc->colour_profile->popplerColorProfile = cmsCreate_sRGBProfile();
     unsigned int dcst =
       get_cms_color_space_type(cmsGetColorSpace(doc->colour_profile->colorProfile));
     if ((doc->colour_profile->colorTransform =
-	 cmsCreateTransform(doc->colour_profile->popplerColorProfile,
-			    COLORSPACE_SH(PT_RGB) | CHANNELS_SH(3) |
-			    BYTES_SH(1),
-			    doc->colour_profile->colorProfile,
-			    COLORSPACE_SH(dcst) |
-			    CHANNELS_SH(doc->header.cupsNumColors) |
-			    BYTES_SH(bytes),
-			    doc->colour_profile->renderingIntent, 0)) == 0)
+	 _cfCmTransformGet(doc->colour_profile->popplerColorProfile,
+			   COLORSPACE_SH(PT_RGB) | CHANNELS_SH(3) |
+			   BYTES_SH(1),
+			   doc->colour_profile->colorProfile,
+			   COLORSPACE_SH(dcst) |
+			   CHANNELS_SH(doc->header.cupsNumColors) |
+			   BYTES_SH(bytes),
+			   doc->colour_profile->renderingIntent, 0)) == 0)
     {
       if (log) log(ld, CF_LOGLEVEL_ERROR,
 		   "cfFilterPDFToRaster: Can't create color transform.");
@@ -1465,15 +1765,21 @@ select_convert_func(cups_raster_t *raster,		// I - CUPS Raster data
       case CUPS_CSPACE_ICCF:
       case CUPS_CSPACE_CIEXYZ:
 	  convert->convertCSpace = convert_cspace_none;
+	  doc->convertCSpaceLine = convert_cspace_line_none;
+	  doc->cspaceBytes = doc->popplerNumColors;
 	  break;
       case CUPS_CSPACE_CMY:
 	  convert->convertCSpace = rgb_8_to_cmy;
+	  doc->convertCSpaceLine = convert_cspace_line_cmy;
+	  doc->cspaceBytes = 3;
 	  break;
       case CUPS_CSPACE_YMC:
 	  convert->convertCSpace = rgb_8_to_ymc;
 	  break;
       case CUPS_CSPACE_CMYK:
 	  convert->convertCSpace = rgb_8_to_cmyk;
+	  doc->convertCSpaceLine = convert_cspace_line_cmyk;
+	  doc->cspaceBytes = 4;
 	  break;
       case CUPS_CSPACE_KCMY:
 	  convert->convertCSpace = rgb_8_to_kcmy;
@@ -1499,11 +1805,15 @@ select_convert_func(cups_raster_t *raster,		// I - CUPS Raster data
       case CUPS_CSPACE_SRGB:
       case CUPS_CSPACE_ADOBERGB:
 	  convert->convertCSpace = convert_cspace_none;
+	  doc->convertCSpaceLine = convert_cspace_line_none;
+	  doc->cspaceBytes = doc->popplerNumColors;
 	  break;
       case CUPS_CSPACE_W:
       case CUPS_CSPACE_SW:
       case CUPS_CSPACE_WHITE:
 	  convert->convertCSpace = convert_cspace_none;
+	  doc->convertCSpaceLine = convert_cspace_line_none;
+	  doc->cspaceBytes = doc->popplerNumColors;
 	  break;
       case CUPS_CSPACE_K:
       case CUPS_CSPACE_GOLD:
@@ -2058,11 +2368,43 @@ write_page_image(cups_raster_t *raster,			// I - Cups raster output data struct
   unsigned int copy_height = (height < doc->header.cupsHeight) ? height : doc->header.cupsHeight;
   unsigned int copy_width = (width < doc->header.cupsWidth) ? width : doc->header.cupsWidth;
 
+  // Buffers for converting the colour space of a whole line at once,
+  // fall back to converting pixel by pixel if we cannot get them
+  if (doc->convertCSpaceLine)
+  {
+    doc->cspaceBuf = (unsigned char *)calloc(copy_width, doc->cspaceBytes);
+    if (doc->cspaceUseLab)
+      doc->cspaceLab = (double *)calloc(copy_width * 3, sizeof(double));
+    doc->cspaceLine = NULL;
+
+    if (!doc->cspaceBuf || (doc->cspaceUseLab && !doc->cspaceLab))
+    {
+      free(doc->cspaceBuf);
+      doc->cspaceBuf = NULL;
+      if (doc->cspaceUseLab)
+      {
+        free(doc->cspaceLab);
+        doc->cspaceLab = NULL;
+      }
+      doc->convertCSpaceLine = NULL;
+    }
+  }
+
   copy_image_rows(raster, doc, convert, pageNo, colordata, image_rowsize,
                   copy_height, copy_width, lineBuf, bg_color);
   free(colordata);
   if (lineBuf) 
     free(lineBuf);
+  if (doc->convertCSpaceLine)
+  {
+    free(doc->cspaceBuf);
+    doc->cspaceBuf = NULL;
+    if (doc->cspaceUseLab)
+    {
+      free(doc->cspaceLab);
+      doc->cspaceLab = NULL;
+    }
+  }
 }
 
 //
@@ -2726,7 +3068,7 @@ cfFilterPDFToRaster(int inputfd,            // I - File descriptor input stream
       doc.colour_profile->colorProfile)
     cmsCloseProfile(doc.colour_profile->popplerColorProfile);
   if (doc.colour_profile->colorTransform != NULL)
-    cmsDeleteTransform(doc.colour_profile->colorTransform);
+    _cfCmTransformRelease(doc.colour_profile->colorTransform);
 
   return (ret);
 }
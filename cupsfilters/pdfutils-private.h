@@ -36,6 +36,17 @@ typedef struct
 {
   long filepos;
 
+  int fd;           // output file descriptor
+  char *buf;        // output buffer
+  int bufused;      // bytes in output buffer
+  int error;        // a write has failed
+
+  int compress;     // flate streams and xref stream (PDF 1.5)?
+  int instream;     // capturing stream data?
+  char *stream;     // captured (compressed) stream data
+  long streamsize, streamalloc;
+  void *zstream;    // zlib state for compressing stream data
+
   int pagessize, pagesalloc;
   int *pages;
 
@@ -51,10 +62,12 @@ typedef struct
 // Prototypes...
 //
 
-// allocates a new _cf_pdf_out_t structure
+// allocates a new _cf_pdf_out_t structure writing to stdout
+// or to >fd; output is buffered per structure, not via stdio
 // returns NULL on error
 
 _cf_pdf_out_t *_cfPDFOutNew();
+_cf_pdf_out_t *_cfPDFOutNewFD(int fd);
 void _cfPDFOutFree(_cf_pdf_out_t *pdf);
 
 // start outputting a pdf
@@ -63,6 +76,23 @@ void _cfPDFOutFree(_cf_pdf_out_t *pdf);
 int _cfPDFOutBeginPDF(_cf_pdf_out_t *pdf);
 void _cfPDFOutFinishPDF(_cf_pdf_out_t *pdf);
 
+// write out buffered output
+// returns false if any write has failed
+
+int _cfPDFOutFlush(_cf_pdf_out_t *pdf);
+
+// write >len bytes of >buf as-is
+
+void _cfPDFOutWrite(_cf_pdf_out_t *pdf, const char *buf, int len);
+
+// begin stream data: following output is collected, compressed
+// if >compress is set, until _cfPDFOutEndStream() writes it out as
+// a stream object with the dictionary entries in >dict (may be NULL)
+// _cfPDFOutEndStream() returns the obj number, 0 on error
+
+void _cfPDFOutBeginStream(_cf_pdf_out_t *pdf);
+int _cfPDFOutEndStream(_cf_pdf_out_t *pdf, const char *dict);
+
 // General output routine for our pdf.
 // Keeps track of characters actually written out
 
@@ -12,11 +12,97 @@
 #include <memory.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <zlib.h>
 #include "pdfutils-private.h"
 #include "fontembed-private.h"
 #include "debug-internal.h"
 
 
+//
+// Size of the output buffer of each _cf_pdf_out_t
+//
+
+#define PDF_OUT_BUFSIZE 65536
+
+
+//
+// Local functions...
+//
+
+static int pdf_out_stream_data(_cf_pdf_out_t *pdf, const char *buf, int len,
+			       int flush);
+static int pdf_out_stream_grow(_cf_pdf_out_t *pdf, long len);
+
+
+//
+// '_cfPDFOutFlush()' - Write out buffered output
+//
+
+int                                 // O - Return 0 on error
+_cfPDFOutFlush(_cf_pdf_out_t *pdf) // {{{
+{
+  const char *ptr;
+  ssize_t bytes;
+
+
+  DEBUG_assert(pdf);
+
+  for (ptr = pdf->buf; pdf->bufused > 0 && !pdf->error;)
+  {
+    if ((bytes = write(pdf->fd, ptr, pdf->bufused)) < 0)
+    {
+      if (errno == EINTR || errno == EAGAIN)
+	continue;
+      perror("Short write");
+      pdf->error = 1;
+      break;
+    }
+    ptr += bytes;
+    pdf->bufused -= bytes;
+  }
+  pdf->bufused = 0;
+  return (!pdf->error);
+}
+// }}}
+
+
+//
+// '_cfPDFOutWrite()' - Write out bytes as-is
+//
+
+void
+_cfPDFOutWrite(_cf_pdf_out_t *pdf,
+	      const char *buf,
+	      int len) // {{{
+{
+  DEBUG_assert(pdf);
+  DEBUG_assert(buf);
+
+  if (pdf->instream)
+  {
+    pdf_out_stream_data(pdf, buf, len, Z_NO_FLUSH);
+    return;
+  }
+
+  pdf->filepos += len;
+  while (len > 0)
+  {
+    int count = PDF_OUT_BUFSIZE - pdf->bufused;
+    if (count > len)
+      count = len;
+    memcpy(pdf->buf + pdf->bufused, buf, count);
+    pdf->bufused += count;
+    buf += count;
+    len -= count;
+    if (pdf->bufused == PDF_OUT_BUFSIZE)
+      _cfPDFOutFlush(pdf);
+  }
+}
+// }}}
+
+
 //
 // '_cfPDFOutPrintF()' - General output routine for our PDF
 //
@@ -29,14 +115,203 @@ _cfPDFOutPrintF(_cf_pdf_out_t *pdf,
 {
   int len;
   va_list ap;
+  char line[1024];
 
 
   DEBUG_assert(pdf);
 
+  if (pdf->instream)
+  {
+    // stream data, format into a local buffer if it fits
+    va_start(ap, fmt);
+    len = vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+    if (len < 0)
+      return;
+    if (len < (int)sizeof(line))
+    {
+      pdf_out_stream_data(pdf, line, len, Z_NO_FLUSH);
+      return;
+    }
+  }
+  else
+  {
+    // format straight into the output buffer if it fits
+    va_start(ap, fmt);
+    len = vsnprintf(pdf->buf + pdf->bufused, PDF_OUT_BUFSIZE - pdf->bufused,
+		    fmt, ap);
+    va_end(ap);
+    if (len < 0)
+      return;
+    if (len < PDF_OUT_BUFSIZE - pdf->bufused)
+    {
+      pdf->bufused += len;
+      pdf->filepos += len;
+      return;
+    }
+  }
+
+  // otherwise format again into a temporary buffer
+  char *tmp = malloc(len + 1);
+  if (!tmp)
+  {
+    pdf->error = 1;
+    return;
+  }
   va_start(ap, fmt);
-  len = vprintf(fmt, ap);
+  vsnprintf(tmp, len + 1, fmt, ap);
   va_end(ap);
-  pdf->filepos += len;
+  _cfPDFOutWrite(pdf, tmp, len);
+  free(tmp);
+}
+// }}}
+
+
+//
+// '_cfPDFOutBeginStream()' - Begin collecting stream data
+//
+
+void
+_cfPDFOutBeginStream(_cf_pdf_out_t *pdf) // {{{
+{
+  DEBUG_assert(pdf);
+  DEBUG_assert(!pdf->instream);
+
+  pdf->instream = 1;
+  pdf->streamsize = 0;
+
+  if (pdf->compress)
+  {
+    if (!pdf->zstream && (pdf->zstream = calloc(1, sizeof(z_stream))) != NULL &&
+	deflateInit((z_stream *)pdf->zstream, Z_DEFAULT_COMPRESSION) != Z_OK)
+    {
+      free(pdf->zstream);
+      pdf->zstream = NULL;
+    }
+    if (!pdf->zstream)
+      pdf->compress = 0;   // write the stream uncompressed
+  }
+}
+// }}}
+
+
+//
+// '_cfPDFOutEndStream()' - Write out the collected stream data as a
+//                          stream object
+//
+
+int                                 // O - Object number, 0 on error
+_cfPDFOutEndStream(_cf_pdf_out_t *pdf,
+		  const char *dict) // {{{ I - Extra dictionary entries
+{
+  int obj,
+      compressed;
+
+
+  DEBUG_assert(pdf);
+  DEBUG_assert(pdf->instream);
+
+  compressed = pdf->compress;
+  if (compressed)
+  {
+    pdf_out_stream_data(pdf, NULL, 0, Z_FINISH);
+    deflateReset((z_stream *)pdf->zstream);
+  }
+  pdf->instream = 0;
+  if (pdf->error)
+    return (0);
+
+  obj = _cfPDFOutAddXRef(pdf);
+  if (obj < 0)
+    return (0);
+  _cfPDFOutPrintF(pdf,
+		 "%d 0 obj\n"
+		 "<</Length %ld%s%s>>\n"
+		 "stream\n",
+		 obj, pdf->streamsize,
+		 compressed ? "/Filter/FlateDecode" : "",
+		 dict ? dict : "");
+  _cfPDFOutWrite(pdf, pdf->stream, pdf->streamsize);
+  _cfPDFOutPrintF(pdf,
+		 "\nendstream\n"
+		 "endobj\n");
+  return (obj);
+}
+// }}}
+
+
+//
+// 'pdf_out_stream_data()' - Add data to the stream being collected
+//
+
+static int                          // O - Return 0 on error
+pdf_out_stream_data(_cf_pdf_out_t *pdf,
+		    const char *buf,
+		    int len,
+		    int flush) // {{{ I - Z_NO_FLUSH or Z_FINISH
+{
+  z_stream *zs = (z_stream *)pdf->zstream;
+  int status;
+
+
+  if (pdf->error)
+    return (0);
+
+  if (!pdf->compress)
+  {
+    if (pdf->streamsize + len > pdf->streamalloc &&
+	!pdf_out_stream_grow(pdf, len))
+      return (0);
+    memcpy(pdf->stream + pdf->streamsize, buf, len);
+    pdf->streamsize += len;
+    return (1);
+  }
+
+  zs->next_in  = (Bytef *)buf;
+  zs->avail_in = len;
+  do
+  {
+    if (pdf->streamsize == pdf->streamalloc &&
+	!pdf_out_stream_grow(pdf, 1))
+      return (0);
+    zs->next_out  = (Bytef *)pdf->stream + pdf->streamsize;
+    zs->avail_out = pdf->streamalloc - pdf->streamsize;
+    if ((status = deflate(zs, flush)) == Z_STREAM_ERROR)
+    {
+      pdf->error = 1;
+      return (0);
+    }
+    pdf->streamsize = pdf->streamalloc - zs->avail_out;
+  }
+  while (zs->avail_in > 0 || (flush == Z_FINISH && status != Z_STREAM_END));
+
+  return (1);
+}
+// }}}
+
+
+//
+// 'pdf_out_stream_grow()' - Make room for more stream data
+//
+
+static int                          // O - Return 0 on error
+pdf_out_stream_grow(_cf_pdf_out_t *pdf,
+		    long len) // {{{ I - Bytes needed at least
+{
+  long newalloc = pdf->streamalloc ? 2 * pdf->streamalloc : PDF_OUT_BUFSIZE;
+  char *tmp;
+
+
+  while (newalloc < pdf->streamsize + len)
+    newalloc *= 2;
+  if ((tmp = realloc(pdf->stream, newalloc)) == NULL)
+  {
+    pdf->error = 1;
+    return (0);
+  }
+  pdf->stream = tmp;
+  pdf->streamalloc = newalloc;
+  return (1);
 }
 // }}}
 
@@ -56,31 +331,32 @@ _cfPDFOutputString(_cf_pdf_out_t *pdf,
 
   if (len == -1)
     len = strlen(str);
-  putc('(', stdout);
+  _cfPDFOutWrite(pdf, "(", 1);
   // escape special chars: \0 \\ \( \)  -- don't bother about balanced parens
   int iA = 0;
+  char esc[5];
   for (; len > 0; iA ++, len --)
   {
     if ((str[iA] < 32) || (str[iA] > 126))
     {
-      fwrite(str, 1, iA, stdout);
-      fprintf(stdout, "\\%03o", (unsigned char)str[iA]);
-      pdf->filepos += iA + 4;
+      _cfPDFOutWrite(pdf, str, iA);
+      snprintf(esc, sizeof(esc), "\\%03o", (unsigned char)str[iA]);
+      _cfPDFOutWrite(pdf, esc, 4);
       str += iA + 1;
       iA = -1;
     }
     else if ((str[iA] == '(') || (str[iA] == ')') || (str[iA] == '\\'))
     {
-      fwrite(str, 1, iA, stdout);
-      fprintf(stdout, "\\%c" ,str[iA]);
-      pdf->filepos += iA + 2;
+      _cfPDFOutWrite(pdf, str, iA);
+      esc[0] = '\\';
+      esc[1] = str[iA];
+      _cfPDFOutWrite(pdf, esc, 2);
       str += iA + 1;
       iA = -1;
     }
   }
-  pdf->filepos += iA + 2;
-  fwrite(str, 1, iA, stdout);
-  putc(')', stdout);
+  _cfPDFOutWrite(pdf, str, iA);
+  _cfPDFOutWrite(pdf, ")", 1);
 }
 // }}}
 
@@ -97,28 +373,56 @@ _cfPDFOutputHexString(_cf_pdf_out_t *pdf,
   DEBUG_assert(pdf);
   DEBUG_assert(str);
 
+  static const char hex[] = "0123456789abcdef";
+  char digits[2];
+
   if (len == -1)
     len = strlen(str);
-  pdf->filepos += 2 * len + 2;
-  putc('<', stdout);
+  _cfPDFOutWrite(pdf, "<", 1);
   for (; len > 0; str++, len--)
-    fprintf(stdout, "%02x", (unsigned char)*str);
-  putc('>', stdout);
+  {
+    digits[0] = hex[(unsigned char)*str >> 4];
+    digits[1] = hex[*str & 15];
+    _cfPDFOutWrite(pdf, digits, 2);
+  }
+  _cfPDFOutWrite(pdf, ">", 1);
 }
 // }}}
 
 
 //
-// '_cfPDFOutNew()' - Allocates a new _cf_pdf_out_t structure
+// '_cfPDFOutNew()' - Allocates a new _cf_pdf_out_t structure writing to
+//                    stdout
 //
 
 _cf_pdf_out_t * // O - NULL on error
 _cfPDFOutNew()  // {{{
+{
+  return (_cfPDFOutNewFD(1));
+}
+// }}}
+
+
+//
+// '_cfPDFOutNewFD()' - Allocates a new _cf_pdf_out_t structure writing to
+//                      a file descriptor
+//
+
+_cf_pdf_out_t * // O - NULL on error
+_cfPDFOutNewFD(int fd)  // {{{
 {
   _cf_pdf_out_t *ret = malloc(sizeof(_cf_pdf_out_t));
 
   if (ret)
+  {
     memset(ret, 0, sizeof(_cf_pdf_out_t));
+    ret->fd = fd;
+    if ((ret->buf = malloc(PDF_OUT_BUFSIZE)) == NULL)
+    {
+      free(ret);
+      return (NULL);
+    }
+  }
 
   return (ret);
 }
@@ -267,7 +571,11 @@ _cfPDFOutBeginPDF(_cf_pdf_out_t *pdf) // ,...output_device?...) // {{{
   pages_obj = _cfPDFOutAddXRef(pdf); // fixed later
   if (pages_obj != 1)
     return (0);
-  _cfPDFOutPrintF(pdf, "%%PDF-1.3\n");
+  if (pdf->compress)
+    _cfPDFOutPrintF(pdf, "%%PDF-1.5\n"
+		   "%%\342\343\317\323\n"); // binary data follows
+  else
+    _cfPDFOutPrintF(pdf, "%%PDF-1.3\n");
   return (1);
 }
 // }}}
@@ -282,8 +590,8 @@ _cfPDFOutFinishPDF(_cf_pdf_out_t *pdf) // {{{
 {
   int iA;
   int root_obj,
-      info_obj = 0,
-      xref_start;
+      info_obj = 0;
+  long xref_start;
 
 
   DEBUG_assert(pdf && (pdf->filepos != -1));
@@ -334,31 +642,78 @@ _cfPDFOutFinishPDF(_cf_pdf_out_t *pdf) // {{{
   }
   // TODO: some return-value checking (??)
  
-  // write xref
-  xref_start = pdf->filepos;
-  _cfPDFOutPrintF(pdf,
-		 "xref\n"
-		 "%d %d\n"
-		 "%010d 65535 f \n",
-		 0, pdf->xrefsize + 1, 0);
-  for (iA = 0; iA < pdf->xrefsize; iA ++)
-    _cfPDFOutPrintF(pdf, "%010ld 00000 n \n",
-		   pdf->xref[iA]);
-  _cfPDFOutPrintF(pdf,
-		 "trailer\n"
-		 "<<\n"
-		 "  /Size %d\n"
-		 "  /Root %d 0 R\n",
-		 pdf->xrefsize + 1,
-		 root_obj);
-  if (info_obj)
-    _cfPDFOutPrintF(pdf, "  /Info %d 0 R\n", info_obj);
-  _cfPDFOutPrintF(pdf,
-		 ">>\n"
-		 "startxref\n"
-		 "%d\n"
-		 "%%%%EOF\n",
-		 xref_start);
+  if (pdf->compress)
+  {
+    // write xref stream (PDF 1.5), it is the next object
+    unsigned char entry[1 + 8 + 2];
+    char dict[256];
+    int width = 4, // bytes per offset
+        xref_obj = pdf->xrefsize + 1;
+
+    xref_start = pdf->filepos;
+    if (xref_start > 0xffffffffL)
+      width = 8;
+
+    _cfPDFOutBeginStream(pdf);
+    for (iA = 0; iA <= xref_obj; iA ++)
+    {
+      // type, offset, generation
+      long offset = iA == 0 ? 0 :
+	            iA == xref_obj ? xref_start : pdf->xref[iA - 1];
+      int iB;
+
+      entry[0] = iA == 0 ? 0 : 1;
+      for (iB = width; iB > 0; iB --, offset >>= 8)
+	entry[iB] = offset & 255;
+      entry[width + 1] = iA == 0 ? 255 : 0;
+      entry[width + 2] = iA == 0 ? 255 : 0;
+      _cfPDFOutWrite(pdf, (const char *)entry, width + 3);
+    }
+    if (info_obj)
+      snprintf(dict, sizeof(dict),
+	       "/Type/XRef/W[1 %d 2]/Size %d/Root %d 0 R/Info %d 0 R",
+	       width, xref_obj + 1, root_obj, info_obj);
+    else
+      snprintf(dict, sizeof(dict),
+	       "/Type/XRef/W[1 %d 2]/Size %d/Root %d 0 R",
+	       width, xref_obj + 1, root_obj);
+    _cfPDFOutEndStream(pdf, dict);
+    _cfPDFOutPrintF(pdf,
+		   "startxref\n"
+		   "%ld\n"
+		   "%%%%EOF\n",
+		   xref_start);
+  }
+  else
+  {
+    // write xref
+    xref_start = pdf->filepos;
+    _cfPDFOutPrintF(pdf,
+		   "xref\n"
+		   "%d %d\n"
+		   "%010d 65535 f \n",
+		   0, pdf->xrefsize + 1, 0);
+    for (iA = 0; iA < pdf->xrefsize; iA ++)
+      _cfPDFOutPrintF(pdf, "%010ld 00000 n \n",
+		     pdf->xref[iA]);
+    _cfPDFOutPrintF(pdf,
+		   "trailer\n"
+		   "<<\n"
+		   "  /Size %d\n"
+		   "  /Root %d 0 R\n",
+		   pdf->xrefsize + 1,
+		   root_obj);
+    if (info_obj)
+      _cfPDFOutPrintF(pdf, "  /Info %d 0 R\n", info_obj);
+    _cfPDFOutPrintF(pdf,
+		   ">>\n"
+		   "startxref\n"
+		   "%ld\n"
+		   "%%%%EOF\n",
+		   xref_start);
+  }
+
+  _cfPDFOutFlush(pdf);
 
   // set to done
   pdf->filepos = -1;
@@ -381,8 +736,22 @@ _cfPDFOutFree(_cf_pdf_out_t *pdf) // {{{
 {
   if (pdf)
   {
-    DEBUG_assert(pdf->kvsize == 0); // otherwise: finish_pdf has not been called
+    // write out what we have even if finish_pdf has not been called
+    _cfPDFOutFlush(pdf);
+    while (pdf->kvsize > 0)
+    {
+      pdf->kvsize --;
+      free(pdf->kv[pdf->kvsize].key);
+      free(pdf->kv[pdf->kvsize].value);
+    }
 
+    if (pdf->zstream)
+    {
+      deflateEnd((z_stream *)pdf->zstream);
+      free(pdf->zstream);
+    }
+    free(pdf->stream);
+    free(pdf->buf);
     free(pdf->kv);
     free(pdf->pages);
     free(pdf->xref);
@@ -399,13 +768,7 @@ pdf_out_outfn(const char *buf,
 {
   _cf_pdf_out_t *pdf = (_cf_pdf_out_t *)context;
 
-  if (fwrite(buf, 1, len, stdout) != len)
-  {
-    perror("Short write");
-    DEBUG_assert(0);
-    return;
-  }
-  pdf->filepos += len;
+  _cfPDFOutWrite(pdf, buf, len);
 }
 // }}}
 
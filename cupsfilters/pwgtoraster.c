@@ -64,6 +64,7 @@
 #else
 #include <lcms2.h>
 #endif
+#include <cupsfilters/colormanager-private.h>
 
 #define MAX_BYTES_PER_PIXEL 32
 
@@ -79,6 +80,14 @@ typedef struct cms_profile_s
   cf_cm_calibration_t cm_calibrate;
 } cms_profile_t;
 
+struct pwgtoraster_doc_s;
+
+typedef unsigned char *(*convert_cspace_line_func)(unsigned char *src,
+						   unsigned char *dst,
+						   unsigned int row,
+						   unsigned int pixels,
+						   struct pwgtoraster_doc_s *doc);
+
 typedef struct pwgtoraster_doc_s
 {                // **** Document information ****
   cf_filter_data_t *data;
@@ -101,6 +110,16 @@ typedef struct pwgtoraster_doc_s
                         // Note: When CUPS_ORDER_BANDED,
                         // cupsBytesPerLine = bytesPerLine * cupsNumColors
   cms_profile_t color_profile;
+  // whole-line color space conversion
+  convert_cspace_line_func convertCSpaceLine;
+  unsigned int cspaceBytes; // bytes per pixel of the converted line
+  unsigned char *cspaceBuf; // converted line
+  double *cspaceLab;        // Lab/XYZ values of the line, only for
+                            // CIELab/CIEXYZ output
+  bool cspaceUseLab;        // Does the conversion need cspaceLab?
+  unsigned char *cspaceSrc; // source of the last converted line ...
+  unsigned int cspaceRow;   // ... and its row number
+  unsigned char *cspaceLine;
 } pwgtoraster_doc_t;
 
 typedef unsigned char *(*convert_cspace_func)(unsigned char *src,
@@ -761,6 +780,188 @@ convert_cspace_lab_16(unsigned char *src,
 }
 
 
+//
+// Whole-line versions of the color space conversions above.  They
+// convert all pixels of a line with a single call, so that the color
+// transform is called once per line and not once per pixel.  The
+// per-pixel functions are kept for the conversions without a line
+// version and as reference.
+//
+
+static unsigned char *
+convert_cspace_line_none(unsigned char *src,
+			 unsigned char *dst,
+			 unsigned int row,
+			 unsigned int pixels,
+			 pwgtoraster_doc_t *doc)
+{
+  return (src);
+}
+
+
+static unsigned char *
+convert_cspace_line_with_profiles(unsigned char *src,
+				  unsigned char *dst,
+				  unsigned int row,
+				  unsigned int pixels,
+				  pwgtoraster_doc_t *doc)
+{
+  cmsDoTransform(doc->color_profile.colorTransform, src, dst, pixels);
+  return (dst);
+}
+
+
+static unsigned char *
+convert_cspace_line_xyz_8(unsigned char *src,
+			  unsigned char *dst,
+			  unsigned int row,
+			  unsigned int pixels,
+			  pwgtoraster_doc_t *doc)
+{
+  double *alab = doc->cspaceLab;
+  unsigned char *dp = dst;
+  cmsCIELab lab;
+  cmsCIEXYZ xyz;
+
+  cmsDoTransform(doc->color_profile.colorTransform, src, alab, pixels);
+
+  for (unsigned int i = 0; i < pixels; i ++, alab += 3, dp += 3)
+  {
+    lab.L = alab[0];
+    lab.a = alab[1];
+    lab.b = alab[2];
+
+    cmsLab2XYZ(&(doc->color_profile.D65WhitePoint), &xyz, &lab);
+    dp[0] = 231.8181 * xyz.X + 0.5;
+    dp[1] = 231.8181 * xyz.Y + 0.5;
+    dp[2] = 231.8181 * xyz.Z + 0.5;
+  }
+
+  return (dst);
+}
+
+
+static unsigned char *
+convert_cspace_line_xyz_16(unsigned char *src,
+			   unsigned char *dst,
+			   unsigned int row,
+			   unsigned int pixels,
+			   pwgtoraster_doc_t *doc)
+{
+  double *alab = doc->cspaceLab;
+  unsigned short *sd = (unsigned short *)dst;
+  cmsCIELab lab;
+  cmsCIEXYZ xyz;
+
+  cmsDoTransform(doc->color_profile.colorTransform, src, alab, pixels);
+
+  for (unsigned int i = 0; i < pixels; i ++, alab += 3, sd += 3)
+  {
+    lab.L = alab[0];
+    lab.a = alab[1];
+    lab.b = alab[2];
+
+    cmsLab2XYZ(&(doc->color_profile.D65WhitePoint), &xyz, &lab);
+    sd[0] = 59577.2727 * xyz.X + 0.5;
+    sd[1] = 59577.2727 * xyz.Y + 0.5;
+    sd[2] = 59577.2727 * xyz.Z + 0.5;
+  }
+
+  return (dst);
+}
+
+
+static unsigned char *
+convert_cspace_line_lab_8(unsigned char *src,
+			  unsigned char *dst,
+			  unsigned int row,
+			  unsigned int pixels,
+			  pwgtoraster_doc_t *doc)
+{
+  double *lab = doc->cspaceLab;
+  unsigned char *dp = dst;
+
+  cmsDoTransform(doc->color_profile.colorTransform, src, lab, pixels);
+
+  for (unsigned int i = 0; i < pixels; i ++, lab += 3, dp += 3)
+  {
+    dp[0] = 2.55 * lab[0] + 0.5;
+    dp[1] = lab[1] + 128.5;
+    dp[2] = lab[2] + 128.5;
+  }
+
+  return (dst);
+}
+
+
+static unsigned char *
+convert_cspace_line_lab_16(unsigned char *src,
+			   unsigned char *dst,
+			   unsigned int row,
+			   unsigned int pixels,
+			   pwgtoraster_doc_t *doc)
+{
+  double *lab = doc->cspaceLab;
+  unsigned short *sd = (unsigned short *)dst;
+
+  cmsDoTransform(doc->color_profile.colorTransform, src, lab, pixels);
+
+  for (unsigned int i = 0; i < pixels; i ++, lab += 3, sd += 3)
+  {
+    sd[0] = 655.35 * lab[0] + 0.5;
+    sd[1] = 256 * (lab[1] + 128) + 0.5;
+    sd[2] = 256 * (lab[2] + 128) + 0.5;
+  }
+
+  return (dst);
+}
+
+
+static unsigned char *
+convert_cspace_line_cmyk(unsigned char *src,
+			 unsigned char *dst,
+			 unsigned int row,
+			 unsigned int pixels,
+			 pwgtoraster_doc_t *doc)
+{
+  cfImageRGBToCMYK(src, dst, pixels);
+  return (dst);
+}
+
+
+static unsigned char *
+convert_cspace_line_cmy(unsigned char *src,
+			unsigned char *dst,
+			unsigned int row,
+			unsigned int pixels,
+			pwgtoraster_doc_t *doc)
+{
+  cfImageRGBToCMY(src, dst, pixels);
+  return (dst);
+}
+
+
+// Convert the color space of a whole line, re-using the result when
+// the same line is requested again for the next band or plane
+static unsigned char *
+cspace_line(unsigned char *src,
+	    unsigned int row,
+	    unsigned int pixels,
+	    pwgtoraster_doc_t *doc)
+{
+  if (doc->cspaceLine == NULL || src != doc->cspaceSrc ||
+      row != doc->cspaceRow)
+  {
+    doc->cspaceLine = doc->convertCSpaceLine(src, doc->cspaceBuf, row,
+					     pixels, doc);
+    doc->cspaceSrc = src;
+    doc->cspaceRow = row;
+  }
+
+  return (doc->cspaceLine);
+}
+
+
 static unsigned char *
 rgb_8_to_rgba(unsigned char *src,
 	      unsigned char *pixelBuf,
@@ -905,6 +1106,16 @@ convert_line_chunked(unsigned char *src,
 		     pwgtoraster_doc_t *doc,
 		     convert_cspace_func convertCSpace)
 {
+  if (doc->convertCSpaceLine)
+  {
+    unsigned char *sp = cspace_line(src, row, pixels, doc);
+
+    return (cfConvertBitsLine(sp, doc->cspaceBytes, dst, 0, pixels, row,
+			      doc->outheader.cupsNumColors, doc->bitspercolor,
+			      doc->outheader.cupsBitsPerColor,
+			      doc->outheader.cupsColorOrder));
+  }
+
   // Assumed that BitsPerColor is 8
   for (unsigned int i = 0; i < pixels; i ++)
   {
@@ -935,6 +1146,17 @@ convert_line_chunked_swap(unsigned char *src,
 			  pwgtoraster_doc_t* doc,
 			  convert_cspace_func convertCSpace)
 {
+  if (doc->convertCSpaceLine)
+  {
+    unsigned char *sp = cspace_line(src, row, pixels, doc) +
+			(pixels - 1) * doc->cspaceBytes;
+
+    return (cfConvertBitsLine(sp, -(int)doc->cspaceBytes, dst, 0, pixels, row,
+			      doc->outheader.cupsNumColors, doc->bitspercolor,
+			      doc->outheader.cupsBitsPerColor,
+			      doc->outheader.cupsColorOrder));
+  }
+
   // Assumed that BitsPerColor is 8
   for (unsigned int i = 0; i < pixels; i++)
   {
@@ -965,6 +1187,16 @@ convert_line_plane(unsigned char *src,
 		   pwgtoraster_doc_t *doc,
 		   convert_cspace_func convertCSpace)
 {
+  if (doc->convertCSpaceLine)
+  {
+    unsigned char *sp = cspace_line(src, row, pixels, doc);
+
+    return (cfConvertBitsLine(sp, doc->cspaceBytes, dst, plane, pixels, row,
+			      doc->outheader.cupsNumColors, doc->bitspercolor,
+			      doc->outheader.cupsBitsPerColor,
+			      doc->outheader.cupsColorOrder));
+  }
+
   // Assumed that BitsPerColor is 8
   for (unsigned int i = 0; i < pixels; i ++)
   {
@@ -994,6 +1226,17 @@ convert_line_plane_swap(unsigned char *src,
 			pwgtoraster_doc_t *doc,
 			convert_cspace_func convertCSpace)
 {
+  if (doc->convertCSpaceLine)
+  {
+    unsigned char *sp = cspace_line(src, row, pixels, doc) +
+			(pixels - 1) * doc->cspaceBytes;
+
+    return (cfConvertBitsLine(sp, -(int)doc->cspaceBytes, dst, plane, pixels,
+			      row, doc->outheader.cupsNumColors, doc->bitspercolor,
+			      doc->outheader.cupsBitsPerColor,
+			      doc->outheader.cupsColorOrder));
+  }
+
   for (unsigned int i = 0; i < pixels; i ++)
   {
     unsigned char pixelBuf1[MAX_BYTES_PER_PIXEL];
@@ -1161,39 +1404,62 @@ static int select_convert_func(cups_raster_t *raster,
       case CUPS_CSPACE_ICCE:
       case CUPS_CSPACE_ICCF:
 	  if (doc->outheader.cupsBitsPerColor == 8)
+	  {
 	    convert->convertCSpace = convert_cspace_lab_8;
+	    doc->convertCSpaceLine = convert_cspace_line_lab_8;
+	  }
 	  else
+	  {
 	    // 16 bits
 	    convert->convertCSpace = convert_cspace_lab_16;
+	    doc->convertCSpaceLine = convert_cspace_line_lab_16;
+	  }
 	  bytes = 0; // double
+	  doc->cspaceBytes = 3 * (doc->outheader.cupsBitsPerColor / 8);
+	  doc->cspaceUseLab = true;
 	  break;
       case CUPS_CSPACE_CIEXYZ:
           if (doc->outheader.cupsBitsPerColor == 8)
+	  {
 	    convert->convertCSpace = convert_cspace_xyz_8;
+	    doc->convertCSpaceLine = convert_cspace_line_xyz_8;
+	  }
 	  else
+	  {
 	    // 16 bits
 	    convert->convertCSpace = convert_cspace_xyz_16;
+	    doc->convertCSpaceLine = convert_cspace_line_xyz_16;
+	  }
 	  bytes = 0; // double
+	  doc->cspaceBytes = 3 * (doc->outheader.cupsBitsPerColor / 8);
+	  doc->cspaceUseLab = true;
 	  break;
       default:
 	  convert->convertCSpace = convert_cspace_with_profiles;
+	  doc->convertCSpaceLine = convert_cspace_line_with_profiles;
 	  bytes = doc->outheader.cupsBitsPerColor / 8;
+	  doc->cspaceBytes = doc->outheader.cupsNumColors * bytes;
 	  break;
     }
+    // The transform reads 3-channel pixels, so the line can only be
+    // converted in one go if the input is RGB
+    if (doc->outputNumColors != 3 || doc->cspaceBytes == 0 ||
+	doc->cspaceBytes > MAX_BYTES_PER_PIXEL)
+      doc->convertCSpaceLine = NULL;
     doc->bitspercolor = 0; // convert bits in convertCSpace
     if (doc->color_profile.outputColorProfile == NULL)
       doc->color_profile.outputColorProfile = cmsCreate_sRGBProfile();
     unsigned int dcst =
       get_cms_color_space_type(cmsGetColorSpace(doc->color_profile.colorProfile));
     if ((doc->color_profile.colorTransform =
-	 cmsCreateTransform(doc->color_profile.outputColorProfile,
-			    COLORSPACE_SH(PT_RGB) | CHANNELS_SH(3) |
-			    BYTES_SH(1),
-			    doc->color_profile.colorProfile,
-			    COLORSPACE_SH(dcst) |
-			    CHANNELS_SH(doc->outheader.cupsNumColors) |
-			    BYTES_SH(bytes),
-			    doc->color_profile.renderingIntent,0)) == 0)
+	 _cfCmTransformGet(doc->color_profile.outputColorProfile,
+			   COLORSPACE_SH(PT_RGB) | CHANNELS_SH(3) |
+			   BYTES_SH(1),
+			   doc->color_profile.colorProfile,
+			   COLORSPACE_SH(dcst) |
+			   CHANNELS_SH(doc->outheader.cupsNumColors) |
+			   BYTES_SH(bytes),
+			   doc->color_profile.renderingIntent,0)) == 0)
     {
       if (log) log(ld, CF_LOGLEVEL_ERROR,
 		   "cfFilterPWGToRaster: Can't create color transform.");
@@ -1223,15 +1489,21 @@ static int select_convert_func(cups_raster_t *raster,
       case CUPS_CSPACE_ICCF:
       case CUPS_CSPACE_CIEXYZ:
 	  convert->convertCSpace = convert_cspace_none;
+	  doc->convertCSpaceLine = convert_cspace_line_none;
+	  doc->cspaceBytes = doc->outputNumColors;
 	  break;
       case CUPS_CSPACE_CMY:
 	  convert->convertCSpace = rgb_8_to_cmy;
+	  doc->convertCSpaceLine = convert_cspace_line_cmy;
+	  doc->cspaceBytes = 3;
 	  break;
       case CUPS_CSPACE_YMC:
 	  convert->convertCSpace = rgb_8_to_ymc;
 	  break;
       case CUPS_CSPACE_CMYK:
 	  convert->convertCSpace = rgb_8_to_cmyk;
+	  doc->convertCSpaceLine = convert_cspace_line_cmyk;
+	  doc->cspaceBytes = 4;
 	  break;
       case CUPS_CSPACE_KCMY:
 	  convert->convertCSpace = rgb_8_to_kcmy;
@@ -1257,11 +1529,15 @@ static int select_convert_func(cups_raster_t *raster,
       case CUPS_CSPACE_SRGB:
       case CUPS_CSPACE_ADOBERGB:
 	  convert->convertCSpace = convert_cspace_none;
+	  doc->convertCSpaceLine = convert_cspace_line_none;
+	  doc->cspaceBytes = doc->outputNumColors;
 	  break;
       case CUPS_CSPACE_W:
       case CUPS_CSPACE_SW:
       case CUPS_CSPACE_WHITE:
 	  convert->convertCSpace = convert_cspace_none;
+	  doc->convertCSpaceLine = convert_cspace_line_none;
+	  doc->cspaceBytes = doc->outputNumColors;
 	  break;
       case CUPS_CSPACE_K:
       case CUPS_CSPACE_GOLD:
@@ -1737,6 +2013,30 @@ out_page(pwgtoraster_doc_t *doc,
   if (doc->allocLineBuf)
     lineBuf = (unsigned char *)calloc(doc->bytesPerLine, sizeof(unsigned char));
 
+  // Buffers for converting the color space of a whole line at once
+  if (doc->convertCSpaceLine)
+  {
+    doc->cspaceBuf = (unsigned char *)calloc(doc->outheader.cupsWidth,
+					     doc->cspaceBytes);
+    if (doc->cspaceUseLab)
+      doc->cspaceLab = (double *)calloc(doc->outheader.cupsWidth * 3,
+					sizeof(double));
+    doc->cspaceLine = NULL;
+
+    if (!doc->cspaceBuf || (doc->cspaceUseLab && !doc->cspaceLab))
+    {
+      // Fall back to converting pixel by pixel
+      free(doc->cspaceBuf);
+      doc->cspaceBuf = NULL;
+      if (doc->cspaceUseLab)
+      {
+        free(doc->cspaceLab);
+        doc->cspaceLab = NULL;
+      }
+      doc->convertCSpaceLine = NULL;
+    }
+  }
+
   // Switch conversion functions for even and odd pages
   if ((pageNo & 1) == 0)
     convertLine = convert->convertLineEven;
@@ -2303,6 +2603,16 @@ out_page(pwgtoraster_doc_t *doc,
     free(pagebuf);
   if (doc->allocLineBuf)
     free(lineBuf);
+  if (doc->convertCSpaceLine)
+  {
+    free(doc->cspaceBuf);
+    doc->cspaceBuf = NULL;
+    if (doc->cspaceUseLab)
+    {
+      free(doc->cspaceLab);
+      doc->cspaceLab = NULL;
+    }
+  }
 
   return (ret);
 }
@@ -2711,7 +3021,7 @@ cfFilterPWGToRaster(int inputfd,        // I - File descriptor input stream
       doc.color_profile.outputColorProfile != doc.color_profile.colorProfile)
     cmsCloseProfile(doc.color_profile.outputColorProfile);
   if (doc.color_profile.colorTransform != NULL)
-    cmsDeleteTransform(doc.color_profile.colorTransform);
+    _cfCmTransformRelease(doc.color_profile.colorTransform);
 
   return (ret);
 }
@@ -846,8 +846,7 @@ raster_base_header(cups_page_header_t *h,  // O - Raster header
   char		*media_source,          // Media source
                 *media_type;		// Media type
   pwg_media_t   *size_found;            // page size found for given name
-  int           num_options = 0;        // Number of options
-  cups_option_t *options = NULL;        // Options
+  int           indexed;                // Did we index the options?
   ipp_attribute_t *attr;
 
 
@@ -859,10 +858,13 @@ raster_base_header(cups_page_header_t *h,  // O - Raster header
     return (-1);
 
   //
-  // Join the IPP attributes and the CUPS options in a single list
+  // Look up the IPP attributes and the CUPS options by name in the
+  // option index, a filter chain shares the index of its filter data,
+  // otherwise we index the options only for this header...
   //
 
-  num_options = cfJoinJobOptionsAndAttrs(data, num_options, &options);
+  if ((indexed = cfFilterDataIndexOptions(data)) < 0)
+    return (-1);
 
   //
   // Check if the supplied "media" option is a comma-separated list of any
@@ -873,7 +875,7 @@ raster_base_header(cups_page_header_t *h,  // O - Raster header
 
   media_source = NULL;
   media_type = NULL;
-  if ((media = cupsGetOption("media", num_options, options)) != NULL)
+  if ((media = cfFilterDataGetOption(data, "media")) != NULL)
   {
     //
     // Loop through the option string, separating it at commas and setting each
@@ -941,22 +943,22 @@ raster_base_header(cups_page_header_t *h,  // O - Raster header
 
   if (pwg_raster)
     strcpy(h->MediaClass, "PwgRaster");
-  else if ((val = cupsGetOption("media-class", num_options, options)) != NULL ||
-	   (val = cupsGetOption("MediaClass", num_options, options)) != NULL)
+  else if ((val = cfFilterDataGetOption(data, "media-class")) != NULL ||
+	   (val = cfFilterDataGetOption(data, "MediaClass")) != NULL)
     _strlcpy(h->MediaClass, val, sizeof(h->MediaClass));
   else
     strcpy(h->MediaClass, "");
   if (strcasecmp(h->MediaClass, "PwgRaster") == 0)
     pwg_raster = 1;
 
-  if ((val = cupsGetOption("media-color", num_options, options)) != NULL ||
-      (val = cupsGetOption("MediaColor", num_options, options)) != NULL)
+  if ((val = cfFilterDataGetOption(data, "media-color")) != NULL ||
+      (val = cfFilterDataGetOption(data, "MediaColor")) != NULL)
     _strlcpy(h->MediaColor, val, sizeof(h->MediaColor));
   else
     h->MediaColor[0] = '\0';
 
-  if ((val = cupsGetOption("media-type", num_options, options)) != NULL ||
-      (val = cupsGetOption("MediaType", num_options, options)) != NULL ||
+  if ((val = cfFilterDataGetOption(data, "media-type")) != NULL ||
+      (val = cfFilterDataGetOption(data, "MediaType")) != NULL ||
       (val = media_type) != NULL ||
       (val = cfIPPAttrEnumValForPrinter(data->printer_attrs,
 					data->job_attrs,
@@ -965,10 +967,9 @@ raster_base_header(cups_page_header_t *h,  // O - Raster header
   else
     h->MediaType[0] = '\0';
 
-  if ((val = cupsGetOption("print-content-optimize", num_options,
-			   options)) != NULL ||
-      (val = cupsGetOption("output-type", num_options, options)) != NULL ||
-      (val = cupsGetOption("OutputType", num_options, options)) != NULL ||
+  if ((val = cfFilterDataGetOption(data, "print-content-optimize")) != NULL ||
+      (val = cfFilterDataGetOption(data, "output-type")) != NULL ||
+      (val = cfFilterDataGetOption(data, "OutputType")) != NULL ||
       (val = cfIPPAttrEnumValForPrinter(data->printer_attrs,
 					 data->job_attrs,
 					"print-content-optimize")) != NULL)
@@ -1007,9 +1008,9 @@ raster_base_header(cups_page_header_t *h,  // O - Raster header
     // TODO - Support for advance distance and advance media
     h->AdvanceDistance = 0;
     h->AdvanceMedia = CUPS_ADVANCE_NONE;
-    if ((val = cupsGetOption("Collate", num_options, options)) != NULL ||
-	(val = cupsGetOption("multiple-document-handling",
-			     num_options, options)) != NULL ||
+    if ((val = cfFilterDataGetOption(data, "Collate")) != NULL ||
+	(val = cfFilterDataGetOption(data,
+				     "multiple-document-handling")) != NULL ||
 	(val = cfIPPAttrEnumValForPrinter(data->printer_attrs,
 					  data->job_attrs,
 					  "multiple-document-handling")) !=
@@ -1029,8 +1030,8 @@ raster_base_header(cups_page_header_t *h,  // O - Raster header
   h->CutMedia = CUPS_CUT_NONE;
 
   h->Tumble = CUPS_FALSE;
-  if ((val = cupsGetOption("sides", num_options, options)) != NULL ||
-      (val = cupsGetOption("Duplex", num_options, options)) != NULL ||
+  if ((val = cfFilterDataGetOption(data, "sides")) != NULL ||
+      (val = cfFilterDataGetOption(data, "Duplex")) != NULL ||
       (val = cfIPPAttrEnumValForPrinter(data->printer_attrs,
 					data->job_attrs,
 					"sides")) != NULL)
@@ -1075,9 +1076,8 @@ raster_base_header(cups_page_header_t *h,  // O - Raster header
 			       IPP_TAG_ZERO)) != NULL)
     cfIPPAttrResolutionForPrinter(data->printer_attrs, data->job_attrs, NULL,
 				  &x, &y);
-  else if ((val = cupsGetOption("printer-resolution", num_options,
-				options)) != NULL ||
-	   (val = cupsGetOption("Resolution", num_options, options)) != NULL)
+  else if ((val = cfFilterDataGetOption(data, "printer-resolution")) != NULL ||
+	   (val = cfFilterDataGetOption(data, "Resolution")) != NULL)
   {
     int	        xres,		// X resolution
                 yres;		// Y resolution
@@ -1129,10 +1129,9 @@ raster_base_header(cups_page_header_t *h,  // O - Raster header
   // TODO - Support for jog
   h->Jog = CUPS_JOG_NONE;
 
-  if ((val = cupsGetOption("feed-orientation", num_options,
-			   options)) != NULL ||
-      (val = cupsGetOption("feed-direction", num_options, options)) != NULL ||
-      (val = cupsGetOption("LeadingEdge", num_options, options)) != NULL)
+  if ((val = cfFilterDataGetOption(data, "feed-orientation")) != NULL ||
+      (val = cfFilterDataGetOption(data, "feed-direction")) != NULL ||
+      (val = cfFilterDataGetOption(data, "LeadingEdge")) != NULL)
   {
     if (!strcasecmp(val, "ShortEdgeFirst"))
       h->LeadingEdge = CUPS_EDGE_TOP;
@@ -1145,11 +1144,11 @@ raster_base_header(cups_page_header_t *h,  // O - Raster header
   // TODO - Support for manual feed
   h->ManualFeed = CUPS_FALSE;
 
-  if ((val = cupsGetOption("media-position", num_options, options)) != NULL ||
-      (val = cupsGetOption("MediaPosition", num_options, options)) != NULL ||
-      (val = cupsGetOption("media-source", num_options, options)) != NULL ||
-      (val = cupsGetOption("MediaSource", num_options, options)) != NULL ||
-      (val = cupsGetOption("InputSlot", num_options, options)) != NULL ||
+  if ((val = cfFilterDataGetOption(data, "media-position")) != NULL ||
+      (val = cfFilterDataGetOption(data, "MediaPosition")) != NULL ||
+      (val = cfFilterDataGetOption(data, "media-source")) != NULL ||
+      (val = cfFilterDataGetOption(data, "MediaSource")) != NULL ||
+      (val = cfFilterDataGetOption(data, "InputSlot")) != NULL ||
       (val = media_source) != NULL ||
       (val = cfIPPAttrEnumValForPrinter(data->printer_attrs,
 					data->job_attrs,
@@ -1294,11 +1293,10 @@ raster_base_header(cups_page_header_t *h,  // O - Raster header
   else
     h->MediaPosition = 0; // Auto
 
-  if ((val = cupsGetOption("media-weight", num_options, options)) != NULL ||
-      (val = cupsGetOption("MediaWeight", num_options, options)) != NULL ||
-      (val = cupsGetOption("media-weight-metric", num_options,
-			   options)) != NULL ||
-      (val = cupsGetOption("MediaWeightMetric", num_options, options)) != NULL)
+  if ((val = cfFilterDataGetOption(data, "media-weight")) != NULL ||
+      (val = cfFilterDataGetOption(data, "MediaWeight")) != NULL ||
+      (val = cfFilterDataGetOption(data, "media-weight-metric")) != NULL ||
+      (val = cfFilterDataGetOption(data, "MediaWeightMetric")) != NULL)
     h->MediaWeight = atol(val);
   else
     h->MediaWeight = 0;
@@ -1311,8 +1309,8 @@ raster_base_header(cups_page_header_t *h,  // O - Raster header
   }
   else
   {
-    if ((val = cupsGetOption("mirror-print", num_options, options)) != NULL ||
-	(val = cupsGetOption("MirrorPrint", num_options, options)) != NULL)
+    if ((val = cfFilterDataGetOption(data, "mirror-print")) != NULL ||
+	(val = cfFilterDataGetOption(data, "MirrorPrint")) != NULL)
     {
       if (!strcasecmp(val, "true") || !strcasecmp(val, "on") ||
 	  !strcasecmp(val, "yes"))
@@ -1324,8 +1322,8 @@ raster_base_header(cups_page_header_t *h,  // O - Raster header
       else
 	h->MirrorPrint = CUPS_FALSE;
     }
-    if ((val = cupsGetOption("negative-print", num_options, options)) != NULL ||
-	(val = cupsGetOption("NegativePrint", num_options, options)) != NULL)
+    if ((val = cfFilterDataGetOption(data, "negative-print")) != NULL ||
+	(val = cfFilterDataGetOption(data, "NegativePrint")) != NULL)
     {
       if (!strcasecmp(val, "true") || !strcasecmp(val, "on") ||
 	  !strcasecmp(val, "yes"))
@@ -1340,10 +1338,10 @@ raster_base_header(cups_page_header_t *h,  // O - Raster header
   }
 
   i = 0;
-  if ((val = cupsGetOption("copies", num_options, options)) != NULL ||
-      (val = cupsGetOption("Copies", num_options, options)) != NULL ||
-      (val = cupsGetOption("num-copies", num_options, options)) != NULL ||
-      (val = cupsGetOption("NumCopies", num_options, options)) != NULL ||
+  if ((val = cfFilterDataGetOption(data, "copies")) != NULL ||
+      (val = cfFilterDataGetOption(data, "Copies")) != NULL ||
+      (val = cfFilterDataGetOption(data, "num-copies")) != NULL ||
+      (val = cfFilterDataGetOption(data, "NumCopies")) != NULL ||
       cfIPPAttrIntValForPrinter(data->printer_attrs, data->job_attrs,
 				"copies", &i) == 1)
   {
@@ -1355,11 +1353,9 @@ raster_base_header(cups_page_header_t *h,  // O - Raster header
   else
     h->NumCopies = 1; // 0 = Printer default
 
-  if ((val = cupsGetOption("orientation-requested", num_options,
-			   options)) != NULL ||
-      (val = cupsGetOption("OrientationRequested", num_options,
-			   options)) != NULL ||
-      (val = cupsGetOption("Orientation", num_options, options)) != NULL ||
+  if ((val = cfFilterDataGetOption(data, "orientation-requested")) != NULL ||
+      (val = cfFilterDataGetOption(data, "OrientationRequested")) != NULL ||
+      (val = cfFilterDataGetOption(data, "Orientation")) != NULL ||
       (val = cfIPPAttrEnumValForPrinter(data->printer_attrs,
 					data->job_attrs,
 					"orientation-requested")) != NULL)
@@ -1392,10 +1388,10 @@ raster_base_header(cups_page_header_t *h,  // O - Raster header
   }
   else
   {
-    if ((val = cupsGetOption("OutputFaceUp", num_options, options)) != NULL ||
-	(val = cupsGetOption("output-face-up", num_options, options)) != NULL ||
-	(val = cupsGetOption("OutputBin", num_options, options)) != NULL ||
-	(val = cupsGetOption("output-bin", num_options, options)) != NULL ||
+    if ((val = cfFilterDataGetOption(data, "OutputFaceUp")) != NULL ||
+	(val = cfFilterDataGetOption(data, "output-face-up")) != NULL ||
+	(val = cfFilterDataGetOption(data, "OutputBin")) != NULL ||
+	(val = cfFilterDataGetOption(data, "output-bin")) != NULL ||
 	(val = cfIPPAttrEnumValForPrinter(data->printer_attrs,
 					  data->job_attrs,
 					  "output-bin")) != NULL)
@@ -1421,8 +1417,8 @@ raster_base_header(cups_page_header_t *h,  // O - Raster header
   }
   else
   {
-    if ((val = cupsGetOption("separations", num_options, options)) != NULL ||
-	(val = cupsGetOption("Separations", num_options, options)) != NULL)
+    if ((val = cfFilterDataGetOption(data, "separations")) != NULL ||
+	(val = cfFilterDataGetOption(data, "Separations")) != NULL)
     {
       if (!strcasecmp(val, "true") || !strcasecmp(val, "on") ||
 	  !strcasecmp(val, "yes"))
@@ -1434,8 +1430,8 @@ raster_base_header(cups_page_header_t *h,  // O - Raster header
       else
 	h->Separations = CUPS_FALSE;
     }
-    if ((val = cupsGetOption("tray-switch", num_options, options)) != NULL ||
-	(val = cupsGetOption("TraySwitch", num_options, options)) != NULL)
+    if ((val = cfFilterDataGetOption(data, "tray-switch")) != NULL ||
+	(val = cfFilterDataGetOption(data, "TraySwitch")) != NULL)
     {
       if (!strcasecmp(val, "true") || !strcasecmp(val, "on") ||
 	  !strcasecmp(val, "yes"))
@@ -1449,7 +1445,7 @@ raster_base_header(cups_page_header_t *h,  // O - Raster header
     }
   }
 
-  if ((val = cupsGetOption("Tumble", num_options, options)) != NULL)
+  if ((val = cfFilterDataGetOption(data, "Tumble")) != NULL)
   {
     if (!strcasecmp(val, "Off") || !strcasecmp(val, "False") ||
 	!strcasecmp(val, "No"))
@@ -1471,18 +1467,17 @@ raster_base_header(cups_page_header_t *h,  // O - Raster header
 
   // Color modes
   int numcolors = 0;		// Number of colorants
-  if ((val = cupsGetOption("pwg-raster-document-type", num_options,
-			   options)) != NULL ||
-      (val = cupsGetOption("PwgRasterDocumentType", num_options,
-			   options)) != NULL ||
-      (val = cupsGetOption("color-space", num_options, options)) != NULL ||
-      (val = cupsGetOption("ColorSpace", num_options, options)) != NULL ||
-      (val = cupsGetOption("color-model", num_options, options)) != NULL ||
-      (val = cupsGetOption("ColorModel", num_options, options)) != NULL ||
-      (val = cupsGetOption("print-color-mode", num_options, options)) !=
+  if ((val = cfFilterDataGetOption(data,
+				   "pwg-raster-document-type")) != NULL ||
+      (val = cfFilterDataGetOption(data, "PwgRasterDocumentType")) != NULL ||
+      (val = cfFilterDataGetOption(data, "color-space")) != NULL ||
+      (val = cfFilterDataGetOption(data, "ColorSpace")) != NULL ||
+      (val = cfFilterDataGetOption(data, "color-model")) != NULL ||
+      (val = cfFilterDataGetOption(data, "ColorModel")) != NULL ||
+      (val = cfFilterDataGetOption(data, "print-color-mode")) !=
       NULL ||
-      (val = cupsGetOption("output-mode", num_options, options)) != NULL ||
-      (val = cupsGetOption("OutputMode", num_options, options)) != NULL ||
+      (val = cfFilterDataGetOption(data, "output-mode")) != NULL ||
+      (val = cfFilterDataGetOption(data, "OutputMode")) != NULL ||
       (val = cfIPPAttrEnumValForPrinter(data->printer_attrs,
 					data->job_attrs,
 					"print-color-mode")) != NULL)
@@ -1690,10 +1685,9 @@ raster_base_header(cups_page_header_t *h,  // O - Raster header
   if (pwg_raster)
   {
     
-    if ((val = cupsGetOption("job-impressions", num_options,
-			     options)) != NULL ||
-	(val = cupsGetOption("JobImpressions", num_options, options)) != NULL ||
-	(val = cupsGetOption("Impressions", num_options, options)) != NULL)
+    if ((val = cfFilterDataGetOption(data, "job-impressions")) != NULL ||
+	(val = cfFilterDataGetOption(data, "JobImpressions")) != NULL ||
+	(val = cfFilterDataGetOption(data, "Impressions")) != NULL)
     {
       int impressions = atoi(val);
       if (impressions >= 0)
@@ -1702,10 +1696,9 @@ raster_base_header(cups_page_header_t *h,  // O - Raster header
 
     // Printer property, command line options only for development and
     // debugging
-    if ((val = cupsGetOption("pwg-raster-document-sheet-back", num_options,
-			     options)) != NULL ||
-	(val = cupsGetOption("back-side-orientation", num_options,
-			     options)) != NULL ||
+    if ((val = cfFilterDataGetOption(data,
+				     "pwg-raster-document-sheet-back")) != NULL ||
+	(val = cfFilterDataGetOption(data, "back-side-orientation")) != NULL ||
 	(data->printer_attrs &&
 	 ((attr = ippFindAttribute(data->printer_attrs, "urf-supported",
 				   IPP_TAG_ZERO)) != NULL ||
@@ -1820,19 +1813,17 @@ raster_base_header(cups_page_header_t *h,  // O - Raster header
     // TODO - Support for ImageBoxLeft, ImageBoxTop, ImageBoxRight, and
     // ImageBoxBottom (h->cupsInteger[3..6]), leave on 0 for now
 
-    if ((val = cupsGetOption("alternate-primary", num_options,
-			     options)) != NULL ||
-	(val = cupsGetOption("AlternatePrimary", num_options,
-			     options)) != NULL)
+    if ((val = cfFilterDataGetOption(data, "alternate-primary")) != NULL ||
+	(val = cfFilterDataGetOption(data, "AlternatePrimary")) != NULL)
     {
       int alternateprimary = atoi(val);		// SRGB value for black
 						// pixels
       h->cupsInteger[7] = alternateprimary;
     }
 
-    if ((val = cupsGetOption("print-quality", num_options, options)) != NULL ||
-	(val = cupsGetOption("PrintQuality", num_options, options)) != NULL ||
-	(val = cupsGetOption("Quality", num_options, options)) != NULL)
+    if ((val = cfFilterDataGetOption(data, "print-quality")) != NULL ||
+	(val = cfFilterDataGetOption(data, "PrintQuality")) != NULL ||
+	(val = cfFilterDataGetOption(data, "Quality")) != NULL)
     {
       int quality = atoi(val);		// print-quality value
 
@@ -1843,29 +1834,23 @@ raster_base_header(cups_page_header_t *h,  // O - Raster header
 
     // Leave "reserved" fields (h->cupsInteger[9..13]) on 0
 
-    if ((val = cupsGetOption("vendor-identifier", num_options,
-			     options)) != NULL ||
-	(val = cupsGetOption("VendorIdentifier", num_options,
-			     options)) != NULL)
+    if ((val = cfFilterDataGetOption(data, "vendor-identifier")) != NULL ||
+	(val = cfFilterDataGetOption(data, "VendorIdentifier")) != NULL)
     {
       int vendorid = atoi(val);		// USB ID of manufacturer
       h->cupsInteger[14] = vendorid;
     }
 
-    if ((val = cupsGetOption("vendor-length", num_options,
-			     options)) != NULL ||
-	(val = cupsGetOption("VendorLength", num_options,
-			     options)) != NULL)
+    if ((val = cfFilterDataGetOption(data, "vendor-length")) != NULL ||
+	(val = cfFilterDataGetOption(data, "VendorLength")) != NULL)
     {
       int vendorlength = atoi(val);		// How many bytes of vendor
 						// data?
       if (vendorlength > 0 && vendorlength <= 1088)
       {
 	h->cupsInteger[15] = vendorlength;
-	if ((val = cupsGetOption("vendor-data", num_options,
-				 options)) != NULL ||
-	    (val = cupsGetOption("VendorData", num_options,
-				 options)) != NULL)
+	if ((val = cfFilterDataGetOption(data, "vendor-data")) != NULL ||
+	    (val = cfFilterDataGetOption(data, "VendorData")) != NULL)
 	  // TODO - How to enter binary data here?
 	  _strlcpy((char *)&(h->cupsReal[0]), val, 1088);
       }
@@ -1875,12 +1860,9 @@ raster_base_header(cups_page_header_t *h,  // O - Raster header
   // Set "reserved" fields to 0
   memset(h->cupsMarkerType, 0, 64);
 
-  if ((val = cupsGetOption("print-rendering-intent", num_options,
-			   options)) != NULL ||
-      (val = cupsGetOption("PrintRenderingIntent", num_options,
-			   options)) != NULL ||
-      (val = cupsGetOption("RenderingIntent", num_options,
-			   options)) != NULL ||
+  if ((val = cfFilterDataGetOption(data, "print-rendering-intent")) != NULL ||
+      (val = cfFilterDataGetOption(data, "PrintRenderingIntent")) != NULL ||
+      (val = cfFilterDataGetOption(data, "RenderingIntent")) != NULL ||
       (val = cfIPPAttrEnumValForPrinter(data->printer_attrs,
 					data->job_attrs,
 					"print-rendering-intent")) != NULL)
@@ -1912,7 +1894,8 @@ raster_base_header(cups_page_header_t *h,  // O - Raster header
     free(media_source);
   if (media_type != NULL)
     free(media_type);
-  cupsFreeOptions(num_options, options);
+  if (indexed)
+    cfFilterDataFreeOptionIndex(data);
 
   return (0);
 }
@@ -0,0 +1,333 @@
+//
+// Template cache test program for the bannertopdf filter of libcupsfilters.
+//
+// Pulls in cupsfilters/bannertopdf.c so that the static template cache
+// template_load() and template_release() can be driven directly.  A
+// template must be loaded only once while it is unchanged, a job finding
+// it busy must get its own copy, and a template with a new modification
+// time must be loaded again.  Banner pages made from a cached template
+// must not change the cached template.
+//
+// Licensed under Apache License v2.0.  See the file "LICENSE" for more
+// information.
+//
+// Contents:
+//
+//   main()            - Run the template cache tests.
+//   cache_entry()     - Find the cache entry of a template.
+//   page_width()      - Get the width of the page of a template.
+//   run_filter()      - Make a banner page with cfFilterBannerToPDF().
+//   write_template()  - Write a one page template.
+//
+
+//
+// Include the filter, for the static template cache...
+//
+
+#include "bannertopdf.c"
+#include <pdfio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <utime.h>
+
+
+//
+// Local functions...
+//
+
+static template_cache_t	*cache_entry(const char *filename);
+static double		page_width(cf_pdf_t *pdf);
+static int		run_filter(const char *filename);
+static int		write_template(const char *filename, double width,
+				       double height);
+
+
+//
+// 'main()' - Run the template cache tests.
+//
+
+int					// O - Exit status
+main(void)
+{
+  const char		*tmpdir;	// Temporary directory
+  char			filename[1024];	// Template file
+  cf_pdf_t		*pdf,		// Template of first job
+			*pdf2,		// Template of second job
+			*pdf3;		// Template of third job
+  template_cache_t	*entry;		// Cache entry of template
+  struct stat		st;		// Template file information
+  struct utimbuf	times;		// New template file times
+  int			status = 1;	// Exit status
+
+
+  if ((tmpdir = getenv("TMPDIR")) == NULL)
+    tmpdir = "/tmp";
+
+  snprintf(filename, sizeof(filename), "%s/test-bannertopdf-cache-%d.pdf",
+	   tmpdir, (int)getpid());
+
+  if (!write_template(filename, 200.0, 300.0))
+  {
+    printf("FAIL (unable to write template \"%s\")\n", filename);
+    return (1);
+  }
+
+  //
+  // Load the template twice in a row...
+  //
+
+  fputs("template_load(unchanged): ", stdout);
+
+  if ((pdf = template_load(filename, 1)) == NULL ||
+      page_width(pdf) != 200.0)
+  {
+    puts("FAIL (unable to load template)");
+    goto done;
+  }
+
+  template_release(pdf);
+
+  if ((pdf2 = template_load(filename, 1)) != pdf)
+  {
+    puts("FAIL (template loaded again)");
+    goto done;
+  }
+
+  puts("PASS");
+
+  //
+  // Load it while it is in use, and without the cache...
+  //
+
+  fputs("template_load(busy): ", stdout);
+
+  if ((pdf3 = template_load(filename, 1)) == NULL || pdf3 == pdf2 ||
+      page_width(pdf3) != 200.0)
+  {
+    puts("FAIL (busy template shared)");
+    goto done;
+  }
+
+  template_release(pdf3);
+
+  if ((pdf3 = template_load(filename, 0)) == NULL || pdf3 == pdf2)
+  {
+    puts("FAIL (template loaded from the cache with cache=0)");
+    goto done;
+  }
+
+  template_release(pdf3);
+
+  if ((entry = cache_entry(filename)) == NULL || entry->pdf != pdf2 ||
+      !entry->in_use)
+  {
+    puts("FAIL (cached template released by another job)");
+    goto done;
+  }
+
+  puts("PASS");
+
+  //
+  // Replace the template while the first job still uses it, with a new
+  // modification time...
+  //
+
+  fputs("template_load(changed): ", stdout);
+
+  if (stat(filename, &st) || !write_template(filename, 400.0, 300.0))
+  {
+    printf("FAIL (unable to write template \"%s\")\n", filename);
+    goto done;
+  }
+
+  times.actime  = st.st_atime;
+  times.modtime = st.st_mtime + 10;
+
+  if (utime(filename, &times))
+  {
+    printf("FAIL (unable to set time of \"%s\": %s)\n", filename,
+	   strerror(errno));
+    goto done;
+  }
+
+  if ((pdf = template_load(filename, 1)) == NULL || page_width(pdf) != 400.0)
+  {
+    puts("FAIL (changed template not loaded again)");
+    goto done;
+  }
+
+  if (page_width(pdf2) != 200.0)
+  {
+    puts("FAIL (template of running job changed)");
+    goto done;
+  }
+
+  template_release(pdf2);
+  template_release(pdf);
+
+  if ((pdf2 = template_load(filename, 1)) != pdf)
+  {
+    puts("FAIL (changed template not cached)");
+    goto done;
+  }
+
+  template_release(pdf2);
+
+  puts("PASS");
+
+  //
+  // Make banner pages from the cached template, its page size differs
+  // from the output page size so the copy gets resized...
+  //
+
+  fputs("cfFilterBannerToPDF: ", stdout);
+
+  if (!run_filter(filename) || !run_filter(filename))
+  {
+    puts("FAIL (filter failed)");
+    goto done;
+  }
+
+  if ((entry = cache_entry(filename)) == NULL || entry->pdf != pdf ||
+      entry->in_use)
+  {
+    puts("FAIL (template not cached or not released)");
+    goto done;
+  }
+
+  if (page_width(pdf) != 400.0)
+  {
+    puts("FAIL (cached template changed)");
+    goto done;
+  }
+
+  puts("PASS");
+
+  status = 0;
+
+  done:
+
+  unlink(filename);
+
+  return (status);
+}
+
+
+//
+// 'cache_entry()' - Find the cache entry of a template.
+//
+
+static template_cache_t *		// O - Cache entry or NULL
+cache_entry(const char *filename)	// I - Template file
+{
+  int	i;				// Looping var
+
+
+  for (i = 0; i < TEMPLATE_CACHE_SIZE; i ++)
+    if (template_cache[i].filename &&
+	!strcmp(template_cache[i].filename, filename))
+      return (template_cache + i);
+
+  return (NULL);
+}
+
+
+//
+// 'page_width()' - Get the width of the page of a template.
+//
+
+static double				// O - Page width or 0.0 on error
+page_width(cf_pdf_t *pdf)		// I - Template
+{
+  pdfio_obj_t	*page;			// Page object
+  pdfio_rect_t	media_box;		// MediaBox of page
+
+
+  if ((page = pdfioFileGetPage((pdfio_file_t *)pdf, 0)) == NULL ||
+      !pdfioDictGetRect(pdfioObjGetDict(page), "MediaBox", &media_box))
+    return (0.0);
+
+  return (media_box.x2 - media_box.x1);
+}
+
+
+//
+// 'run_filter()' - Make a banner page with cfFilterBannerToPDF().
+//
+
+static int				// O - 1 on success, 0 on failure
+run_filter(const char *filename)	// I - Template file
+{
+  cf_filter_data_t	data;		// Filter data
+  FILE			*in,		// Banner instructions
+			*out;		// Banner page
+  char			buffer[5];	// Start of banner page
+  int			ret = 0;	// Return value
+
+
+  memset(&data, 0, sizeof(data));
+  data.job_id    = 1;
+  data.job_user  = "test";
+  data.job_title = "test";
+  data.copies    = 1;
+
+  if ((in = tmpfile()) == NULL || (out = tmpfile()) == NULL)
+  {
+    if (in)
+      fclose(in);
+    return (0);
+  }
+
+  fprintf(in, "#PDF-BANNER\nTemplate %s\nShow job-id job-name\n", filename);
+  fflush(in);
+  rewind(in);
+
+  if (!cfFilterBannerToPDF(dup(fileno(in)), dup(fileno(out)), 0, &data,
+			   NULL) &&
+      fseek(out, 0, SEEK_SET) == 0 &&
+      fread(buffer, 1, sizeof(buffer), out) == sizeof(buffer) &&
+      !memcmp(buffer, "%PDF-", 5))
+    ret = 1;
+
+  fclose(in);
+  fclose(out);
+
+  return (ret);
+}
+
+
+//
+// 'write_template()' - Write a one page template.
+//
+
+static int				// O - 1 on success, 0 on failure
+write_template(const char *filename,	// I - Template file
+	       double     width,	// I - Page width in points
+	       double     height)	// I - Page height in points
+{
+  pdfio_file_t	*pdf;			// Template
+  pdfio_stream_t *st;			// Page contents
+  pdfio_rect_t	media_box;		// MediaBox of page
+
+
+  media_box.x1 = 0.0;
+  media_box.y1 = 0.0;
+  media_box.x2 = width;
+  media_box.y2 = height;
+
+  if ((pdf = pdfioFileCreate(filename, NULL, &media_box, &media_box, NULL,
+			     NULL)) == NULL)
+    return (0);
+
+  if ((st = pdfioFileCreatePage(pdf, pdfioDictCreate(pdf))) == NULL)
+  {
+    pdfioFileClose(pdf);
+    return (0);
+  }
+
+  pdfioStreamPuts(st, "0 0 m 100 100 l S\n");
+  pdfioStreamClose(st);
+
+  return (pdfioFileClose(pdf));
+}
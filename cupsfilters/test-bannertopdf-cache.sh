@@ -0,0 +1,57 @@
+#!/usr/bin/env bash
+#
+# Template cache test for the bannertopdf filter.
+#
+# The C harness (test-bannertopdf-cache.c) #includes the in-tree
+# cupsfilters/bannertopdf.c so it drives the static template_load() and
+# template_release() directly.  It is compiled here and linked through
+# libtool against libcupsfilters.la, like test-pdftoraster-copy-height.sh,
+# instead of being a check_PROGRAM that lists libcupsfilters.la among its
+# objects: the harness already defines everything bannertopdf.c exports, so
+# the library is only used to resolve what is still undefined (the shared
+# library, or only the needed members of the archive with --disable-shared).
+#
+set -euo pipefail
+
+ROOT="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+BUILD_ROOT="$(cd "${ROOT}/.." && pwd)"
+LIBTOOL="${BUILD_ROOT}/libtool"
+CC="${CC:-cc}"
+
+if [[ ! -x "${LIBTOOL}" ]]; then
+  echo "libtool helper not found at ${LIBTOOL}" >&2
+  exit 99
+fi
+
+SRC="${ROOT}/test-bannertopdf-cache.c"
+if [[ ! -f "${SRC}" ]]; then
+  echo "test source not found: ${SRC}" >&2
+  exit 99
+fi
+
+TMP_PARENT="${TMPDIR:-/tmp}"
+WORKDIR="$(mktemp -d "${TMP_PARENT%/}/bannertopdf-cache.XXXXXX")"
+cleanup() { rm -rf "${WORKDIR}"; }
+trap cleanup EXIT
+
+OBJ="${WORKDIR}/test-bannertopdf-cache.o"
+BIN="${WORKDIR}/test-bannertopdf-cache"
+
+# Flags to compile the harness (it pulls in bannertopdf.c -> needs config.h,
+# the internal headers and bannertopdf.c's own dependencies).  Fall back to
+# cups3.
+PKG_CFLAGS="$(pkg-config --cflags pdfio cups 2>/dev/null \
+              || pkg-config --cflags pdfio cups3 2>/dev/null || true)"
+PKG_LIBS="$(pkg-config --libs pdfio cups 2>/dev/null \
+            || pkg-config --libs pdfio cups3 2>/dev/null || true)"
+INCLUDES="-I${BUILD_ROOT} -I${BUILD_ROOT}/cupsfilters"
+
+"${CC}" -std=gnu11 -O0 -D_GNU_SOURCE ${INCLUDES} ${PKG_CFLAGS} \
+  -c "${SRC}" -o "${OBJ}"
+
+# Link against libcupsfilters.la for the symbols bannertopdf.c references.
+"${LIBTOOL}" --mode=link --tag=CC "${CC}" \
+  "${OBJ}" "${BUILD_ROOT}/libcupsfilters.la" ${PKG_LIBS} -lm \
+  -o "${BIN}" >/dev/null
+
+exec "${LIBTOOL}" --mode=execute "${BIN}"
@@ -0,0 +1,260 @@
+//
+// Option index test program for libcupsfilters.
+//
+// Compares cfFilterDataGetOption() with cupsGetOption() on the list of
+// cfJoinJobOptionsAndAttrs() for random job options and attributes with
+// names differing only in case, and checks that the index gets built
+// again after the options or attributes of the filter data change.
+//
+// Licensed under Apache License v2.0.  See the file "LICENSE" for more
+// information.
+//
+// Contents:
+//
+//   main()          - Run the option index tests.
+//   check_options() - Compare the index with the joined options and
+//                     attributes.
+//
+
+//
+// Include necessary headers.
+//
+
+#include <cupsfilters/filter.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+//
+// Constants...
+//
+
+#define ITERATIONS	2000		// Random option sets to test
+
+
+//
+// Local globals...
+//
+
+static const char * const names[] =	// Option and attribute names
+{
+  "media", "Media", "MEDIA", "copies", "Copies", "sides", "page-ranges",
+  "Collate", "collate", "number-up", "x1", "x2", "x3", "x4", "x5", "x6",
+  "x7", "x8", "x9", "y1", "y2", "y3", "y4", "y5", "y6", "y7", "z", "Z"
+};
+#define NUM_NAMES	(int)(sizeof(names) / sizeof(names[0]))
+
+
+//
+// Local functions...
+//
+
+static int	check_options(cf_filter_data_t *data);
+
+
+//
+// 'main()' - Run the option index tests.
+//
+
+int					// O - Exit status
+main(void)
+{
+  int			i, j,		// Looping vars
+			count;		// Number of options or attributes
+  char			value[32];	// Option value
+  cf_filter_data_t	data;		// Filter data
+  int			num_options,	// Number of options
+			num_options2;	// Number of replacing options
+  cups_option_t		*options,	// Options
+			*options2;	// Replacing options
+  ipp_t			*job_attrs;	// Job attributes
+  const char		*step = NULL;	// Failing step
+  int			status = 0;	// Exit status
+
+
+  srand(1);
+
+  fputs("cfFilterDataGetOption: ", stdout);
+
+  for (i = 0; i < ITERATIONS && !step; i ++)
+  {
+    //
+    // Make random options and attributes...
+    //
+
+    memset(&data, 0, sizeof(data));
+
+    num_options = 0;
+    options     = NULL;
+
+    for (j = 0, count = rand() % 25; j < count; j ++)
+    {
+      snprintf(value, sizeof(value), "o%d", rand() % 100);
+      num_options = cupsAddOption(names[rand() % NUM_NAMES], value,
+				  num_options, &options);
+    }
+
+    job_attrs = NULL;
+
+    if (rand() % 3)
+    {
+      job_attrs = ippNew();
+
+      for (j = 0, count = rand() % 20; j < count; j ++)
+      {
+        switch (rand() % 10)
+	{
+	  case 0 :
+	      ippAddSeparator(job_attrs);
+	      break;
+	  case 1 :
+	  case 2 :
+	      ippAddInteger(job_attrs, IPP_TAG_JOB, IPP_TAG_INTEGER,
+			    names[rand() % NUM_NAMES], rand() % 100);
+	      break;
+	  default :
+	      snprintf(value, sizeof(value), "a%d", rand() % 100);
+	      ippAddString(job_attrs, IPP_TAG_JOB, IPP_TAG_KEYWORD,
+			   names[rand() % NUM_NAMES], NULL, value);
+	      break;
+	}
+      }
+    }
+
+    data.num_options = num_options;
+    data.options     = options;
+    data.job_attrs   = job_attrs;
+
+    //
+    // Look up everything, the index must then be kept...
+    //
+
+    if (!check_options(&data))
+      step = "lookup";
+    else if (cfFilterDataIndexOptions(&data) != 0)
+      step = "index not kept";
+
+    //
+    // Replace the options...
+    //
+
+    options2     = NULL;
+    num_options2 = cupsAddOption("media", "new", 0, &options2);
+
+    data.num_options = num_options2;
+    data.options     = options2;
+
+    if (!step && !check_options(&data))
+      step = "options replaced";
+
+    //
+    // Change an option in place and free the index as documented...
+    //
+
+    data.num_options = cupsAddOption("MEDIA", "changed", data.num_options,
+				     &data.options);
+    options2         = data.options;
+
+    cfFilterDataFreeOptionIndex(&data);
+
+    if (!step && !check_options(&data))
+      step = "option changed in place";
+
+    //
+    // Drop the attributes...
+    //
+
+    data.job_attrs = NULL;
+
+    if (!step && !check_options(&data))
+      step = "attributes removed";
+
+    cfFilterDataFreeOptionIndex(&data);
+
+    if (!step && data.extension)
+      step = "index not freed";
+
+    cupsFreeOptions(num_options, options);
+    cupsFreeOptions(data.num_options, options2);
+    ippDelete(job_attrs);
+  }
+
+  if (step)
+  {
+    printf("FAIL (set %d, %s)\n", i - 1, step);
+    status = 1;
+  }
+  else
+    puts("PASS");
+
+  return (status);
+}
+
+
+//
+// 'check_options()' - Compare the index with the joined options and
+//                     attributes.
+//
+
+static int				// O - 1 if equal, 0 otherwise
+check_options(cf_filter_data_t *data)	// I - Filter data
+{
+  int			i,		// Looping var
+			ret = 1;	// Return value
+  cf_filter_data_t	ref;		// Filter data without index
+  int			num_expected,	// Number of joined options
+			num_joined;	// Number of options from index
+  cups_option_t		*expected,	// Joined options
+			*joined;	// Options from index
+  const char		*a, *b;		// Values
+
+
+  //
+  // Join the options and attributes without the index...
+  //
+
+  memset(&ref, 0, sizeof(ref));
+  ref.num_options = data->num_options;
+  ref.options     = data->options;
+  ref.job_attrs   = data->job_attrs;
+
+  expected     = NULL;
+  num_expected = cfJoinJobOptionsAndAttrs(&ref, 0, &expected);
+
+  for (i = 0; i < NUM_NAMES && ret; i ++)
+  {
+    a = cupsGetOption(names[i], num_expected, expected);
+    b = cfFilterDataGetOption(data, names[i]);
+
+    if ((a == NULL) != (b == NULL) || (a && strcmp(a, b)))
+    {
+      printf("%s=\"%s\", expected \"%s\" ", names[i], b ? b : "(null)",
+	     a ? a : "(null)");
+      ret = 0;
+    }
+  }
+
+  if (ret && cfFilterDataGetOption(data, "nonexistent"))
+    ret = 0;
+
+  //
+  // Join them again from the index...
+  //
+
+  joined     = NULL;
+  num_joined = cfJoinJobOptionsAndAttrs(data, 0, &joined);
+
+  if (ret && num_joined != num_expected)
+    ret = 0;
+
+  for (i = 0; i < num_expected && ret; i ++)
+    if ((b = cupsGetOption(expected[i].name, num_joined, joined)) == NULL ||
+	strcmp(b, expected[i].value))
+      ret = 0;
+
+  cupsFreeOptions(num_expected, expected);
+  cupsFreeOptions(num_joined, joined);
+
+  return (ret);
+}
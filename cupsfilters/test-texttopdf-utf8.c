@@ -0,0 +1,395 @@
+//
+// UTF-8 input test program for the texttopdf filter of libcupsfilters.
+//
+// Pulls in cupsfilters/texttopdf.c so that the static block decoder
+// get_utf8_block() and get_utf8() can be driven directly.  Valid and
+// invalid UTF-8 is written into a pipe in chunks of random sizes and
+// the decoded characters are compared with a straightforward one byte
+// at a time decoder.
+//
+// Licensed under Apache License v2.0.  See the file "LICENSE" for more
+// information.
+//
+// Contents:
+//
+//   main()        - Run the UTF-8 decoding tests.
+//   add_random()  - Append random valid and invalid UTF-8 to a buffer.
+//   ref_decode()  - Decode UTF-8 one byte at a time.
+//   test_decode() - Decode a buffer through a pipe and compare.
+//
+
+//
+// Include the filter, for the static decoder and its types...
+//
+
+#include "texttopdf.c"
+#include <signal.h>
+#include <sys/wait.h>
+
+
+//
+// Constants...
+//
+
+#define MAX_LENGTH	(4 * INPUT_BLOCK)
+					// Largest test input
+#define ITERATIONS	200		// Random inputs to test
+
+
+//
+// Local functions...
+//
+
+static size_t	add_random(unsigned char *buf, size_t len, size_t size);
+static size_t	ref_decode(const unsigned char *buf, size_t len, int *chars);
+static int	test_decode(const char *name, const unsigned char *buf,
+			    size_t len, int max_chunk);
+
+
+//
+// 'main()' - Run the UTF-8 decoding tests.
+//
+
+int					// O - Exit status
+main(void)
+{
+  unsigned char	*buf;			// Test input
+  size_t	len;			// Length of test input
+  int		i;			// Looping var
+  int		status = 0;		// Exit status
+  static const unsigned char smiley[] = { 0xf0, 0x9f, 0x98, 0x80 };
+					// U+1F600, 4-byte UTF-8
+
+
+  signal(SIGPIPE, SIG_IGN);
+  srand(1);
+
+  if ((buf = malloc(MAX_LENGTH)) == NULL)
+  {
+    perror("test-texttopdf-utf8");
+    return (1);
+  }
+
+  //
+  // A 4-byte character at every position across the end of the first
+  // input block, read from a file and from a pipe in small chunks...
+  //
+
+  for (i = 3; i >= 0; i --)
+  {
+    len = INPUT_BLOCK - (size_t)i;
+    memset(buf, 'a', len);
+    memcpy(buf + len, smiley, sizeof(smiley));
+    len += sizeof(smiley);
+    memcpy(buf + len, "\fnext page\n", 11);
+    len += 11;
+
+    if (!test_decode("4-byte character at block end", buf, len, 0) ||
+	!test_decode("4-byte character at block end", buf, len, 7))
+      break;
+  }
+
+  if (i < 0)
+    puts("4-byte character at block end: PASS");
+  else
+    status = 1;
+
+  //
+  // Bytes that never start a sequence, and sequences cut off by the end
+  // of the file...
+  //
+
+  len = 0;
+  buf[len ++] = 'x';
+  buf[len ++] = 0xf8;
+  buf[len ++] = 0xff;
+  buf[len ++] = 0xc0;
+  buf[len ++] = 0xaf;
+  buf[len ++] = 'y';
+  buf[len ++] = 0xf0;
+  buf[len ++] = 0x9f;
+  buf[len ++] = 0x98;
+
+  if (test_decode("invalid and truncated bytes", buf, len, 0))
+    puts("invalid and truncated bytes: PASS");
+  else
+    status = 1;
+
+  //
+  // Random mixes of ASCII runs, valid, and invalid sequences...
+  //
+
+  for (i = 0; i < ITERATIONS; i ++)
+  {
+    len = add_random(buf, 0, 1 + (size_t)rand() % MAX_LENGTH);
+
+    if (!test_decode("random input", buf, len, 1 + rand() % 100000))
+    {
+      status = 1;
+      break;
+    }
+  }
+
+  if (i == ITERATIONS)
+    puts("random input: PASS");
+
+  free(buf);
+
+  return (status);
+}
+
+
+//
+// 'add_random()' - Append random valid and invalid UTF-8 to a buffer.
+//
+
+static size_t				// O - New length of buffer
+add_random(unsigned char *buf,		// I - Buffer
+	   size_t        len,		// I - Current length of buffer
+	   size_t        size)		// I - Length to fill
+{
+  int		ch,			// Character to add
+		run;			// Length of ASCII run
+  static const unsigned char invalid[][4] =
+  {					// Invalid sequences
+    { 0xc0, 0x80 },			// Overlong NUL
+    { 0xe0, 0x80, 0xaf },		// Overlong '/'
+    { 0xed, 0xa0, 0x80 },		// Surrogate
+    { 0xf4, 0x90, 0x80, 0x80 },		// Above U+10FFFF
+    { 0xf5, 0x80, 0x80, 0x80 },		// Bad first byte
+    { 0xe2, 0x82, 'a' },		// Missing continuation byte
+    { 0x80 },				// Stray continuation byte
+    { 0xff }				// Bad first byte
+  };
+
+
+  while (len + 4 <= size)
+  {
+    switch (rand() % 6)
+    {
+      case 0 :				// ASCII run
+          for (run = rand() % 40; run > 0 && len < size; run --)
+	    buf[len ++] = 0x20 + rand() % 0x5f;
+	  break;
+
+      case 1 :				// 2-byte character
+          ch         = 0x80 + rand() % 0x780;
+	  buf[len ++] = 0xc0 | (ch >> 6);
+	  buf[len ++] = 0x80 | (ch & 0x3f);
+	  break;
+
+      case 2 :				// 3-byte character
+          do
+	    ch = 0x800 + rand() % 0xf800;
+	  while (ch >= 0xd800 && ch <= 0xdfff);
+
+	  buf[len ++] = 0xe0 | (ch >> 12);
+	  buf[len ++] = 0x80 | ((ch >> 6) & 0x3f);
+	  buf[len ++] = 0x80 | (ch & 0x3f);
+	  break;
+
+      case 3 :				// 4-byte character
+          ch         = 0x10000 + rand() % 0x100000;
+	  buf[len ++] = 0xf0 | (ch >> 18);
+	  buf[len ++] = 0x80 | ((ch >> 12) & 0x3f);
+	  buf[len ++] = 0x80 | ((ch >> 6) & 0x3f);
+	  buf[len ++] = 0x80 | (ch & 0x3f);
+	  break;
+
+      case 4 :				// Invalid sequence
+          ch = rand() % (int)(sizeof(invalid) / sizeof(invalid[0]));
+	  for (run = 0; run < 4 && invalid[ch][run]; run ++)
+	    buf[len ++] = invalid[ch][run];
+	  break;
+
+      default :				// Control character or Latin-1
+          buf[len ++] = (rand() & 1) ? '\n' : 0xa0 + rand() % 0x60;
+	  break;
+    }
+  }
+
+  return (len);
+}
+
+
+//
+// 'ref_decode()' - Decode UTF-8 one byte at a time.
+//
+// A byte that does not start a valid, shortest-form sequence of at most
+// 4 bytes for a character up to U+10FFFF, excluding surrogates, stands
+// for itself.
+//
+
+static size_t				// O - Number of characters
+ref_decode(const unsigned char *buf,	// I - UTF-8 input
+	   size_t              len,	// I - Length of input
+	   int                 *chars)	// O - Characters
+{
+  size_t	pos = 0,		// Position in input
+		count = 0;		// Number of characters
+  int		ch,			// Current character
+		need,			// Continuation bytes needed
+		i;			// Looping var
+
+
+  while (pos < len)
+  {
+    ch = buf[pos];
+
+    if (ch < 0x80)
+      need = 0;
+    else if ((ch & 0xe0) == 0xc0)
+    {
+      need = 1;
+      ch   &= 0x1f;
+    }
+    else if ((ch & 0xf0) == 0xe0)
+    {
+      need = 2;
+      ch   &= 0x0f;
+    }
+    else if ((ch & 0xf8) == 0xf0)
+    {
+      need = 3;
+      ch   &= 0x07;
+    }
+    else
+      need = -1;
+
+    for (i = 1; need > 0 && i <= need; i ++)
+    {
+      if (pos + i >= len || (buf[pos + i] & 0xc0) != 0x80)
+      {
+	need = -1;
+	break;
+      }
+
+      ch = (ch << 6) | (buf[pos + i] & 0x3f);
+    }
+
+    if ((need == 1 && ch < 0x80) || (need == 2 && ch < 0x800) ||
+	(need == 3 && (ch < 0x10000 || ch > 0x10ffff)) ||
+	(ch >= 0xd800 && ch <= 0xdfff))
+      need = -1;
+
+    if (need < 0)
+      chars[count ++] = buf[pos ++];
+    else
+    {
+      chars[count ++] = ch;
+      pos             += need + 1;
+    }
+  }
+
+  return (count);
+}
+
+
+//
+// 'test_decode()' - Decode a buffer through a pipe and compare.
+//
+// With a chunk size of 0 the buffer is read from a file instead, so that
+// every read fills the whole input block.
+//
+
+static int				// O - 1 on success, 0 on failure
+test_decode(const char          *name,	// I - Name of test
+	    const unsigned char *buf,	// I - UTF-8 input
+	    size_t              len,	// I - Length of input
+	    int                 max_chunk)
+					// I - Largest chunk to write at once
+{
+  int			fds[2];		// Pipe
+  FILE			*fp = NULL;	// File with input
+  pid_t			pid = -1;	// Writer process
+  size_t		pos,		// Position in input
+			chunk,		// Bytes to write
+			count,		// Number of expected characters
+			i;		// Looping var
+  int			*expected,	// Expected characters
+			ch,		// Decoded character
+			wstatus,	// Status of writer
+			ret = 1;	// Return value
+  texttopdf_input_t	*in;		// Decoder state
+
+
+  expected = calloc(len + 1, sizeof(int));
+  in       = calloc(1, sizeof(texttopdf_input_t));
+
+  if (!expected || !in ||
+      (max_chunk > 0 ? pipe(fds) :
+		       (fp = tmpfile()) == NULL ||
+		       fwrite(buf, 1, len, fp) != len || fflush(fp)))
+  {
+    printf("%s: FAIL (%s)\n", name, strerror(errno));
+    free(expected);
+    free(in);
+    if (fp)
+      fclose(fp);
+    return (0);
+  }
+
+  count = ref_decode(buf, len, expected);
+
+  if (fp)
+  {
+    fds[0] = fileno(fp);
+    lseek(fds[0], 0, SEEK_SET);
+  }
+  else if ((pid = fork()) == 0)
+  {
+    //
+    // Write the input in random chunks...
+    //
+
+    close(fds[0]);
+
+    for (pos = 0; pos < len; pos += chunk)
+    {
+      chunk = 1 + (size_t)rand() % (size_t)max_chunk;
+      if (chunk > len - pos)
+        chunk = len - pos;
+
+      if (write(fds[1], buf + pos, chunk) < 0)
+	_exit(1);
+    }
+
+    _exit(0);
+  }
+  else
+    close(fds[1]);
+
+  in->fd      = fds[0];
+  in->charptr = in->charend = in->chars;
+
+  for (i = 0; (ch = get_utf8(in)) >= 0; i ++)
+  {
+    if (i >= count || ch != expected[i])
+    {
+      printf("%s: FAIL (character %u is %d, expected %d)\n", name,
+	     (unsigned)i, ch, i < count ? expected[i] : -1);
+      ret = 0;
+      break;
+    }
+  }
+
+  if (ret && i != count)
+  {
+    printf("%s: FAIL (%u characters, expected %u)\n", name, (unsigned)i,
+	   (unsigned)count);
+    ret = 0;
+  }
+
+  if (fp)
+    fclose(fp);
+  else
+    close(fds[0]);
+
+  if (pid > 0)
+    waitpid(pid, &wstatus, 0);
+
+  free(in);
+  free(expected);
+
+  return (ret);
+}
@@ -0,0 +1,65 @@
+#!/usr/bin/env bash
+#
+# UTF-8 input test for the texttopdf filter.
+#
+# The C harness (test-texttopdf-utf8.c) #includes the in-tree
+# cupsfilters/texttopdf.c so it drives the static get_utf8_block() and
+# get_utf8() decoders directly.  It is compiled here and linked through
+# libtool against libcupsfilters.la, like test-pdftoraster-copy-height.sh,
+# instead of being a check_PROGRAM that lists libcupsfilters.la among its
+# objects: the harness already defines everything texttopdf.c exports, so
+# the library is only used to resolve what is still undefined (the shared
+# library, or only the needed members of the archive with --disable-shared).
+#
+# Skips (Automake exit 77) when texttopdf is built without fontconfig.
+#
+set -euo pipefail
+
+ROOT="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+BUILD_ROOT="$(cd "${ROOT}/.." && pwd)"
+LIBTOOL="${BUILD_ROOT}/libtool"
+CC="${CC:-cc}"
+
+if [[ ! -x "${LIBTOOL}" ]]; then
+  echo "libtool helper not found at ${LIBTOOL}" >&2
+  exit 99
+fi
+
+# The decoder only exists when texttopdf is built with fontconfig.
+if ! grep -q "^#define HAVE_FONTCONFIG" "${BUILD_ROOT}/config.h" 2>/dev/null; then
+  echo "texttopdf built without fontconfig; skipping." >&2
+  exit 77
+fi
+
+SRC="${ROOT}/test-texttopdf-utf8.c"
+if [[ ! -f "${SRC}" ]]; then
+  echo "test source not found: ${SRC}" >&2
+  exit 99
+fi
+
+TMP_PARENT="${TMPDIR:-/tmp}"
+WORKDIR="$(mktemp -d "${TMP_PARENT%/}/texttopdf-utf8.XXXXXX")"
+cleanup() { rm -rf "${WORKDIR}"; }
+trap cleanup EXIT
+
+OBJ="${WORKDIR}/test-texttopdf-utf8.o"
+BIN="${WORKDIR}/test-texttopdf-utf8"
+
+# Flags to compile the harness (it pulls in texttopdf.c -> needs config.h, the
+# internal headers and texttopdf.c's own dependencies).  Fall back to cups3.
+PKG_CFLAGS="$(pkg-config --cflags fontconfig cups 2>/dev/null \
+              || pkg-config --cflags fontconfig cups3 2>/dev/null || true)"
+PKG_LIBS="$(pkg-config --libs fontconfig cups 2>/dev/null \
+            || pkg-config --libs fontconfig cups3 2>/dev/null || true)"
+INCLUDES="-I${BUILD_ROOT} -I${BUILD_ROOT}/cupsfilters \
+          -I${BUILD_ROOT}/cupsfilters/fontembed"
+
+"${CC}" -std=gnu11 -O0 -D_GNU_SOURCE ${INCLUDES} ${PKG_CFLAGS} \
+  -c "${SRC}" -o "${OBJ}"
+
+# Link against libcupsfilters.la for the symbols texttopdf.c references.
+"${LIBTOOL}" --mode=link --tag=CC "${CC}" \
+  "${OBJ}" "${BUILD_ROOT}/libcupsfilters.la" ${PKG_LIBS} -lm \
+  -o "${BIN}" >/dev/null
+
+exec "${LIBTOOL}" --mode=execute "${BIN}"
@@ -0,0 +1,389 @@
+//
+// Page selection test program for the texttotext filter of libcupsfilters.
+//
+// Formats random text with cfFilterTextToText() once with all pages and
+// then with several page-ranges and page-set selections.  The output of
+// each selection must be exactly the selected pages of the full output,
+// whatever shortcuts the filter takes on the pages it leaves out.
+//
+// Licensed under Apache License v2.0.  See the file "LICENSE" for more
+// information.
+//
+// Contents:
+//
+//   main()          - Run the page selection tests.
+//   make_text()     - Make random text with long lines, tabs, CR, CRLF,
+//                     and form feeds.
+//   page_selected() - See whether a page is in a selection.
+//   run_filter()    - Run cfFilterTextToText() and return its output.
+//
+
+//
+// Include necessary headers.
+//
+
+#include <cupsfilters/filter.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+//
+// Constants...
+//
+
+#define MAX_LENGTH	40000		// Longest input text
+#define ITERATIONS	40		// Random texts to test
+
+
+//
+// Types...
+//
+
+typedef struct selection_s		// **** Page selection ****
+{
+  const char	*page_ranges,		// page-ranges option or NULL
+		*page_set;		// page-set option or NULL
+} selection_t;
+
+
+//
+// Local globals...
+//
+
+static const char * const wrap_modes[] =// over-long-lines values
+{
+  "truncate",
+  "word-wrap",
+  "wrap-at-width"
+};
+
+static const char * const newlines[] =	// newline-characters values
+{
+  "lf",
+  "crlf"
+};
+
+static const selection_t selections[] =	// Page selections to test
+{
+  { "1", NULL },
+  { "2-3", NULL },
+  { "5-", NULL },
+  { "-2,7,9-10", NULL },
+  { "3,100", NULL },
+  { NULL, "odd" },
+  { NULL, "even" },
+  { "2-8", "even" }
+};
+
+
+//
+// Local functions...
+//
+
+static size_t	make_text(char *text, size_t size);
+static int	page_selected(const selection_t *sel, int page);
+static char	*run_filter(FILE *in, const char *wrap, const char *newline,
+			    const selection_t *sel, size_t *length);
+
+
+//
+// 'main()' - Run the page selection tests.
+//
+
+int					// O - Exit status
+main(void)
+{
+  int		i, j, k, s,		// Looping vars
+		page;			// Current page
+  char		*text,			// Input text
+		*full,			// Output with all pages
+		*fullptr,		// Pointer into full output
+		*fullend,		// End of page in full output
+		*expected,		// Expected output of selection
+		*selected;		// Output of selection
+  size_t	length,			// Length of input text
+		full_length,		// Length of full output
+		expected_length,	// Length of expected output
+		selected_length;	// Length of selected output
+  FILE		*in;			// Input file
+  int		status = 0;		// Exit status
+
+
+  srand(1);
+
+  if ((text = malloc(MAX_LENGTH)) == NULL || (in = tmpfile()) == NULL)
+  {
+    perror("test-texttotext-pages");
+    return (1);
+  }
+
+  fputs("cfFilterTextToText page selection: ", stdout);
+  fflush(stdout);
+
+  for (i = 0; i < ITERATIONS && !status; i ++)
+  {
+    //
+    // Write the next input text...
+    //
+
+    length = make_text(text, MAX_LENGTH);
+
+    if (ftruncate(fileno(in), 0) || lseek(fileno(in), 0, SEEK_SET) ||
+	write(fileno(in), text, length) != (ssize_t)length)
+    {
+      perror("test-texttotext-pages");
+      return (1);
+    }
+
+    for (j = 0; j < (int)(sizeof(wrap_modes) / sizeof(wrap_modes[0])) &&
+		!status; j ++)
+      for (k = 0; k < (int)(sizeof(newlines) / sizeof(newlines[0])) &&
+		  !status; k ++)
+      {
+        if ((full = run_filter(in, wrap_modes[j], newlines[k], NULL,
+			       &full_length)) == NULL)
+	{
+	  printf("FAIL (text %d, %s, %s: filter failed)\n", i, wrap_modes[j],
+		 newlines[k]);
+	  status = 1;
+	  break;
+	}
+
+        if ((expected = malloc(full_length + 1)) == NULL)
+	{
+	  perror("test-texttotext-pages");
+	  return (1);
+	}
+
+	for (s = 0; s < (int)(sizeof(selections) / sizeof(selections[0]));
+	     s ++)
+	{
+	  //
+	  // Copy the selected pages of the full output, every page ends
+	  // with a form feed...
+	  //
+
+	  expected_length = 0;
+
+	  for (fullptr = full, page = 1; fullptr < full + full_length;
+	       fullptr = fullend, page ++)
+	  {
+	    if ((fullend = memchr(fullptr, '\f',
+				  full + full_length - fullptr)) == NULL)
+	      fullend = full + full_length;
+	    else
+	      fullend ++;
+
+	    if (page_selected(selections + s, page))
+	    {
+	      memcpy(expected + expected_length, fullptr, fullend - fullptr);
+	      expected_length += (size_t)(fullend - fullptr);
+	    }
+	  }
+
+	  if ((selected = run_filter(in, wrap_modes[j], newlines[k],
+				     selections + s,
+				     &selected_length)) == NULL ||
+	      selected_length != expected_length ||
+	      memcmp(selected, expected, expected_length))
+	  {
+	    printf("FAIL (text %d, %s, %s, page-ranges=%s, page-set=%s: "
+		   "%d bytes, expected %d)\n", i, wrap_modes[j], newlines[k],
+		   selections[s].page_ranges ? selections[s].page_ranges : "all",
+		   selections[s].page_set ? selections[s].page_set : "all",
+		   selected ? (int)selected_length : -1,
+		   (int)expected_length);
+	    status = 1;
+	    free(selected);
+	    break;
+	  }
+
+	  free(selected);
+	}
+
+	free(expected);
+	free(full);
+      }
+  }
+
+  if (!status)
+    puts("PASS");
+
+  fclose(in);
+  free(text);
+
+  return (status);
+}
+
+
+//
+// 'make_text()' - Make random text with long lines, tabs, CR, CRLF, and
+//                 form feeds.
+//
+
+static size_t				// O - Length of text
+make_text(char   *text,			// O - Text
+	  size_t size)			// I - Size of text buffer
+{
+  size_t	length = 0,		// Length of text
+		wordlen;		// Length of word
+  int		words;			// Words left in line
+  const char	*word;			// Current word
+  static const char * const wordlist[] =// Words to use
+  {
+    "a", "bb", "hello", "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxx", " ", " ", "  "
+  };
+  static const char * const endings[] =	// Line endings to use
+  {
+    "\n", "\n", "\n", "\r\n", "\r", "\n\f", "\f\f", ""
+  };
+
+
+  size = (size_t)rand() % size;
+
+  while (length + 100 < size)
+  {
+    for (words = rand() % ((rand() & 1) ? 40 : 10); words > 0; words --)
+    {
+      if (rand() % 30)
+        word = wordlist[rand() % (int)(sizeof(wordlist) /
+				       sizeof(wordlist[0]))];
+      else
+        word = (rand() & 1) ? "\t" : "\001";
+
+      if (length + (wordlen = strlen(word)) + 20 > size)
+        break;
+
+      memcpy(text + length, word, wordlen);
+      length += wordlen;
+
+      if (rand() & 1)
+        text[length ++] = ' ';
+    }
+
+    strcpy(text + length, endings[rand() % (int)(sizeof(endings) /
+						  sizeof(endings[0]))]);
+    length += strlen(text + length);
+  }
+
+  return (length);
+}
+
+
+//
+// 'page_selected()' - See whether a page is in a selection.
+//
+
+static int				// O - 1 if selected, 0 otherwise
+page_selected(const selection_t *sel,	// I - Page selection
+	      int               page)	// I - Page number
+{
+  const char	*ptr;			// Pointer into page ranges
+  char		*end;			// End of number
+  int		lower, upper;		// Range of pages
+
+
+  if (sel->page_set && !strcmp(sel->page_set, "odd") && !(page & 1))
+    return (0);
+
+  if (sel->page_set && !strcmp(sel->page_set, "even") && (page & 1))
+    return (0);
+
+  if (!sel->page_ranges)
+    return (1);
+
+  for (ptr = sel->page_ranges; *ptr; ptr = *end ? end + 1 : end)
+  {
+    if (*ptr == '-')
+    {
+      lower = 1;
+      end   = (char *)ptr;
+    }
+    else
+      lower = (int)strtol(ptr, &end, 10);
+
+    if (*end == '-')
+    {
+      ptr   = end + 1;
+      upper = (int)strtol(ptr, &end, 10);
+
+      if (end == ptr)
+        upper = 65535;
+    }
+    else
+      upper = lower;
+
+    if (page >= lower && page <= upper)
+      return (1);
+  }
+
+  return (0);
+}
+
+
+//
+// 'run_filter()' - Run cfFilterTextToText() and return its output.
+//
+
+static char *				// O - Output or NULL on error
+run_filter(FILE              *in,	// I - Input file
+	   const char        *wrap,	// I - over-long-lines value
+	   const char        *newline,	// I - newline-characters value
+	   const selection_t *sel,	// I - Page selection or NULL
+	   size_t            *length)	// O - Length of output
+{
+  cf_filter_data_t data;		// Filter data
+  FILE		*out;			// Output file
+  char		*output = NULL;		// Output
+  long		size;			// Size of output
+  int		num_options = 0;	// Number of options
+  cups_option_t	*options = NULL;	// Options
+
+
+  num_options = cupsAddOption("page-height", "20", num_options, &options);
+  num_options = cupsAddOption("page-width", "40", num_options, &options);
+  num_options = cupsAddOption("pagination", "yes", num_options, &options);
+  num_options = cupsAddOption("send-ff", "yes", num_options, &options);
+  num_options = cupsAddOption("over-long-lines", wrap, num_options,
+			      &options);
+  num_options = cupsAddOption("newline-characters", newline, num_options,
+			      &options);
+  if (sel && sel->page_ranges)
+    num_options = cupsAddOption("page-ranges", sel->page_ranges, num_options,
+				&options);
+  if (sel && sel->page_set)
+    num_options = cupsAddOption("page-set", sel->page_set, num_options,
+				&options);
+
+  memset(&data, 0, sizeof(data));
+  data.copies      = 1;
+  data.num_options = num_options;
+  data.options     = options;
+
+  if ((out = tmpfile()) != NULL &&
+      lseek(fileno(in), 0, SEEK_SET) == 0 &&
+      !cfFilterTextToText(dup(fileno(in)), dup(fileno(out)), 0, &data,
+			  NULL) &&
+      fseek(out, 0, SEEK_END) == 0 && (size = ftell(out)) >= 0 &&
+      (output = malloc((size_t)size + 1)) != NULL)
+  {
+    rewind(out);
+
+    if (fread(output, 1, (size_t)size, out) != (size_t)size)
+    {
+      free(output);
+      output = NULL;
+    }
+    else
+      *length = (size_t)size;
+  }
+
+  if (out)
+    fclose(out);
+
+  cupsFreeOptions(num_options, options);
+
+  return (output);
+}
@@ -0,0 +1,201 @@
+//
+// Byte checking test program for libcupsfilters.
+//
+// Compares cfCheckBytes(), cfCheckValue(), and cfCheckSpan() with
+// straightforward byte-by-byte versions on random lines of all lengths
+// and alignments.
+//
+// Licensed under Apache License v2.0.  See the file "LICENSE" for more
+// information.
+//
+// Contents:
+//
+//   main()           - Run the checking tests.
+//   ref_check_span() - Find the first and last differing byte, one byte
+//                      at a time.
+//
+
+//
+// Include necessary headers.
+//
+
+#include "driver.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+//
+// Constants...
+//
+
+#define MAX_LENGTH	300		// Longest line to test
+#define ITERATIONS	200000		// Random lines to test
+
+
+//
+// Local functions...
+//
+
+static int	ref_check_span(const unsigned char *bytes, int length,
+			       unsigned char value, int *first, int *last);
+
+
+//
+// 'main()' - Run the checking tests.
+//
+
+int					// O - Exit status
+main(void)
+{
+  int		i, j,			// Looping vars
+		length,			// Line length
+		offset,			// Alignment of line
+		changes,		// Number of differing bytes
+		pos;			// Position of differing byte
+  unsigned char	value,			// Blank value
+		buffer[MAX_LENGTH + 8],	// Line buffer
+		*bytes;			// Start of line
+  int		expected,		// Result of reference version
+		result,			// Result of library version
+		efirst, elast,		// Span of reference version
+		first, last;		// Span of library version
+  int		status = 0;		// Exit status
+
+
+  srand(1);
+
+  fputs("cfCheckBytes/cfCheckValue/cfCheckSpan: ", stdout);
+
+  for (i = 0; i < ITERATIONS; i ++)
+  {
+    length  = rand() % (MAX_LENGTH + 1);
+    offset  = rand() % 8;
+    changes = rand() % 4;
+    bytes   = buffer + offset;
+
+    switch (rand() % 3)
+    {
+      case 0 :
+          value = 0x00;
+	  break;
+      case 1 :
+          value = 0xff;
+	  break;
+      default :
+          value = rand() & 255;
+	  break;
+    }
+
+    //
+    // Fill the buffer with random bytes and the line with blank ones,
+    // then change a few of them, also at the very ends of the line...
+    //
+
+    for (j = 0; j < (int)sizeof(buffer); j ++)
+      buffer[j] = rand() & 255;
+
+    memset(bytes, value, length);
+
+    for (j = 0; j < changes && length > 0; j ++)
+    {
+      switch (rand() % 4)
+      {
+        case 0 :
+	    pos = 0;
+	    break;
+	case 1 :
+	    pos = length - 1;
+	    break;
+	default :
+	    pos = rand() % length;
+	    break;
+      }
+
+      bytes[pos] = value ^ (1 + rand() % 255);
+    }
+
+    //
+    // Compare...
+    //
+
+    expected = ref_check_span(bytes, length, value, &efirst, &elast);
+
+    if (cfCheckValue(bytes, length, value) != !expected)
+    {
+      printf("FAIL (cfCheckValue, length=%d, offset=%d, value=%d)\n",
+	     length, offset, value);
+      status = 1;
+      break;
+    }
+
+    if (value == 0 && cfCheckBytes(bytes, length) != !expected)
+    {
+      printf("FAIL (cfCheckBytes, length=%d, offset=%d)\n", length, offset);
+      status = 1;
+      break;
+    }
+
+    first  = -2;
+    last   = -2;
+    result = cfCheckSpan(bytes, length, value, &first, &last);
+
+    if (result != expected || first != efirst || last != elast)
+    {
+      printf("FAIL (cfCheckSpan, length=%d, offset=%d, value=%d, got %d "
+	     "%d-%d, expected %d %d-%d)\n", length, offset, value, result,
+	     first, last, expected, efirst, elast);
+      status = 1;
+      break;
+    }
+
+    if (cfCheckSpan(bytes, length, value, NULL, NULL) != expected)
+    {
+      printf("FAIL (cfCheckSpan without span, length=%d, offset=%d, "
+	     "value=%d)\n", length, offset, value);
+      status = 1;
+      break;
+    }
+  }
+
+  if (i == ITERATIONS)
+    puts("PASS");
+
+  return (status);
+}
+
+
+//
+// 'ref_check_span()' - Find the first and last differing byte, one byte
+//                      at a time.
+//
+
+static int				// O - 1 if some bytes differ
+ref_check_span(const unsigned char *bytes,
+					// I - Bytes to check
+	       int                 length,
+					// I - Number of bytes to check
+	       unsigned char       value,
+					// I - Value of blank bytes
+	       int                 *first,
+					// O - First non-blank byte or -1
+	       int                 *last)
+					// O - Last non-blank byte or -1
+{
+  int	i;				// Looping var
+
+
+  *first = -1;
+  *last  = -1;
+
+  for (i = 0; i < length; i ++)
+    if (bytes[i] != value)
+    {
+      if (*first < 0)
+        *first = i;
+
+      *last = i;
+    }
+
+  return (*first >= 0);
+}
@@ -11,6 +11,7 @@
 //
 //   test_gray() - Test grayscale separations...
 //   test_rgb()  - Test color separations...
+//   test_runs() - Test separating runs of identical pixels...
 //   main()      - Do color separation tests.
 //
 
@@ -19,6 +20,7 @@
 //
 
 #include <config.h>
+#include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 #include "driver.h"
@@ -29,6 +31,7 @@ void         *ld = NULL;                 // Log function data
 
 void	test_gray(int num_comps, const char *basename);
 void	test_rgb(int num_comps, const char *basename);
+int	test_runs(int num_comps, float ink_limit);
 
 
 //
@@ -39,6 +42,38 @@ int				// O - Exit status
 main(int  argc,			// I - Number of command-line arguments
      char *argv[])		// I - Command-line arguments
 {
+  int		status = 0;	// Exit status
+
+
+  (void)argc;
+  (void)argv;
+
+  //
+  // Check that runs of pixels separate like single pixels, with and
+  // without ink limit...
+  //
+
+  status |= test_runs(1, 0.0);
+  status |= test_runs(2, 0.0);
+  status |= test_runs(3, 0.0);
+  status |= test_runs(3, 2.5);
+  status |= test_runs(4, 0.0);
+  status |= test_runs(4, 2.5);
+  status |= test_runs(6, 0.0);
+  status |= test_runs(6, 3.0);
+  status |= test_runs(7, 0.0);
+  status |= test_runs(7, 3.0);
+
+  //
+  // The separation tests need a test image...
+  //
+
+  if (access("image.ppm", R_OK) || access("image.pgm", R_OK))
+  {
+    puts("Skipping separation tests, no image.ppm/image.pgm.");
+    return (status);
+  }
+
   //
   // Make the test directory...
   //
@@ -67,7 +102,7 @@ main(int  argc,			// I - Number of command-line arguments
   // Return with no errors...
   //
 
-  return (0);
+  return (status);
 }
 
 
@@ -429,3 +464,126 @@ test_rgb(int        num_comps,		// I - Number of components
 
   cfCMYKDelete(cmyk);
 }
+
+
+//
+// 'test_runs()' - Test separating runs of identical pixels...
+//
+// cfCMYKDoCMYK() and cfCMYKDoRGB() separate only the first pixel of a
+// run and copy it for the rest.  The result must be the same as when
+// separating every pixel on its own.
+//
+
+int				// O - 0 on success, 1 on failure
+test_runs(int   num_comps,	// I - Number of components
+	  float ink_limit)	// I - Ink limit or 0.0 for none
+{
+  int			i, j, k,	// Looping vars
+			n,		// Length of run
+			width,		// Width of line
+			bpp;		// Bytes per input pixel
+  unsigned char		input[500 * 4],	// Line to separate
+			color[4];	// Color of run
+  short			line[500 * CF_MAX_CHAN],
+					// Output of whole line
+			pixel[500 * CF_MAX_CHAN];
+					// Output of single pixels
+  cf_cmyk_t		*cmyk;		// Color separation
+  int			status = 0;	// Exit status
+
+
+  printf("Runs, %d colors, ink limit %.1f: ", num_comps, ink_limit);
+
+  //
+  // Create the color separation like test_rgb() does...
+  //
+
+  cmyk = cfCMYKNew(num_comps);
+
+  switch (num_comps)
+  {
+    case 2 : // Kk
+        cfCMYKSetLtDk(cmyk, 0, 0.5, 1.0, logfunc, ld);
+	break;
+
+    case 4 :
+	cfCMYKSetGamma(cmyk, 2, 1.0, 0.9, logfunc, ld);
+        cfCMYKSetBlack(cmyk, 0.5, 1.0, logfunc, ld);
+	break;
+
+    case 6 : // CcMmYK
+        cfCMYKSetLtDk(cmyk, 0, 0.5, 1.0, logfunc, ld);
+        cfCMYKSetLtDk(cmyk, 2, 0.5, 1.0, logfunc, ld);
+	cfCMYKSetGamma(cmyk, 4, 1.0, 0.9, logfunc, ld);
+        cfCMYKSetBlack(cmyk, 0.5, 1.0, logfunc, ld);
+	break;
+
+    case 7 : // CcMmYKk
+        cfCMYKSetLtDk(cmyk, 0, 0.5, 1.0, logfunc, ld);
+        cfCMYKSetLtDk(cmyk, 2, 0.5, 1.0, logfunc, ld);
+	cfCMYKSetGamma(cmyk, 4, 1.0, 0.9, logfunc, ld);
+        cfCMYKSetLtDk(cmyk, 5, 0.5, 1.0, logfunc, ld);
+	break;
+  }
+
+  if (ink_limit > 0.0)
+    cfCMYKSetInkLimit(cmyk, ink_limit);
+
+  srand(num_comps);
+
+  for (i = 0; i < 2000 && !status; i ++)
+  {
+    //
+    // Make a line of random runs of random colors, CMYK for the even and
+    // RGB for the odd lines...
+    //
+
+    bpp   = (i & 1) ? 3 : 4;
+    width = 1 + rand() % 500;
+
+    for (j = 0; j < width; j += n)
+    {
+      n = 1 + rand() % 40;
+      if (n > width - j)
+        n = width - j;
+
+      color[0] = rand() & 255;
+      color[1] = rand() & 255;
+      color[2] = rand() & 255;
+      color[3] = rand() & 255;
+
+      for (k = 0; k < n; k ++)
+        memcpy(input + (j + k) * bpp, color, bpp);
+    }
+
+    //
+    // Separate the line as a whole and pixel by pixel, and compare...
+    //
+
+    if (bpp == 4)
+    {
+      cfCMYKDoCMYK(cmyk, input, line, width);
+      for (j = 0; j < width; j ++)
+	cfCMYKDoCMYK(cmyk, input + j * 4, pixel + j * num_comps, 1);
+    }
+    else
+    {
+      cfCMYKDoRGB(cmyk, input, line, width);
+      for (j = 0; j < width; j ++)
+	cfCMYKDoRGB(cmyk, input + j * 3, pixel + j * num_comps, 1);
+    }
+
+    if (memcmp(line, pixel, width * num_comps * sizeof(short)))
+    {
+      printf("FAIL (%s line %d differs)\n", bpp == 4 ? "CMYK" : "RGB", i);
+      status = 1;
+    }
+  }
+
+  if (!status)
+    puts("PASS");
+
+  cfCMYKDelete(cmyk);
+
+  return (status);
+}
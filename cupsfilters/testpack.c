@@ -0,0 +1,286 @@
+//
+// Bit packing test program for libcupsfilters.
+//
+// Compares cfPackHorizontal(), cfPackHorizontalBit(), and
+// cfPackVertical() with straightforward per-pixel versions on random
+// lines of all lengths, strides, and alignments.
+//
+// Licensed under Apache License v2.0.  See the file "LICENSE" for more
+// information.
+//
+// Contents:
+//
+//   main()                - Run the packing tests.
+//   fill_pixels()         - Fill a line with random pixels.
+//   ref_pack_horizontal() - Pack pixels horizontally, one at a time.
+//   ref_pack_horizontal_bit() - Pack pixel bits horizontally, one at a
+//                           time.
+//   ref_pack_vertical()   - Pack pixels vertically, one at a time.
+//
+
+//
+// Include necessary headers.
+//
+
+#include "driver.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+//
+// Constants...
+//
+
+#define MAX_WIDTH	200		// Longest line to test
+#define MAX_STEP	8		// Largest stride to test
+#define GUARD		16		// Guard bytes around the output
+#define ITERATIONS	20000		// Random lines per test
+
+
+//
+// Local functions...
+//
+
+static void	fill_pixels(unsigned char *pixels, int count);
+static void	ref_pack_horizontal(const unsigned char *ipixels,
+				    unsigned char *obytes, int width,
+				    unsigned char clearto, int step);
+static void	ref_pack_horizontal_bit(const unsigned char *ipixels,
+					unsigned char *obytes, int width,
+					unsigned char clearto,
+					unsigned char bit);
+static void	ref_pack_vertical(const unsigned char *ipixels,
+				  unsigned char *obytes, int width,
+				  unsigned char bit, int step);
+
+
+//
+// 'main()' - Run the packing tests.
+//
+
+int					// O - Exit status
+main(void)
+{
+  int		i,			// Looping var
+		width,			// Line width
+		step,			// Stride
+		offset,			// Alignment of input
+		nbytes;			// Number of output bytes
+  unsigned char	clearto,		// Initial value of bytes
+		bit;			// Bit to test or set
+  unsigned char	ipixels[MAX_WIDTH * MAX_STEP + 8],
+					// Input pixels
+		expected[MAX_WIDTH * MAX_STEP + 2 * GUARD],
+					// Output of reference version
+		obytes[MAX_WIDTH * MAX_STEP + 2 * GUARD];
+					// Output of library version
+  int		status = 0;		// Exit status
+
+
+  srand(1);
+
+  //
+  // cfPackHorizontal()...
+  //
+
+  fputs("cfPackHorizontal: ", stdout);
+
+  for (i = 0; i < ITERATIONS; i ++)
+  {
+    width   = rand() % (MAX_WIDTH + 1);
+    step    = 1 + rand() % MAX_STEP;
+    offset  = rand() % 8;
+    clearto = (rand() & 1) ? 0xff : 0x00;
+    nbytes  = (width + 7) / 8;
+
+    fill_pixels(ipixels, sizeof(ipixels));
+    memset(expected, 0x5a, sizeof(expected));
+    memset(obytes, 0x5a, sizeof(obytes));
+
+    ref_pack_horizontal(ipixels + offset, expected + GUARD, width, clearto,
+			step);
+    cfPackHorizontal(ipixels + offset, obytes + GUARD, width, clearto, step);
+
+    if (memcmp(expected, obytes, nbytes + 2 * GUARD))
+    {
+      printf("FAIL (width=%d, step=%d, offset=%d, clearto=%d)\n", width,
+	     step, offset, clearto);
+      status = 1;
+      break;
+    }
+  }
+
+  if (i == ITERATIONS)
+    puts("PASS");
+
+  //
+  // cfPackHorizontalBit()...
+  //
+
+  fputs("cfPackHorizontalBit: ", stdout);
+
+  for (i = 0; i < ITERATIONS; i ++)
+  {
+    width   = rand() % (MAX_WIDTH + 1);
+    offset  = rand() % 8;
+    clearto = (rand() & 1) ? 0xff : 0x00;
+    bit     = 1 << (rand() % 8);
+    nbytes  = (width + 7) / 8;
+
+    fill_pixels(ipixels, sizeof(ipixels));
+    memset(expected, 0x5a, sizeof(expected));
+    memset(obytes, 0x5a, sizeof(obytes));
+
+    ref_pack_horizontal_bit(ipixels + offset, expected + GUARD, width,
+			    clearto, bit);
+    cfPackHorizontalBit(ipixels + offset, obytes + GUARD, width, clearto,
+			bit);
+
+    if (memcmp(expected, obytes, nbytes + 2 * GUARD))
+    {
+      printf("FAIL (width=%d, offset=%d, clearto=%d, bit=%d)\n", width,
+	     offset, clearto, bit);
+      status = 1;
+      break;
+    }
+  }
+
+  if (i == ITERATIONS)
+    puts("PASS");
+
+  //
+  // cfPackVertical(), which sets bits in existing output...
+  //
+
+  fputs("cfPackVertical: ", stdout);
+
+  for (i = 0; i < ITERATIONS; i ++)
+  {
+    width  = rand() % (MAX_WIDTH + 1);
+    step   = 1 + rand() % MAX_STEP;
+    offset = rand() % 8;
+    bit    = 1 << (rand() % 8);
+    nbytes = width * step;
+
+    fill_pixels(ipixels, sizeof(ipixels));
+    fill_pixels(expected, sizeof(expected));
+    memcpy(obytes, expected, sizeof(obytes));
+
+    ref_pack_vertical(ipixels + offset, expected + GUARD, width, bit, step);
+    cfPackVertical(ipixels + offset, obytes + GUARD, width, bit, step);
+
+    if (memcmp(expected, obytes, nbytes + 2 * GUARD))
+    {
+      printf("FAIL (width=%d, step=%d, offset=%d, bit=%d)\n", width, step,
+	     offset, bit);
+      status = 1;
+      break;
+    }
+  }
+
+  if (i == ITERATIONS)
+    puts("PASS");
+
+  return (status);
+}
+
+
+//
+// 'fill_pixels()' - Fill a line with random pixels.
+//
+// Half of the lines are mostly zero, so that runs of blank pixels and
+// of set pixels both get tested.
+//
+
+static void
+fill_pixels(unsigned char *pixels,	// O - Pixels
+	    int           count)	// I - Number of pixels
+{
+  int	density = rand() % 4;		// Chance of a non-zero pixel
+
+
+  while (count > 0)
+  {
+    if (density == 0 || (rand() % 4) < density)
+      *pixels++ = rand() & 255;
+    else
+      *pixels++ = 0;
+
+    count --;
+  }
+}
+
+
+//
+// 'ref_pack_horizontal()' - Pack pixels horizontally, one at a time.
+//
+
+static void
+ref_pack_horizontal(
+    const unsigned char *ipixels,	// I - Input pixels
+    unsigned char       *obytes,	// O - Output bytes
+    int                 width,		// I - Number of pixels
+    unsigned char       clearto,	// I - Initial value of bytes
+    int                 step)		// I - Step value between pixels
+{
+  int	x;				// Current pixel
+
+
+  for (x = 0; x < width; x ++)
+  {
+    if ((x & 7) == 0)
+      obytes[x / 8] = clearto;
+
+    if (ipixels[x * step])
+      obytes[x / 8] ^= 0x80 >> (x & 7);
+  }
+}
+
+
+//
+// 'ref_pack_horizontal_bit()' - Pack pixel bits horizontally, one at a
+//                               time.
+//
+
+static void
+ref_pack_horizontal_bit(
+    const unsigned char *ipixels,	// I - Input pixels
+    unsigned char       *obytes,	// O - Output bytes
+    int                 width,		// I - Number of pixels
+    unsigned char       clearto,	// I - Initial value of bytes
+    unsigned char       bit)		// I - Bit to check
+{
+  int	x;				// Current pixel
+
+
+  for (x = 0; x < width; x ++)
+  {
+    if ((x & 7) == 0)
+      obytes[x / 8] = clearto;
+
+    if (ipixels[x] & bit)
+      obytes[x / 8] ^= 0x80 >> (x & 7);
+  }
+}
+
+
+//
+// 'ref_pack_vertical()' - Pack pixels vertically, one at a time.
+//
+
+static void
+ref_pack_vertical(
+    const unsigned char *ipixels,	// I - Input pixels
+    unsigned char       *obytes,	// O - Output bytes
+    int                 width,		// I - Number of input pixels
+    unsigned char       bit,		// I - Output bit
+    int                 step)		// I - Number of bytes between columns
+{
+  int	x;				// Current pixel
+
+
+  for (x = 0; x < width; x ++)
+    if (ipixels[x])
+      obytes[x * step] ^= bit;
+}
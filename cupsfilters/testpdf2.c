@@ -23,15 +23,14 @@ write_string(_cf_pdf_out_t *pdf,
 
   if (emb->plan & _CF_FONTEMBED_EMB_A_MULTIBYTE)
   {
-    putc('<', stdout);
+    _cfPDFOutPrintF(pdf, "<");
     for (iA = 0; str[iA]; iA ++)
     {
       const unsigned short gid = _cfFontEmbedEmbGet(emb,
 						    (unsigned char)str[iA]);
-      fprintf(stdout, "%04x", gid);
+      _cfPDFOutPrintF(pdf, "%04x", gid);
     }
-    putc('>', stdout);
-    pdf->filepos += 4 * iA + 2;
+    _cfPDFOutPrintF(pdf, ">");
   }
   else
   {
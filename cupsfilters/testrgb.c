@@ -11,6 +11,7 @@
 //
 //   main()       - Do color rgb tests.
 //   test_gray()  - Test grayscale rgbs...
+//   test_lut()   - Test the dense LUT against the sample cube...
 //   test_rgb()   - Test color rgbs...
 //
 
@@ -19,6 +20,7 @@
 //
 
 #include <config.h>
+#include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 #include "driver.h"
@@ -31,6 +33,8 @@
 
 void	test_gray(cf_sample_t *samples, int num_samples,
 	          int cube_size, int num_comps, const char *basename);
+int	test_lut(cf_sample_t *samples, int num_samples,
+		 int cube_size, int num_comps, int lut_size);
 void	test_rgb(cf_sample_t *samples, int num_samples,
 		 int cube_size, int num_comps,
 		 const char *basename);
@@ -56,8 +60,29 @@ main(int  argc,				// I - Number of command-line arguments
 			  { { 0,   255, 255 }, { 200, 0,   0,   0   } },
 			  { { 255, 255, 255 }, { 0,   0,   0,   0   } }
 			};
+  int			status = 0;	// Exit status
 
 
+  (void)argc;
+  (void)argv;
+
+  //
+  // Check the dense LUT against the sample cube...
+  //
+
+  status |= test_lut(CMYK, 8, 2, 4, 17);
+  status |= test_lut(CMYK, 8, 2, 4, 33);
+
+  //
+  // The separation tests need a test image...
+  //
+
+  if (access("image.ppm", R_OK) || access("image.pgm", R_OK))
+  {
+    puts("Skipping separation tests, no image.ppm/image.pgm.");
+    return (status);
+  }
+
   //
   // Make the test directory...
   //
@@ -76,7 +101,7 @@ main(int  argc,				// I - Number of command-line arguments
   // Return with no errors...
   //
 
-  return (0);
+  return (status);
 }
 
 
@@ -210,6 +235,91 @@ test_gray(cf_sample_t   *samples,	// I - Sample values
 }
 
 
+//
+// 'test_lut()' - Test the dense LUT against the sample cube...
+//
+// The tetrahedral interpolation in the LUT only approximates the
+// trilinear interpolation in the cube, so small differences are
+// expected; black and white must come out exactly.
+//
+
+int					// O - 0 on success, 1 on failure
+test_lut(cf_sample_t   *samples,	// I - Sample values
+         int           num_samples,	// I - Number of samples
+	 int           cube_size,	// I - Cube size
+         int           num_comps,	// I - Number of components
+	 int           lut_size)	// I - Size of LUT on a side
+{
+  int			i,		// Looping var
+			diff,		// Difference of a channel
+			maxdiff = 0;	// Largest difference
+  int			r, g, b;	// Current RGB color
+  unsigned char		input[256 * 3],	// Line to separate
+			cube[256 * CF_MAX_RGB],
+					// Output using the sample cube
+			lut[256 * CF_MAX_RGB];
+					// Output using the dense LUT
+  cf_rgb_t		*rgb,		// Color separation
+			*rgblut;	// Color separation with LUT
+  static const unsigned char bw[6] = { 0, 0, 0, 255, 255, 255 };
+					// Black and white
+
+
+  printf("cfRGBSetLUT(%d): ", lut_size);
+
+  rgb    = cfRGBNew(num_samples, samples, cube_size, num_comps);
+  rgblut = cfRGBNew(num_samples, samples, cube_size, num_comps);
+
+  if (!rgb || !rgblut || cfRGBSetLUT(rgblut, lut_size))
+  {
+    puts("FAIL (unable to create separation)");
+    cfRGBDelete(rgb);
+    cfRGBDelete(rgblut);
+    return (1);
+  }
+
+  for (r = 0; r < 256; r += 3)
+    for (g = 0; g < 256; g += 3)
+    {
+      for (b = 0, i = 0; b < 256; b ++)
+      {
+        input[i ++] = r;
+        input[i ++] = g;
+        input[i ++] = b;
+      }
+
+      cfRGBDoRGB(rgb, input, cube, 256);
+      cfRGBDoRGB(rgblut, input, lut, 256);
+
+      for (i = 0; i < 256 * num_comps; i ++)
+      {
+        diff = abs(cube[i] - lut[i]);
+	if (diff > maxdiff)
+	  maxdiff = diff;
+      }
+    }
+
+  cfRGBDoRGB(rgblut, bw, lut, 2);
+  cfRGBDelete(rgb);
+  cfRGBDelete(rgblut);
+
+  if (memcmp(lut, samples[0].colors, num_comps) ||
+      memcmp(lut + num_comps, samples[num_samples - 1].colors, num_comps))
+  {
+    puts("FAIL (black or white differ)");
+    return (1);
+  }
+  else if (maxdiff > 8)
+  {
+    printf("FAIL (difference %d)\n", maxdiff);
+    return (1);
+  }
+
+  printf("PASS (difference %d)\n", maxdiff);
+  return (0);
+}
+
+
 //
 // 'test_rgb()' - Test color rgbs...
 //
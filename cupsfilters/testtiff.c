@@ -0,0 +1,495 @@
+//
+// TIFF reader test program for libcupsfilters.
+//
+// Writes small TIFF images as strips and tiles, with and without
+// compression and in all horizontal scanline orientations, reads them
+// back with cfImageOpen(), and compares the pixels with the ones
+// written.
+//
+// Licensed under Apache License v2.0.  See the file "LICENSE" for more
+// information.
+//
+// Contents:
+//
+//   main()       - Run the TIFF reader tests.
+//   file_pixel() - Return a sample of the test image.
+//   test_tiff()  - Write a TIFF image, read it back, and compare.
+//   write_tiff() - Write the test image as a TIFF file.
+//
+
+//
+// Include necessary headers.
+//
+
+#include <config.h>
+#include "image.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef HAVE_LIBTIFF
+#  include <tiffio.h>
+
+
+//
+// Constants...
+//
+
+#  define WIDTH		37		// Width of test image
+#  define HEIGHT	29		// Height of test image
+#  define TILE		16		// Width and height of tiles
+
+
+//
+// Types...
+//
+
+typedef enum tiff_kind_e		// **** Kind of test image ****
+{
+  TIFF_GRAY,				// 8-bit min-is-black gray
+  TIFF_GRAY_INVERTED,			// 8-bit min-is-white gray
+  TIFF_GRAY_ALPHA,			// 8-bit gray with alpha
+  TIFF_RGB,				// 8-bit RGB
+  TIFF_RGB_ALPHA,			// 8-bit RGB with alpha
+  TIFF_CMYK_RGB,			// 8-bit CMYK read as RGB
+  TIFF_CMYK,				// 8-bit CMYK read as CMYK
+  TIFF_RGB_EXTRA,			// 8-bit RGB with alpha and another
+					// extra sample
+  TIFF_CMYK_ALPHA,			// 8-bit CMYK with alpha read as CMYK
+  TIFF_CMYK_RGB_ALPHA,			// 8-bit CMYK with alpha read as RGB
+  TIFF_GRAY4				// 4-bit gray, read as RGB
+} tiff_kind_t;
+
+typedef struct tiff_test_s		// **** Test image ****
+{
+  const char	*name;			// Name of test
+  tiff_kind_t	kind;			// Kind of image
+  uint16_t	photometric,		// Photometric interpretation
+		samples,		// Samples per pixel
+		alpha,			// Alpha sample, 0 for none
+		bits;			// Bits per sample
+  cf_icspace_t	primary,		// Primary colorspace to read
+		secondary;		// Secondary colorspace to read
+} tiff_test_t;
+
+
+//
+// Local globals...
+//
+
+static const tiff_test_t tests[] =	// Test images
+{
+  { "gray", TIFF_GRAY, PHOTOMETRIC_MINISBLACK, 1, 0, 8,
+    CF_IMAGE_RGB, CF_IMAGE_WHITE },
+  { "gray, min-is-white", TIFF_GRAY_INVERTED, PHOTOMETRIC_MINISWHITE, 1, 0,
+    8, CF_IMAGE_RGB, CF_IMAGE_WHITE },
+  { "gray+alpha", TIFF_GRAY_ALPHA, PHOTOMETRIC_MINISBLACK, 2, 1, 8,
+    CF_IMAGE_RGB, CF_IMAGE_WHITE },
+  { "rgb", TIFF_RGB, PHOTOMETRIC_RGB, 3, 0, 8,
+    CF_IMAGE_RGB, CF_IMAGE_WHITE },
+  { "rgb+alpha", TIFF_RGB_ALPHA, PHOTOMETRIC_RGB, 4, 3, 8,
+    CF_IMAGE_RGB, CF_IMAGE_WHITE },
+  { "cmyk as rgb", TIFF_CMYK_RGB, PHOTOMETRIC_SEPARATED, 4, 0, 8,
+    CF_IMAGE_RGB, CF_IMAGE_WHITE },
+  { "cmyk", TIFF_CMYK, PHOTOMETRIC_SEPARATED, 4, 0, 8,
+    CF_IMAGE_RGB_CMYK, CF_IMAGE_WHITE },
+  { "rgb+alpha+extra", TIFF_RGB_EXTRA, PHOTOMETRIC_RGB, 5, 3, 8,
+    CF_IMAGE_RGB, CF_IMAGE_WHITE },
+  { "cmyk+alpha", TIFF_CMYK_ALPHA, PHOTOMETRIC_SEPARATED, 5, 4, 8,
+    CF_IMAGE_RGB_CMYK, CF_IMAGE_WHITE },
+  { "cmyk+alpha as rgb", TIFF_CMYK_RGB_ALPHA, PHOTOMETRIC_SEPARATED, 5, 4,
+    8, CF_IMAGE_RGB, CF_IMAGE_WHITE },
+  { "4-bit gray", TIFF_GRAY4, PHOTOMETRIC_MINISBLACK, 1, 0, 4,
+    CF_IMAGE_RGB, CF_IMAGE_RGB }
+};
+
+static const uint16_t orientations[] =	// Orientations to test
+{
+  ORIENTATION_TOPLEFT,
+  ORIENTATION_TOPRIGHT,
+  ORIENTATION_BOTRIGHT,
+  ORIENTATION_BOTLEFT
+};
+
+static const uint32_t rows_per_strip[] =// Strip layouts, 0 = tiled
+{
+  1,
+  5,
+  HEIGHT,
+  0
+};
+
+
+//
+// Local functions...
+//
+
+static int	file_pixel(const tiff_test_t *t, int x, int y, int c);
+static int	test_tiff(const char *filename, const tiff_test_t *t,
+			  uint32_t rps, uint16_t compression,
+			  uint16_t orientation);
+static int	write_tiff(const char *filename, const tiff_test_t *t,
+			   uint32_t rps, uint16_t compression,
+			   uint16_t orientation);
+#endif // HAVE_LIBTIFF
+
+
+//
+// 'main()' - Run the TIFF reader tests.
+//
+
+int					// O - Exit status
+main(void)
+{
+#ifdef HAVE_LIBTIFF
+  int		i, j, k, c;		// Looping vars
+  const char	*tmpdir;		// Temporary directory
+  char		filename[1024];		// Test image file
+  uint16_t	compression;		// Compression of image
+  int		status = 0;		// Exit status
+
+
+  if ((tmpdir = getenv("TMPDIR")) == NULL)
+    tmpdir = "/tmp";
+
+  snprintf(filename, sizeof(filename), "%s/testtiff-%d.tif", tmpdir,
+	   (int)getpid());
+
+  TIFFSetWarningHandler(NULL);
+
+  for (i = 0; i < (int)(sizeof(tests) / sizeof(tests[0])); i ++)
+  {
+    printf("%s: ", tests[i].name);
+    fflush(stdout);
+
+    for (j = 0; j < (int)(sizeof(rows_per_strip) / sizeof(rows_per_strip[0]));
+	 j ++)
+    {
+      //
+      // The scanline reader handles 4-bit strips and the RGBA reader
+      // only top-left tiles...
+      //
+
+      if (tests[i].bits != 8 && rows_per_strip[j])
+        continue;
+
+      for (k = 0; k < (int)(sizeof(orientations) / sizeof(orientations[0]));
+	   k ++)
+      {
+        if (tests[i].bits != 8 && orientations[k] != ORIENTATION_TOPLEFT)
+	  continue;
+
+        for (c = 0; c < 2; c ++)
+	{
+	  compression = c ? COMPRESSION_LZW : COMPRESSION_NONE;
+
+	  if (!test_tiff(filename, tests + i, rows_per_strip[j], compression,
+			 orientations[k]))
+	  {
+	    printf("FAIL (%s, orientation %d, %s)\n",
+		   rows_per_strip[j] ? "strips" : "tiles", orientations[k],
+		   c ? "LZW" : "uncompressed");
+	    status = 1;
+	    goto next;
+	  }
+	}
+      }
+    }
+
+    puts("PASS");
+
+    next:
+
+    unlink(filename);
+  }
+
+  return (status);
+#else
+  puts("testtiff: TIFF support not compiled in, skipping.");
+
+  return (77);
+#endif // HAVE_LIBTIFF
+}
+
+
+#ifdef HAVE_LIBTIFF
+//
+// 'file_pixel()' - Return a sample of the test image.
+//
+// The pattern covers 0 and 255 and, for alpha, fully transparent and
+// fully opaque pixels.  Extra samples after the alpha sample have the
+// same pattern and must be ignored.
+//
+
+static int				// O - Sample value
+file_pixel(const tiff_test_t *t,	// I - Test image
+	   int               x,		// I - Column in file
+	   int               y,		// I - Row in file
+	   int               c)		// I - Sample in pixel
+{
+  int	v = (x * 7 + y * 13 + c * 71 + ((x * y) & 15) * 5) & 255;
+					// Sample value
+
+
+  if (t->bits == 4)
+    return (v >> 4);
+  else if (x == 0)
+    return (0);
+  else if (x == WIDTH - 1)
+    return (255);
+  else if (t->alpha && c == t->alpha && y == 1)
+    return ((x & 1) ? 0 : 255);
+  else
+    return (v);
+}
+
+
+//
+// 'test_tiff()' - Write a TIFF image, read it back, and compare.
+//
+
+static int				// O - 1 if the pixels match
+test_tiff(const char *filename,		// I - Test image file
+	  const tiff_test_t *t,		// I - Test image
+	  uint32_t   rps,		// I - Rows per strip, 0 for tiles
+	  uint16_t   compression,	// I - Compression
+	  uint16_t   orientation)	// I - Orientation
+{
+  cf_image_t	*img;			// Image read back
+  cf_ib_t	line[WIDTH * 4];	// Row of image
+  int		x, y,			// Position in image
+		fx, fy,			// Position in file
+		c, depth,		// Sample and number of samples
+		expected[4],		// Expected samples
+		v, a, k;		// Sample, alpha, and black values
+  int		ret = 1;		// Return value
+
+
+  if (!write_tiff(filename, t, rps, compression, orientation))
+  {
+    fputs("unable to write image, ", stdout);
+    return (0);
+  }
+
+  if ((img = cfImageOpen(filename, t->primary, t->secondary, 100, 0,
+			 NULL)) == NULL)
+  {
+    fputs("unable to read image, ", stdout);
+    return (0);
+  }
+
+  depth = cfImageGetDepth(img);
+
+  if (cfImageGetWidth(img) != WIDTH || cfImageGetHeight(img) != HEIGHT ||
+      depth != (t->kind == TIFF_CMYK || t->kind == TIFF_CMYK_ALPHA ? 4 :
+		t->kind <= TIFF_GRAY_ALPHA ? 1 : 3))
+  {
+    printf("bad image %dx%dx%d, ", cfImageGetWidth(img),
+	   cfImageGetHeight(img), depth);
+    cfImageClose(img);
+    return (0);
+  }
+
+  for (y = 0; y < HEIGHT && ret; y ++)
+  {
+    cfImageGetRow(img, 0, y, WIDTH, line);
+
+    fy = (orientation == ORIENTATION_BOTLEFT ||
+	  orientation == ORIENTATION_BOTRIGHT) ? HEIGHT - 1 - y : y;
+
+    for (x = 0; x < WIDTH && ret; x ++)
+    {
+      fx = (orientation == ORIENTATION_TOPRIGHT ||
+	    orientation == ORIENTATION_BOTRIGHT) ? WIDTH - 1 - x : x;
+
+      switch (t->kind)
+      {
+        case TIFF_GRAY :
+	    expected[0] = file_pixel(t, fx, fy, 0);
+	    break;
+
+        case TIFF_GRAY_INVERTED :
+	    expected[0] = 255 - file_pixel(t, fx, fy, 0);
+	    break;
+
+        case TIFF_GRAY_ALPHA :
+	    v           = file_pixel(t, fx, fy, 0);
+	    a           = file_pixel(t, fx, fy, 1);
+	    expected[0] = (a * v + (255 - a) * 255) / 255;
+	    break;
+
+        case TIFF_RGB :
+        case TIFF_CMYK :
+	    for (c = 0; c < depth; c ++)
+	      expected[c] = file_pixel(t, fx, fy, c);
+	    break;
+
+        case TIFF_RGB_ALPHA :
+        case TIFF_RGB_EXTRA :
+	    a = file_pixel(t, fx, fy, t->alpha);
+	    for (c = 0; c < 3; c ++)
+	      expected[c] = (file_pixel(t, fx, fy, c) * a + 255 * (255 - a)) /
+			    255;
+	    break;
+
+        case TIFF_CMYK_ALPHA :
+	    a = file_pixel(t, fx, fy, t->alpha);
+	    for (c = 0; c < 4; c ++)
+	      expected[c] = file_pixel(t, fx, fy, c) * a / 255;
+	    break;
+
+        case TIFF_CMYK_RGB :
+        case TIFF_CMYK_RGB_ALPHA :
+	    k = file_pixel(t, fx, fy, 3);
+	    a = t->alpha ? file_pixel(t, fx, fy, t->alpha) : 255;
+	    for (c = 0; c < 3; c ++)
+	    {
+	      v           = 255 - file_pixel(t, fx, fy, c) - k;
+	      v           = v < 0 ? 0 : v;
+	      expected[c] = (v * a + 255 * (255 - a)) / 255;
+	    }
+	    break;
+
+        case TIFF_GRAY4 :
+	    for (c = 0; c < 3; c ++)
+	      expected[c] = file_pixel(t, fx, fy, 0) * 17;
+	    break;
+      }
+
+      for (c = 0; c < depth; c ++)
+        if (line[x * depth + c] != expected[c])
+	{
+	  printf("pixel %dx%d sample %d is %d, expected %d, ", x, y, c,
+		 line[x * depth + c], expected[c]);
+	  ret = 0;
+	  break;
+	}
+    }
+  }
+
+  cfImageClose(img);
+
+  return (ret);
+}
+
+
+//
+// 'write_tiff()' - Write the test image as a TIFF file.
+//
+
+static int				// O - 1 on success, 0 on error
+write_tiff(const char *filename,	// I - Test image file
+	   const tiff_test_t *t,	// I - Test image
+	   uint32_t   rps,		// I - Rows per strip, 0 for tiles
+	   uint16_t   compression,	// I - Compression
+	   uint16_t   orientation)	// I - Orientation
+{
+  TIFF		*tif;			// TIFF file
+  unsigned char	*image,			// Image samples
+		*tile,			// Tile samples
+		*p;			// Pointer into samples
+  int		x, y, c,		// Looping vars
+		rowbytes,		// Bytes per row of image
+		tilebytes;		// Bytes per row of tile
+  uint32_t	row, col;		// Current strip or tile
+  uint16_t	extras[2] = { EXTRASAMPLE_UNSPECIFIED,
+			  EXTRASAMPLE_UNSPECIFIED },
+					// Types of extra samples
+		num_extras;		// Number of extra samples
+  int		ret = 1;		// Return value
+
+
+  if ((tif = TIFFOpen(filename, "w")) == NULL)
+    return (0);
+
+  rowbytes  = (WIDTH * t->samples * t->bits + 7) / 8;
+  tilebytes = TILE * t->samples * t->bits / 8;
+
+  if ((image = calloc(HEIGHT, rowbytes)) == NULL ||
+      (tile = calloc(TILE, tilebytes)) == NULL)
+  {
+    free(image);
+    TIFFClose(tif);
+    return (0);
+  }
+
+  for (y = 0; y < HEIGHT; y ++)
+    for (x = 0; x < WIDTH; x ++)
+      for (c = 0; c < t->samples; c ++)
+      {
+        p = image + y * rowbytes;
+
+        if (t->bits == 4)
+	  p[x / 2] |= file_pixel(t, x, y, c) << ((x & 1) ? 0 : 4);
+	else
+	  p[x * t->samples + c] = file_pixel(t, x, y, c);
+      }
+
+  TIFFSetField(tif, TIFFTAG_IMAGEWIDTH, (uint32_t)WIDTH);
+  TIFFSetField(tif, TIFFTAG_IMAGELENGTH, (uint32_t)HEIGHT);
+  TIFFSetField(tif, TIFFTAG_BITSPERSAMPLE, t->bits);
+  TIFFSetField(tif, TIFFTAG_SAMPLESPERPIXEL, t->samples);
+  TIFFSetField(tif, TIFFTAG_PHOTOMETRIC, t->photometric);
+  TIFFSetField(tif, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
+  TIFFSetField(tif, TIFFTAG_COMPRESSION, compression);
+  TIFFSetField(tif, TIFFTAG_ORIENTATION, orientation);
+
+  if (t->photometric == PHOTOMETRIC_RGB)
+    num_extras = t->samples - 3;
+  else if (t->photometric == PHOTOMETRIC_SEPARATED)
+    num_extras = t->samples - 4;
+  else
+    num_extras = t->samples - 1;
+
+  if (t->alpha)
+    extras[0] = EXTRASAMPLE_UNASSALPHA;
+
+  if (num_extras > 0)
+    TIFFSetField(tif, TIFFTAG_EXTRASAMPLES, num_extras, extras);
+
+  if (t->photometric == PHOTOMETRIC_SEPARATED)
+    TIFFSetField(tif, TIFFTAG_INKSET, INKSET_CMYK);
+
+  if (rps)
+  {
+    TIFFSetField(tif, TIFFTAG_ROWSPERSTRIP, rps);
+
+    for (row = 0; row < HEIGHT && ret; row += rps)
+      if (TIFFWriteEncodedStrip(tif, row / rps, image + row * rowbytes,
+				(HEIGHT - row < rps ? HEIGHT - row : rps) *
+				    rowbytes) < 0)
+        ret = 0;
+  }
+  else
+  {
+    TIFFSetField(tif, TIFFTAG_TILEWIDTH, (uint32_t)TILE);
+    TIFFSetField(tif, TIFFTAG_TILELENGTH, (uint32_t)TILE);
+
+    for (row = 0; row < HEIGHT && ret; row += TILE)
+      for (col = 0; col < WIDTH && ret; col += TILE)
+      {
+        //
+	// Partial tiles at the right and bottom are padded with zeros...
+	//
+
+        memset(tile, 0, TILE * tilebytes);
+
+        for (y = 0; y < TILE && row + y < HEIGHT; y ++)
+	  memcpy(tile + y * tilebytes,
+		 image + (row + y) * rowbytes + col * t->samples * t->bits / 8,
+		 WIDTH - col < TILE ? rowbytes - col * t->samples * t->bits / 8 :
+				      tilebytes);
+
+        if (TIFFWriteTile(tif, tile, col, row, 0, 0) < 0)
+	  ret = 0;
+      }
+  }
+
+  TIFFClose(tif);
+  free(image);
+  free(tile);
+
+  return (ret);
+}
+#endif // HAVE_LIBTIFF
@@ -23,6 +23,11 @@
 #include <cupsfilters/libcups2-private.h>
 #include <ctype.h>
 #include <errno.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#ifdef HAVE_PTHREAD_H
+#  include <pthread.h>
+#endif // HAVE_PTHREAD_H
 #ifdef HAVE_FONTCONFIG
 #include "fontconfig/fontconfig.h"
 #endif // HAVE_FONTCONFIG
@@ -52,6 +57,10 @@
 #define PRETTY_PERL	4
 #define PRETTY_HTML	5
 
+#define INPUT_BLOCK	65536	// Bytes of input decoded at a time
+#define INPUT_ASCII	0x8080808080808080ULL
+				// High bit of every byte in a word
+
 
 //
 // Globals...
@@ -481,6 +490,19 @@ typedef struct			// **** Character/attribute structure... ****
 		attr;		// Any attributes
 } lchar_t;
 
+typedef struct			// **** Buffered UTF-8 input... ****
+{
+  int		fd;		// File to read from
+  int		eof;		// Reached the end of the file?
+  size_t	bytes;		// Bytes not yet decoded
+  unsigned char	buffer[INPUT_BLOCK];
+				// Raw input
+  int		chars[INPUT_BLOCK],
+				// Decoded characters
+		*charptr,	// Next character
+		*charend;	// End of decoded characters
+} texttopdf_input_t;
+
 typedef struct texttopdf_doc_s
 {
   int		NumFonts;	// Number of fonts to use
@@ -490,6 +512,7 @@ typedef struct texttopdf_doc_s
   int		Widths[256];	// Widths of each font
   int		Directions[256];// Text directions for each font
   _cf_pdf_out_t	*pdf;
+  int		OutputFD;	// File descriptor for the PDF output
   int		FontResource;   // Object number of font resource dictionary
   float		FontScaleX, FontScaleY; // The font matrix
   lchar_t	*Title, *Date;	// The title and date strings
@@ -513,6 +536,7 @@ typedef struct texttopdf_doc_s
 		ColumnGutter,	// Number of characters between text columns
 		ColumnWidth,	// Width of each column
 		PrettyPrint,	// Do pretty code formatting?
+		Compress,	// Compress content and xref (PDF 1.5)?
 		Copies;		// Number of copies to produce
   float		CharsPerInch,	// Number of character columns per inch
 		LinesPerInch;	// Number of lines per inch
@@ -527,15 +551,52 @@ typedef struct texttopdf_doc_s
 } texttopdf_doc_t;
 
 
+//
+// Fonts used by the jobs are kept in a process-wide cache, so that
+// fontconfig is only asked once per font pattern and each font file is
+// only parsed once.  Entries are keyed by the pattern from the charset
+// file and checked against the modification time of the font file.  A
+// loaded font is used by one job at a time; a job finding it busy loads
+// its own copy.
+//
+
+#define FONT_CACHE_SIZE 32
+
+typedef struct font_cache_s
+{
+  char		*pattern;	// Font pattern, NULL for unused entries
+  char		*filename;	// Font file (with "/index" for TTC)
+  time_t	mtime;		// Modification time of font file
+  _cf_fontembed_otf_file_t *otf;// Loaded font or NULL
+  int		in_use;		// Is the loaded font used by a job?
+} font_cache_t;
+
+static font_cache_t font_cache[FONT_CACHE_SIZE];
+static int	font_cache_fcinit = 0;
+#ifdef HAVE_PTHREAD_H
+static pthread_mutex_t font_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+#  define FONT_CACHE_LOCK()   pthread_mutex_lock(&font_cache_mutex)
+#  define FONT_CACHE_UNLOCK() pthread_mutex_unlock(&font_cache_mutex)
+#else
+#  define FONT_CACHE_LOCK()
+#  define FONT_CACHE_UNLOCK()
+#endif // HAVE_PTHREAD_H
+
+
 //
 // Local functions...
 //
 
+static char	*font_find(const char *font);
 static _cf_fontembed_emb_params_t *font_load(const char *font, int fontwidth,
 					     cf_logfunc_t log, void *ld);
+static time_t	font_mtime(const char *filename);
+static void	font_release(_cf_fontembed_emb_params_t *emb);
+static void	font_release_all(texttopdf_doc_t *doc);
 static _cf_fontembed_emb_params_t *font_std(const char *name);
 static int	compare_keywords(const void *k1, const void *k2);
-static int	get_utf8(FILE *fp);
+static int	get_utf8(texttopdf_input_t *in);
+static int	get_utf8_block(texttopdf_input_t *in);
 static void	write_line(int row, lchar_t *line, texttopdf_doc_t *doc);
 static void	write_string(int col, int row, int len, lchar_t *s,
 			     texttopdf_doc_t *doc);
@@ -600,14 +661,13 @@ cfFilterTextToPDF(int inputfd,  	// I - File descriptor input stream
   void		*ld = data->logdata;
   cf_filter_iscanceledfunc_t iscanceled = data->iscanceledfunc;
   void		*icd = data->iscanceleddata;
-  FILE		*fp;		// Print file
-  int		stdoutbackupfd;	// The "real" stdout is backupped here while
-				// stdout is redirected
+  texttopdf_input_t *in;	// Print file
   int		ret = 0;	// Return value
   cups_cspace_t cspace = (cups_cspace_t)(-1);
 
 
   doc.UTF8 = 1;                 // Use UTF-8 encoding?
+  doc.NumFonts = 0;		// Number of fonts to use
   doc.WrapLines = 1;		// Wrap text in lines
   doc.SizeLines = 60;		// Number of lines on a page
   doc.SizeColumns = 80;		// Number of columns on a line
@@ -615,6 +675,7 @@ cfFilterTextToPDF(int inputfd,  	// I - File descriptor input stream
   doc.ColumnGutter = 0;		// Number of characters between text columns
   doc.ColumnWidth = 80;		// Width of each column
   doc.PrettyPrint = 0;		// Do pretty code formatting
+  doc.Compress = 0;		// Compress content and xref (PDF 1.5)
   doc.Copies = 1;		// Number of copies
   doc.Page = NULL;		// Page characters
   doc.NumPages = 0;		// Number of pages in document
@@ -633,6 +694,7 @@ cfFilterTextToPDF(int inputfd,  	// I - File descriptor input stream
   doc.PageWidth = 612.0f;	// Total page width
   doc.PageLength = 792.0f;	// Total page length
   doc.pdf = NULL;		// PDF file contents
+  doc.OutputFD = outputfd;	// PDF output stream
   doc.Date = NULL;		// Date string
   doc.Title = NULL;		// Title string
 
@@ -656,7 +718,7 @@ cfFilterTextToPDF(int inputfd,  	// I - File descriptor input stream
   // Open the input data stream specified by the inputfd...
   //
 
-  if ((fp = fdopen(inputfd, "rb")) == NULL)
+  if ((in = calloc(1, sizeof(texttopdf_input_t))) == NULL)
   {
     if (!iscanceled || !iscanceled(icd))
     {
@@ -666,20 +728,11 @@ cfFilterTextToPDF(int inputfd,  	// I - File descriptor input stream
     return (1);
   }
 
-  //
-  // Redirect stdout to the outputfd (the PDF output strem of this filter
-  // function)
-  //
-
-  if (outputfd != 1)
-  {
-    stdoutbackupfd = dup(1);
-    dup2(outputfd, 1);
-    close(outputfd);
-  }
-
   cfRasterPrepareHeader(&(doc.h), data, CF_FILTER_OUT_FORMAT_CUPS_RASTER,
 			CF_FILTER_OUT_FORMAT_CUPS_RASTER, 0, &cspace);
+  in->fd      = inputfd;
+  in->charptr = in->charend = in->chars;
+
   doc.Orientation = doc.h.Orientation;
   doc.Duplex = doc.h.Duplex;
   doc.ColorDevice = doc.h.cupsNumColors <= 1 ? 0 : 1;
@@ -880,6 +933,11 @@ cfFilterTextToPDF(int inputfd,  	// I - File descriptor input stream
     }
   }
 
+  if ((val = cupsGetOption("pdf-compress", data->num_options,
+			   data->options)) != NULL)
+    doc.Compress = !strcasecmp(val, "true") || !strcasecmp(val, "on") ||
+                   !strcasecmp(val, "yes");
+
   if ((val = cupsGetOption("wrap", data->num_options, data->options)) == NULL)
     doc.WrapLines = 1;
   else
@@ -990,7 +1048,7 @@ cfFilterTextToPDF(int inputfd,  	// I - File descriptor input stream
   cmntState     = NoCmnt;
   strState      = NoStr;
 
-  while ((ch = get_utf8(fp)) >= 0)
+  while ((ch = get_utf8(in)) >= 0)
   {
     if (empty)
     {
@@ -1094,10 +1152,10 @@ cfFilterTextToPDF(int inputfd,  	// I - File descriptor input stream
 
           {
 	    int nextch;
-            if ((nextch = getc(fp)) != 0x0a)
-	      ungetc(nextch, fp);
-	    else
+            if ((nextch = get_utf8(in)) == 0x0a)
 	      ch = nextch;
+	    else if (nextch >= 0)
+	      in->charptr --;		// Still in the decoded block
 	  }
 #endif // !__APPLE__
 
@@ -1206,7 +1264,7 @@ cfFilterTextToPDF(int inputfd,  	// I - File descriptor input stream
           break;
 
       case 0x1b :		// Escape sequence
-          ch = get_utf8(fp);
+          ch = get_utf8(in);
 	  if (ch == '7')
 	  {
 	    //
@@ -1254,6 +1312,9 @@ cfFilterTextToPDF(int inputfd,  	// I - File descriptor input stream
           if (ch < ' ')
             break;		// Ignore other control chars
 
+          if (ch > 0xffff)
+	    ch = 0xfffd;	// Pages and fonts only cover the BMP
+
           if (doc.PrettyPrint > PRETTY_PLAIN)
 	  {
 	    //
@@ -1494,30 +1555,24 @@ cfFilterTextToPDF(int inputfd,  	// I - File descriptor input stream
   // Close input data stream
   //
 
-  if (fp != stdin)
-    fclose(fp);
+  close(in->fd);
+  free(in);
 
   //
   // Flush and close output data stream
   //
 
-  fflush(stdout);
-  close(1);
-
-  //
-  // Re-activate stdout output
-  //
+  if (doc.pdf)
+    _cfPDFOutFree(doc.pdf);
 
-  if (outputfd != 1)
-  {
-    dup2(stdoutbackupfd, 1);
-    close(stdoutbackupfd);
-  }
+  close(outputfd);
 
   //
   // Clean up
   //
 
+  font_release_all(&doc);
+
   if (doc.Page)
   {
     if (doc.Page[0])
@@ -1531,89 +1586,182 @@ cfFilterTextToPDF(int inputfd,  	// I - File descriptor input stream
     free(doc.Title);
   }
 
-  if (doc.pdf)
-    free(doc.pdf);
-
   return (ret);
 #endif // HAVE_FONTCONFIG
 }
 
 #ifdef HAVE_FONTCONFIG
 
-static _cf_fontembed_emb_params_t *
-font_load(const char *font,
-	  int fontwidth,
-	  cf_logfunc_t log,
-	  void *ld)
-{
-  _cf_fontembed_otf_file_t *otf;
+//
+// 'font_find()' - Find the font file for a fontconfig pattern.
+//
 
+static char *				// O - Font file, NULL if none found
+font_find(const char *font)		// I - Font pattern
+{
   FcPattern *pattern;
   FcFontSet *candidates;
   FcChar8   *fontname = NULL;
   FcResult   result;
   int i;
 
-  if ((font[0] == '/') || (font[0] == '.'))
-  {
-    candidates = NULL;
-    fontname = (FcChar8 *)strdup(font);
-  }
-  else
+  if (!font_cache_fcinit)
   {
     FcInit();
-    pattern = FcNameParse ((const FcChar8 *)font);
-    FcConfigSubstitute (0, pattern, FcMatchPattern);
-    FcDefaultSubstitute (pattern);
+    font_cache_fcinit = 1;
+  }
+  pattern = FcNameParse ((const FcChar8 *)font);
+  FcConfigSubstitute (0, pattern, FcMatchPattern);
+  FcDefaultSubstitute (pattern);
 
-    // Receive a sorted list of fonts matching our pattern
-    candidates = FcFontSort (0, pattern, FcFalse, 0, &result);
-    FcPatternDestroy (pattern);
+  // Receive a sorted list of fonts matching our pattern
+  candidates = FcFontSort (0, pattern, FcFalse, 0, &result);
+  FcPatternDestroy (pattern);
 
-    if (candidates)
+  if (candidates)
+  {
+    // In the list of fonts returned by FcFontSort()
+    // find the first one that is both in TrueType format and monospaced
+    for (i = 0; i < candidates->nfont; i ++)
     {
-      // In the list of fonts returned by FcFontSort()
-      // find the first one that is both in TrueType format and monospaced
-      for (i = 0; i < candidates->nfont; i ++)
-      {
-	FcChar8 *fontformat = NULL; // TODO? or just try?
-	int spacing = 0; // sane default, as FC_MONO == 100
-	FcPatternGetString(candidates->fonts[i], FC_FONTFORMAT, 0, &fontformat);
-	FcPatternGetInteger(candidates->fonts[i], FC_SPACING, 0, &spacing);
+      FcChar8 *fontformat = NULL; // TODO? or just try?
+      int spacing = 0; // sane default, as FC_MONO == 100
+      FcPatternGetString(candidates->fonts[i], FC_FONTFORMAT, 0, &fontformat);
+      FcPatternGetInteger(candidates->fonts[i], FC_SPACING, 0, &spacing);
 
-	if (fontformat) 
+      if (fontformat) 
+      {
+	// check for monospace or double width fonts
+	if (strcmp((const char *)fontformat, "TrueType") == 0)
 	{
-	  // check for monospace or double width fonts
-	  if (strcmp((const char *)fontformat, "TrueType") == 0)
-	  {
-	    fontname =
-	      FcPatternFormat(candidates->fonts[i],
-			      (const FcChar8 *)"%{file|cescape}/%{index}");
-	    break;
-	  }
-	  else if (strcmp((const char *)fontformat, "CFF") == 0)
-	  {
-	    fontname =
-	      FcPatternFormat (candidates->fonts[i],
-			       (const FcChar8 *)"%{file|cescape}");
-	                          // TTC only possible with non-cff glyphs!
-	    break;
-	  }
+	  fontname =
+	    FcPatternFormat(candidates->fonts[i],
+			    (const FcChar8 *)"%{file|cescape}/%{index}");
+	  break;
+	}
+	else if (strcmp((const char *)fontformat, "CFF") == 0)
+	{
+	  fontname =
+	    FcPatternFormat (candidates->fonts[i],
+			     (const FcChar8 *)"%{file|cescape}");
+	                        // TTC only possible with non-cff glyphs!
+	  break;
 	}
       }
-      FcFontSetDestroy (candidates);
     }
+    FcFontSetDestroy (candidates);
+  }
+
+  return ((char *)fontname);
+}
+
+
+static _cf_fontembed_emb_params_t *
+font_load(const char *font,
+	  int fontwidth,
+	  cf_logfunc_t log,
+	  void *ld)
+{
+  _cf_fontembed_otf_file_t *otf = NULL;
+  font_cache_t *entry = NULL,
+	       *unused = NULL;
+  char *fontname;
+  int i;
+
+  FONT_CACHE_LOCK();
+
+  //
+  // Look for the pattern in the cache, the font file must not have
+  // changed since...
+  //
+
+  for (i = 0; i < FONT_CACHE_SIZE; i ++)
+  {
+    if (!font_cache[i].pattern)
+    {
+      if (!unused || unused->pattern)
+	unused = font_cache + i;
+    }
+    else if (!strcmp(font_cache[i].pattern, font))
+    {
+      entry = font_cache + i;
+      break;
+    }
+    else if (!font_cache[i].in_use && (!unused || unused->pattern))
+      unused = font_cache + i;
+  }
+
+  if (entry && entry->filename &&
+      entry->mtime != font_mtime(entry->filename))
+  {
+    //
+    // Font file changed, look it up again (a job still using the old
+    // font closes it when done)...
+    //
+
+    if (entry->otf && !entry->in_use)
+      _cfFontEmbedOTFClose(entry->otf);
+    entry->otf    = NULL;
+    entry->in_use = 0;
+    free(entry->filename);
+    entry->filename = NULL;
+  }
+  else if (!entry && unused)
+  {
+    //
+    // New pattern, take an unused entry or one whose font is not in use...
+    //
+
+    entry = unused;
+    if (entry->otf)
+      _cfFontEmbedOTFClose(entry->otf);
+    free(entry->pattern);
+    free(entry->filename);
+    memset(entry, 0, sizeof(font_cache_t));
+    if ((entry->pattern = strdup(font)) == NULL)
+      entry = NULL;
+  }
+
+  if (entry && entry->filename)
+    fontname = strdup(entry->filename);
+  else
+  {
+    if ((font[0] == '/') || (font[0] == '.'))
+      fontname = strdup(font);
+    else
+      fontname = font_find(font);
+
+    if (fontname && entry && (entry->mtime = font_mtime(fontname)) != 0)
+      entry->filename = strdup(fontname);
   }
 
   if (!fontname)
   {
+    FONT_CACHE_UNLOCK();
     // TODO: try /usr/share/fonts/*/*/%s.ttf
     if(log) log(ld, CF_LOGLEVEL_ERROR,
 		"cfFilterTextToPDF: No viable font found.");
     return (NULL);
   }
 
-  otf = _cfFontEmbedOTFLoad((const char *)fontname);
+  //
+  // Use the cached font if nobody else does, otherwise load the font...
+  //
+
+  if (entry && entry->otf && !entry->in_use)
+  {
+    otf = entry->otf;
+    entry->in_use = 1;
+  }
+  else if ((otf = _cfFontEmbedOTFLoad((const char *)fontname)) != NULL &&
+	   entry && entry->filename && !entry->otf)
+  {
+    entry->otf    = otf;
+    entry->in_use = 1;
+  }
+
+  FONT_CACHE_UNLOCK();
+
   free(fontname);
   if (!otf)
     return (NULL);
@@ -1623,14 +1771,111 @@ font_load(const char *font,
   _cf_fontembed_emb_params_t *emb =
     _cfFontEmbedEmbNew(ff,
 		       _CF_FONTEMBED_EMB_DEST_PDF16,
-		       _CF_FONTEMBED_EMB_C_FORCE_MULTIBYTE |
-		       _CF_FONTEMBED_EMB_C_TAKE_FONTFILE);
+		       _CF_FONTEMBED_EMB_C_FORCE_MULTIBYTE);
   DEBUG_assert(emb);
   DEBUG_assert(emb->plan & _CF_FONTEMBED_EMB_A_MULTIBYTE);
 
   return (emb);
 }
 
+
+//
+// 'font_mtime()' - Get the modification time of a font file.
+//
+
+static time_t				// O - Modification time, 0 if none
+font_mtime(const char *filename)	// I - Font file (with "/index")
+{
+  struct stat	st;			// File information
+  char		path[1024],		// Font file without "/index"
+		*ptr;			// Pointer into path
+
+
+  if (!stat(filename, &st))
+    return (st.st_mtime);
+
+  strncpy(path, filename, sizeof(path) - 1);
+  path[sizeof(path) - 1] = '\0';
+  if ((ptr = strrchr(path, '/')) != NULL)
+  {
+    *ptr = '\0';
+    if (!stat(path, &st))
+      return (st.st_mtime);
+  }
+
+  return (0);
+}
+
+
+//
+// 'font_release()' - Close a font of a job, handing a loaded font file
+//                    back to the cache.
+//
+
+static void
+font_release(_cf_fontembed_emb_params_t *emb)
+{
+  _cf_fontembed_fontfile_t *ff;
+  _cf_fontembed_otf_file_t *otf;
+  int i;
+
+  if (emb->plan & _CF_FONTEMBED_EMB_A_CLOSE_FONTFILE)
+  {
+    _cfFontEmbedEmbClose(emb);
+    return;
+  }
+
+  ff  = emb->font;
+  otf = ff->sfnt;
+  ff->sfnt = NULL;
+  _cfFontEmbedEmbClose(emb);
+  _cfFontEmbedFontFileClose(ff);
+
+  FONT_CACHE_LOCK();
+  for (i = 0; i < FONT_CACHE_SIZE; i ++)
+    if (font_cache[i].otf == otf)
+    {
+      font_cache[i].in_use = 0;
+      otf = NULL;
+      break;
+    }
+  FONT_CACHE_UNLOCK();
+
+  if (otf)
+    _cfFontEmbedOTFClose(otf);
+}
+
+
+//
+// 'font_release_all()' - Close all fonts of a job.
+//
+
+static void
+font_release_all(texttopdf_doc_t *doc)
+{
+  int i, j, k, l;
+
+  for (i = 0; i < doc->NumFonts; i ++)
+    for (j = 0; j < 4; j ++)
+    {
+      _cf_fontembed_emb_params_t *emb = doc->Fonts[i][j];
+
+      if (!emb)
+	continue;
+
+      // Close each font only once, it may be used several times
+      for (k = 0; k < doc->NumFonts; k ++)
+	for (l = 0; l < 4; l ++)
+	  if (doc->Fonts[k][l] == emb)
+	    doc->Fonts[k][l] = NULL;
+
+      font_release(emb);
+    }
+
+  doc->NumFonts = 0;
+}
+
+
 static _cf_fontembed_emb_params_t *
 font_std(const char *name)
 {
@@ -1662,74 +1907,135 @@ compare_keywords(const void *k1,	// I - First keyword
 // 'get_utf8()' - Get a UTF-8 encoded wide character...
 //
 
-static int		// O - Character or -1 on error
-get_utf8(FILE *fp)	// I - File to read from
+static int				// O - Character or -1 at end of file
+get_utf8(texttopdf_input_t *in)		// I - Input to read from
 {
-  int	ch;		// Current character value
-  int	next;		// Next character from file
+  while (in->charptr >= in->charend)
+    if (get_utf8_block(in))
+      return (EOF);
 
+  return (*(in->charptr)++);
+}
 
-  //
-  // Read the first character and process things accordingly...
-  //
-  // UTF-8 maps 16-bit characters to:
-  //
-  //        0 to 127 = 0xxxxxxx
-  //     128 to 2047 = 110xxxxx 10yyyyyy (xxxxxyyyyyy)
-  //   2048 to 65535 = 1110xxxx 10yyyyyy 10zzzzzz (xxxxyyyyyyzzzzzz)
-  //
-  // We also accept:
-  //
-  //      128 to 191 = 10xxxxxx
-  //
-  // since this range of values is otherwise undefined unless you are
-  // in the middle of a multi-byte character...
-  //
-  // This code currently does not support anything beyond 16-bit
-  // characters, in part because PostScript doesn't support more than
-  // 16-bit characters...
-  //
 
-  if ((ch = getc(fp)) == EOF)
-    return (EOF);
+//
+// 'get_utf8_block()' - Read and decode the next block of input.
+//
+// UTF-8 maps characters to:
+//
+//            0 to 127 = 0xxxxxxx
+//         128 to 2047 = 110xxxxx 10yyyyyy
+//       2048 to 65535 = 1110xxxx 10yyyyyy 10zzzzzz
+//    65536 to 1114111 = 11110www 10xxxxxx 10yyyyyy 10zzzzzz
+//
+// Runs of ASCII are copied 8 bytes at a time.  A byte that does not start
+// a valid, shortest-form sequence is taken as a character of its own, so
+// stray 128 to 191 and Latin-1 text still come out as ISO-8859-1.  A
+// sequence cut off by the end of the buffer is kept for the next block.
+//
 
-  if (ch < 0xc0)			// One byte character?
-    return (ch);
-  else if ((ch & 0xe0) == 0xc0)
+static int				// O - 0 on success, -1 at end of file
+get_utf8_block(texttopdf_input_t *in)	// I - Input to read from
+{
+  unsigned char	*bufptr,		// Pointer into buffer
+		*bufend;		// End of buffer
+  int		*charptr;		// Pointer into decoded characters
+  int		ch,			// Current character
+		len,			// Length of sequence
+		min,			// Smallest character for the length
+		i;			// Looping var
+  ssize_t	bytes;			// Bytes read
+  uint64_t	w;			// Word of input
+
+
+  if (!in->eof)
   {
-    //
-    // Two byte character...
-    //
+    while ((bytes = read(in->fd, in->buffer + in->bytes,
+			 sizeof(in->buffer) - in->bytes)) < 0 &&
+	   errno == EINTR);
 
-    if ((next = getc(fp)) == EOF)
-      return (EOF);
+    if (bytes > 0)
+      in->bytes += (size_t)bytes;
     else
-      return (((ch & 0x1f) << 6) | (next & 0x3f));
+      in->eof = 1;
   }
-  else if ((ch & 0xf0) == 0xe0)
+
+  if (!in->bytes)
+    return (-1);
+
+  bufptr  = in->buffer;
+  bufend  = in->buffer + in->bytes;
+  charptr = in->chars;
+
+  while (bufptr < bufend)
   {
-    //
-    // Three byte character...
-    //
+    while (bufend - bufptr >= 8)
+    {
+      memcpy(&w, bufptr, sizeof(w));
+      if (w & INPUT_ASCII)
+	break;
 
-    if ((next = getc(fp)) == EOF)
-      return (EOF);
+      for (i = 0; i < 8; i ++)
+	charptr[i] = bufptr[i];
 
-    ch = ((ch & 0x0f) << 6) | (next & 0x3f);
+      bufptr  += 8;
+      charptr += 8;
+    }
 
-    if ((next = getc(fp)) == EOF)
-      return (EOF);
+    if (bufptr >= bufend)
+      break;
+
+    ch = *bufptr;
+
+    if (ch >= 0xc2 && ch <= 0xdf)
+    {
+      len = 2;
+      min = 0x80;
+      ch  &= 0x1f;
+    }
+    else if (ch >= 0xe0 && ch <= 0xef)
+    {
+      len = 3;
+      min = 0x800;
+      ch  &= 0x0f;
+    }
+    else if (ch >= 0xf0 && ch <= 0xf4)
+    {
+      len = 4;
+      min = 0x10000;
+      ch  &= 0x07;
+    }
     else
-      return ((ch << 6) | (next & 0x3f));
-  }
-  else
-  {
-    //
-    // More than three bytes...  We don't support that...
-    //
+    {
+      len = 1;
+      min = 0;
+    }
+
+    if (len > bufend - bufptr && !in->eof)
+      break;				// Finish it with the next block
+
+    for (i = 1; i < len && bufptr + i < bufend && (bufptr[i] & 0xc0) == 0x80;
+	 i ++)
+      ch = (ch << 6) | (bufptr[i] & 0x3f);
 
-    return (EOF);
+    if (i < len || ch < min || (ch >= 0xd800 && ch <= 0xdfff) ||
+	ch > 0x10ffff)
+    {
+      ch  = *bufptr;			// Not UTF-8, use the byte as is
+      len = 1;
+    }
+
+    *charptr++ = ch;
+    bufptr     += len;
   }
+
+  in->bytes -= (size_t)(bufptr - in->buffer);
+  memmove(in->buffer, bufptr, in->bytes);
+
+  in->charptr = in->chars;
+  in->charend = charptr;
+
+  return (0);
 }
 
 
@@ -1801,14 +2107,8 @@ write_page(texttopdf_doc_t *doc)
 {
   int	line;			// Current line
 
-  int content = _cfPDFOutAddXRef(doc->pdf);
-  _cfPDFOutPrintF(doc->pdf,"%d 0 obj\n"
-		 "<</Length %d 0 R\n"
-		 ">>\n"
-		 "stream\n"
-		 "q\n",
-		 content, content + 1);
-  long size = -((doc->pdf->filepos) - 2);
+  _cfPDFOutBeginStream(doc->pdf);
+  _cfPDFOutPrintF(doc->pdf,"q\n");
 
   (doc->NumPages) ++;
   if (doc->PrettyPrint)
@@ -1817,17 +2117,8 @@ write_page(texttopdf_doc_t *doc)
   for (line = 0; line < doc->SizeLines; line ++)
     write_line(line, doc->Page[line], doc);
 
-  size+= ((doc->pdf->filepos) + 2);
-  _cfPDFOutPrintF(doc->pdf,"Q\n"
-		 "endstream\n"
-		 "endobj\n");
-  
-  int len_obj = _cfPDFOutAddXRef(doc->pdf);
-  DEBUG_assert(len_obj == content + 1);
-  _cfPDFOutPrintF(doc->pdf,"%d 0 obj\n"
-		 "%ld\n"
-		 "endobj\n",
-		 len_obj,size);
+  _cfPDFOutPrintF(doc->pdf,"Q\n");
+  int content = _cfPDFOutEndStream(doc->pdf, NULL);
 
   int obj = _cfPDFOutAddXRef(doc->pdf);
   _cfPDFOutPrintF(doc->pdf,"%d 0 obj\n"
@@ -1924,8 +2215,9 @@ write_prolog(const char *title,		// I - Title of job
   //
 
   DEBUG_assert(!(doc->pdf));
-  doc->pdf = _cfPDFOutNew();
+  doc->pdf = _cfPDFOutNewFD(doc->OutputFD);
   DEBUG_assert(doc->pdf);
+  doc->pdf->compress = doc->Compress;
 
   _cfPDFOutBeginPDF(doc->pdf);
   _cfPDFOutPrintF(doc->pdf,"%%cupsRotation: %d\n",
@@ -26,6 +26,7 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <stdint.h>
 #include <string.h>
 #include <ctype.h>
 #include <iconv.h>
@@ -35,6 +36,14 @@
 #include <cupsfilters/libcups2-private.h>
 
 
+//
+// Constants...
+//
+
+#define CTRL_ONES	0x0101010101010101ULL	// 0x01 in every byte
+#define CTRL_HIGH	0x8080808080808080ULL	// 0x80 in every byte
+
+
 //
 // Type definitions
 //
@@ -62,6 +71,7 @@ static int              is_true(const char *value);
 static int              is_false(const char *value);
 static int		check_range(char *page_ranges, int even_pages,
 				    int odd_pages, int page);
+static const char	*find_control(const char *s, const char *end);
 
 int
 cfFilterTextToText(int inputfd,         // I - File descriptor input stream
@@ -138,11 +148,14 @@ cfFilterTextToText(int inputfd,         // I - File descriptor input stream
 					// for output page creation
                 *destptr;               // Pointer into output page buffer
 					// where next character will be put
+  const char    *endptr;                // End of the text on a line
   int           page,                   // Number of current output page
                 line, column;           // Character coordiantes on output
 					// page
   int           page_empty;             // Is the current output page still
 					// empty (no visible characters)?
+  int           skip_page;              // Is the current page left out by
+					// the page selection?
   int           previous_is_cr;         // Is the previous character processed
 					// a Carriage Return?
   int           new_line_started = 0;   // Is the proceeding of starting a
@@ -817,6 +830,8 @@ cfFilterTextToText(int inputfd,         // I - File descriptor input stream
   destptr = out_page;
   page_empty = 1;
   page = 1;
+  skip_page = pagination &&
+	      !check_range(page_ranges, even_pages, odd_pages, page);
   line = 0;
   column = 0;
   previous_is_cr = 0;
@@ -906,13 +921,13 @@ cfFilterTextToText(int inputfd,         // I - File descriptor input stream
 	    if (*procptr > ' ')
 	    {
 	      *destptr = '\0';
-	      for (p = destptr - 1, i = column - 1; *p != ' ' && i >= 0;
+	      for (p = destptr - 1, i = column - 1; i >= 0 && *p != ' ';
 		   p --, i--);
 	      if (i >= 0 && i < column - 1)
 	      {
 		wrapped_word = strdup(p + 1);
-		for (; *p == ' ' && i >= 0; p --, i--);
-		if (*p != ' ' && i >= 0)
+		for (; i >= 0 && *p == ' '; p --, i--);
+		if (i >= 0 && *p != ' ')
 		  destptr = p + 1;
 		else
 		{
@@ -940,8 +955,7 @@ cfFilterTextToText(int inputfd,         // I - File descriptor input stream
 	  outbuf[0] == '\0' )     // End of input file
       {
 	// Do we actually print this page?
-	if (!pagination ||
-	    check_range(page_ranges, even_pages, odd_pages, page))
+	if (!skip_page)
 	{
 	  // Finalize the page
 	  if (pagination)
@@ -962,7 +976,7 @@ cfFilterTextToText(int inputfd,         // I - File descriptor input stream
 	    }
 	  }
 	  // Allow to handle the finished page as a C string
-	  *(destptr ++) = '\0';
+	  *destptr = '\0';
 	  // Count pages which will actually get printed
 	  num_pages ++;
 	  if (!pagination)
@@ -973,14 +987,14 @@ cfFilterTextToText(int inputfd,         // I - File descriptor input stream
 	    {
 	      if (log) log(ld, CF_LOGLEVEL_CONTROL, "PAGE: 1 1");
 	    }
-	    cupsFilePuts(outputfp, out_page);
+	    cupsFileWrite(outputfp, out_page, (size_t)(destptr - out_page));
 	  }
 	  else if ((num_copies == 1 || !collate) && !reverse_order)
 	  {
 	    // Log the page output
 	    if (log) log(ld, CF_LOGLEVEL_CONTROL,
 			 "PAGE: %d %d", num_pages, num_copies);
-	    cupsFilePuts(outputfp, out_page);
+	    cupsFileWrite(outputfp, out_page, (size_t)(destptr - out_page));
 	  }
 	  else
 	  {
@@ -995,6 +1009,8 @@ cfFilterTextToText(int inputfd,         // I - File descriptor input stream
 	column = 0;
 	new_line_started = 0;
 	page ++;
+	skip_page = pagination &&
+		    !check_range(page_ranges, even_pages, odd_pages, page);
       }
       if (outbuf[0] == '\0') // End of input file
 	break;
@@ -1018,6 +1034,18 @@ cfFilterTextToText(int inputfd,         // I - File descriptor input stream
 	  skip_spaces = 0;
 	}
       }
+      if (skip_page && column == 0 && !skip_spaces && !skip_rest_of_line &&
+	  (endptr = find_control(procptr, outptr)) > procptr &&
+	  endptr < outptr &&
+	  (*endptr == '\r' || *endptr == '\n' || *endptr == '\f') &&
+	  (overlong_lines == TRUNCATE || endptr - procptr <= text_width))
+      {
+	// The page does not get printed and the text up to the end of
+	// the line needs no wrapping, so it only has to be counted as
+	// one line.  Go straight on to the line end.
+	procptr = (char *)endptr;
+	previous_is_cr = 0;
+      }
       if (*procptr == '\r' || *procptr == '\n') // CR or LF
       {
 	// Only write newline if we are not on the LF of a CR+LF
@@ -1154,6 +1182,37 @@ cfFilterTextToText(int inputfd,         // I - File descriptor input stream
 }
 
 
+//
+// 'find_control()' - Find the first control character (tab, line end,
+//                    form feed, ...) in a string, 8 bytes at a time.
+//
+
+static const char *			// O - Control character or end
+find_control(const char *s,		// I - String
+	     const char *end)		// I - End of string
+{
+  uint64_t	w;			// Word of the string
+
+
+  while (end - s >= 8)
+  {
+    // A byte below 0x20 borrows in the subtraction and has its high
+    // bit clear, which sets its high bit in the result
+    memcpy(&w, s, sizeof(w));
+    if ((w - 0x20 * CTRL_ONES) & ~w & CTRL_HIGH)
+      break;
+
+    s += 8;
+  }
+
+  for (; s < end; s ++)
+    if ((unsigned char)*s < ' ')
+      break;
+
+  return (s);
+}
+
+
 //
 // 'is_true()' - Check option value for boolean true
 //